@@ -0,0 +1,786 @@
+#include "unsp_assembler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+enum Reg { REG_SP = 0, REG_BP = 5, REG_SR = 6, REG_PC = 7 };
+
+enum AluOp {
+  ALUOP_ADD = 0,
+  ALUOP_ADC = 1,
+  ALUOP_SUB = 2,
+  ALUOP_SBC = 3,
+  ALUOP_CMP = 4,
+  ALUOP_NEG = 6,
+  ALUOP_XOR = 8,
+  ALUOP_LOAD = 9,
+  ALUOP_OR = 10,
+  ALUOP_AND = 11,
+  ALUOP_TEST = 12,
+  ALUOP_STORE = 13,
+};
+
+constexpr int kBranchJmp = 14;
+
+constexpr std::pair<std::string_view, int> kRegNames[] = {
+    {"sp", 0}, {"r1", 1}, {"r2", 2}, {"r3", 3}, {"r4", 4}, {"bp", 5}, {"sr", 6}, {"pc", 7},
+};
+
+constexpr std::pair<std::string_view, int> kBranchNames[] = {
+    {"jb", 0},   {"jcc", 0},  {"jae", 1}, {"jcs", 1}, {"jge", 2}, {"jsc", 2}, {"jl", 3},
+    {"jss", 3},  {"jne", 4},  {"jnz", 4}, {"je", 5},  {"jz", 5},  {"jpl", 6}, {"jmi", 7},
+    {"jbe", 8},  {"ja", 9},   {"jle", 10}, {"jg", 11}, {"jvc", 12}, {"jvs", 13}, {"jmp", 14},
+};
+
+// Base of the op1n field for each shift, which is added the shift amount minus one
+constexpr std::pair<std::string_view, int> kShiftNames[] = {
+    {"asr", 36}, {"lsl", 40}, {"lsr", 44}, {"rol", 48}, {"ror", 52},
+};
+
+class AssemblyError : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+std::string ToLower(std::string_view str) {
+  std::string lower(str);
+  std::transform(lower.begin(), lower.end(), lower.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return lower;
+}
+
+template <size_t N>
+std::optional<int> Lookup(const std::pair<std::string_view, int> (&table)[N],
+                          std::string_view name) {
+  const std::string lower = ToLower(name);
+  for (const auto& [entry_name, value] : table) {
+    if (entry_name == lower)
+      return value;
+  }
+  return std::nullopt;
+}
+
+struct Token {
+  enum class Kind { IDENT, NUMBER, PUNCT, END };
+  Kind kind = Kind::END;
+  std::string text;
+  int64_t number = 0;
+};
+
+std::vector<Token> Tokenize(std::string_view line) {
+  constexpr std::string_view kTwoCharPuncts[] = {"+=", "-=", "^=", "|=", "&=",
+                                                 "++", "--", "<<", ">>"};
+  std::vector<Token> tokens;
+  size_t pos = 0;
+  while (pos < line.size()) {
+    const char c = line[pos];
+    if (std::isspace(static_cast<unsigned char>(c))) {
+      pos++;
+    } else if (c == ';' || line.substr(pos, 2) == "//") {
+      break;
+    } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_' || c == '.') {
+      const size_t start = pos;
+      while (pos < line.size() && (std::isalnum(static_cast<unsigned char>(line[pos])) ||
+                                   line[pos] == '_' || line[pos] == '.')) {
+        pos++;
+      }
+      tokens.push_back({Token::Kind::IDENT, std::string(line.substr(start, pos - start))});
+    } else if (std::isdigit(static_cast<unsigned char>(c))) {
+      const size_t start = pos;
+      while (pos < line.size() && std::isalnum(static_cast<unsigned char>(line[pos]))) {
+        pos++;
+      }
+      std::string_view text = line.substr(start, pos - start);
+      int base = 10;
+      if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        base = 16;
+        text.remove_prefix(2);
+      } else if (text.size() > 2 && text[0] == '0' && (text[1] == 'b' || text[1] == 'B')) {
+        base = 2;
+        text.remove_prefix(2);
+      }
+      int64_t value = 0;
+      auto [ptr, error] = std::from_chars(text.data(), text.data() + text.size(), value, base);
+      if (ptr != text.data() + text.size() || error != std::errc())
+        throw AssemblyError("Invalid number " + std::string(line.substr(start, pos - start)));
+      tokens.push_back({Token::Kind::NUMBER, std::string(text), value});
+    } else {
+      std::string_view punct = line.substr(pos, 1);
+      for (auto two_char : kTwoCharPuncts) {
+        if (line.substr(pos, 2) == two_char)
+          punct = two_char;
+      }
+      tokens.push_back({Token::Kind::PUNCT, std::string(punct)});
+      pos += punct.size();
+    }
+  }
+  tokens.push_back({Token::Kind::END, ""});
+  return tokens;
+}
+
+// Value of an expression, which is unknown in the first pass if it uses a later label
+struct Value {
+  int64_t value = 0;
+  bool known = true;
+};
+
+struct Operand {
+  enum class Kind {
+    REG,         // rs
+    SHIFT,       // rs lsl n
+    IMM,         // value
+    BP,          // [bp+imm6]
+    INDIRECT,    // [rs], [rs--], [rs++], [++rs], with d: prefix
+    DIRECT,      // [address]
+  };
+  Kind kind = Kind::REG;
+  int reg = 0;
+  int op1n = 0;  // for SHIFT and INDIRECT
+  Value value;
+};
+
+class Assembly {
+public:
+  Assembly(std::span<Word> image, std::map<std::string, int64_t>& symbols)
+      : image_(image), symbols_(symbols) {}
+
+  void RunPass(int pass, const std::vector<std::string_view>& lines) {
+    pass_ = pass;
+    pc_ = 0;
+    decision_index_ = 0;
+    for (line_number_ = 1; line_number_ <= lines.size(); line_number_++) {
+      tokens_ = Tokenize(lines[line_number_ - 1]);
+      pos_ = 0;
+      AssembleLine();
+    }
+  }
+
+  size_t GetLineNumber() const {
+    return line_number_;
+  }
+
+private:
+  const Token& Peek(size_t offset = 0) const {
+    return tokens_[std::min(pos_ + offset, tokens_.size() - 1)];
+  }
+
+  const Token& Next() {
+    const Token& token = Peek();
+    if (pos_ < tokens_.size() - 1)
+      pos_++;
+    return token;
+  }
+
+  bool IsPunct(std::string_view punct, size_t offset = 0) const {
+    const Token& token = Peek(offset);
+    return token.kind == Token::Kind::PUNCT && token.text == punct;
+  }
+
+  bool IsWord(std::string_view word, size_t offset = 0) const {
+    const Token& token = Peek(offset);
+    return token.kind == Token::Kind::IDENT && ToLower(token.text) == word;
+  }
+
+  bool AcceptPunct(std::string_view punct) {
+    if (!IsPunct(punct))
+      return false;
+    Next();
+    return true;
+  }
+
+  bool AcceptWord(std::string_view word) {
+    if (!IsWord(word))
+      return false;
+    Next();
+    return true;
+  }
+
+  void ExpectPunct(std::string_view punct) {
+    if (!AcceptPunct(punct))
+      throw AssemblyError("Expected " + std::string(punct));
+  }
+
+  void ExpectEnd() {
+    if (Peek().kind != Token::Kind::END)
+      throw AssemblyError("Unexpected " + Peek().text);
+  }
+
+  std::optional<int> PeekReg(size_t offset = 0) const {
+    const Token& token = Peek(offset);
+    if (token.kind != Token::Kind::IDENT)
+      return std::nullopt;
+    return Lookup(kRegNames, token.text);
+  }
+
+  int ExpectReg() {
+    auto reg = PeekReg();
+    if (!reg.has_value())
+      throw AssemblyError("Expected register");
+    Next();
+    return *reg;
+  }
+
+  Value ParseExpression() {
+    return ParseBinary(0);
+  }
+
+  int64_t ParseConstant() {
+    const Value value = ParseExpression();
+    if (!value.known)
+      throw AssemblyError("Value must be known before it is used here");
+    return value.value;
+  }
+
+  // Precedence climbing over the C binary operators
+  Value ParseBinary(int min_level) {
+    constexpr std::pair<std::string_view, int> kLevels[] = {
+        {"|", 0}, {"^", 1}, {"&", 2}, {"<<", 3}, {">>", 3}, {"+", 4},
+        {"-", 4}, {"*", 5}, {"/", 5}, {"%", 5},
+    };
+
+    Value lhs = ParseUnary();
+    while (Peek().kind == Token::Kind::PUNCT) {
+      const std::string op = Peek().text;
+      auto level = Lookup(kLevels, op);
+      if (!level.has_value() || *level < min_level)
+        break;
+      Next();
+      const Value rhs = ParseBinary(*level + 1);
+      lhs.known &= rhs.known;
+      if (!lhs.known)
+        continue;
+      if ((op == "/" || op == "%") && rhs.value == 0)
+        throw AssemblyError("Division by zero");
+
+      if (op == "|")
+        lhs.value |= rhs.value;
+      else if (op == "^")
+        lhs.value ^= rhs.value;
+      else if (op == "&")
+        lhs.value &= rhs.value;
+      else if (op == "<<")
+        lhs.value <<= rhs.value;
+      else if (op == ">>")
+        lhs.value >>= rhs.value;
+      else if (op == "+")
+        lhs.value += rhs.value;
+      else if (op == "-")
+        lhs.value -= rhs.value;
+      else if (op == "*")
+        lhs.value *= rhs.value;
+      else if (op == "/")
+        lhs.value /= rhs.value;
+      else
+        lhs.value %= rhs.value;
+    }
+    return lhs;
+  }
+
+  Value ParseUnary() {
+    if (AcceptPunct("-")) {
+      Value value = ParseUnary();
+      value.value = -value.value;
+      return value;
+    }
+    if (AcceptPunct("~")) {
+      Value value = ParseUnary();
+      value.value = ~value.value;
+      return value;
+    }
+    if (AcceptPunct("(")) {
+      const Value value = ParseExpression();
+      ExpectPunct(")");
+      return value;
+    }
+    if (AcceptPunct("$"))
+      return {pc_, true};
+
+    const Token& token = Next();
+    if (token.kind == Token::Kind::NUMBER)
+      return {token.number, true};
+    if (token.kind == Token::Kind::IDENT) {
+      if (Lookup(kRegNames, token.text).has_value())
+        throw AssemblyError("Register " + token.text + " used as a value");
+      auto it = symbols_.find(token.text);
+      if (it != symbols_.end())
+        return {it->second, pass_ == 2 || defined_in_pass1_.contains(token.text)};
+      if (pass_ == 2)
+        throw AssemblyError("Undefined symbol " + token.text);
+      return {0, false};
+    }
+    throw AssemblyError("Expected value");
+  }
+
+  // Whether to use the short form of an instruction with the given value. The choice made in
+  // the first pass, where later labels are unknown, is kept so that addresses do not change.
+  bool UseShortForm(const Value& value, int64_t limit) {
+    if (pass_ == 1) {
+      const bool short_form = value.known && value.value >= 0 && value.value < limit;
+      short_forms_.push_back(short_form);
+      return short_form;
+    }
+    return short_forms_[decision_index_++];
+  }
+
+  void DefineSymbol(const std::string& name, int64_t value) {
+    if (Lookup(kRegNames, name).has_value())
+      throw AssemblyError("Register name " + name + " used as a symbol");
+    if (pass_ == 1) {
+      if (!defined_in_pass1_.insert(name).second)
+        throw AssemblyError("Symbol " + name + " defined twice");
+    }
+    symbols_[name] = value;
+  }
+
+  void Emit(int64_t value) {
+    if (pc_ < 0 || static_cast<size_t>(pc_) >= image_.size())
+      throw AssemblyError("Address outside of the image");
+    if (pass_ == 2)
+      image_[pc_] = value & 0xffff;
+    pc_++;
+  }
+
+  static Word Encode(int op0, int rd, int op1n, int rs) {
+    return (op0 << 12) | (rd << 9) | (op1n << 3) | rs;
+  }
+
+  void AssembleLine() {
+    // Labels, but not the D: prefix of a memory operand
+    if (Peek().kind == Token::Kind::IDENT && IsPunct(":", 1) && !IsPunct("[", 2)) {
+      DefineSymbol(Next().text, pc_);
+      Next();
+    }
+    if (Peek().kind == Token::Kind::END)
+      return;
+
+    const Token& first = Peek();
+    const std::string word = first.kind == Token::Kind::IDENT ? ToLower(first.text) : "";
+    if (!word.empty() && word[0] == '.') {
+      Next();
+      AssembleDirective(word);
+    } else if (auto cond = Lookup(kBranchNames, word); cond.has_value()) {
+      Next();
+      AssembleBranch(*cond);
+    } else if (word == "call" || word == "goto") {
+      Next();
+      const Value target = ParseExpression();
+      const int64_t address = target.known ? target.value : 0;
+      if (word == "call")
+        Emit(Encode(0xf, 0, 8, 0) | ((address >> 16) & 0x3f));
+      else
+        Emit(Encode(0xf, REG_PC, 16, 0) | ((address >> 16) & 0x3f));
+      Emit(address);
+    } else if (word == "push" || word == "pop") {
+      Next();
+      AssemblePushPop(word == "push");
+    } else if (word == "retf") {
+      Next();
+      Emit(Encode(ALUOP_LOAD, REG_BP, 18, REG_SP));
+    } else if (word == "reti") {
+      Next();
+      Emit(Encode(ALUOP_LOAD, REG_BP, 19, REG_SP));
+    } else if (word == "nop" || word == "break") {
+      Next();
+      EmitControl(word == "nop" ? 37 : 32);
+    } else if (word == "int") {
+      Next();
+      AssembleInt();
+    } else if (word == "irq" || word == "fiq" || word == "fir_mov") {
+      Next();
+      const bool on = AcceptWord("on");
+      if (!on && !AcceptWord("off"))
+        throw AssemblyError("Expected on or off");
+      if (word == "irq")
+        EmitControl(on ? 9 : 8);
+      else if (word == "fiq")
+        EmitControl(on ? 14 : 12);
+      else
+        EmitControl(on ? 4 : 5);
+    } else if (word == "cmp" || word == "test") {
+      Next();
+      const int rd = ExpectReg();
+      ExpectPunct(",");
+      EmitAlu(word == "cmp" ? ALUOP_CMP : ALUOP_TEST, rd, ParseOperand());
+    } else if (word == "mr") {
+      Next();
+      ExpectPunct("=");
+      AssembleMultiply();
+    } else {
+      AssembleAssignment();
+    }
+    ExpectEnd();
+  }
+
+  void AssembleDirective(const std::string& directive) {
+    if (directive == ".org") {
+      pc_ = ParseConstant();
+    } else if (directive == ".dw") {
+      do {
+        const Value value = ParseExpression();
+        Emit(value.value);
+      } while (AcceptPunct(","));
+    } else if (directive == ".fill") {
+      const int64_t count = ParseConstant();
+      int64_t value = 0;
+      if (AcceptPunct(","))
+        value = ParseConstant();
+      for (int64_t i = 0; i < count; i++) {
+        Emit(value);
+      }
+    } else if (directive == ".equ") {
+      const Token name = Next();
+      if (name.kind != Token::Kind::IDENT)
+        throw AssemblyError("Expected symbol name");
+      ExpectPunct(",");
+      DefineSymbol(name.text, ParseConstant());
+    } else {
+      throw AssemblyError("Unknown directive " + directive);
+    }
+  }
+
+  // Relative to the address after the branch, up to 63 words in either direction
+  void AssembleBranch(int cond) {
+    const Value target = ParseExpression();
+    if (!target.known) {
+      Emit(0);
+      return;
+    }
+    const int64_t offset = target.value - (pc_ + 1);
+    if (offset < -63 || offset > 63)
+      throw AssemblyError("Branch target out of range, use goto instead");
+    if (offset >= 0)
+      Emit(Encode(cond, REG_PC, 0, 0) | offset);
+    else
+      Emit(Encode(cond, REG_PC, 8, 0) | -offset);
+  }
+
+  // push rA[, rB] to [rs] and pop rA[, rB] from [rs], with registers from rA to rB
+  void AssemblePushPop(bool push) {
+    const int first = ExpectReg();
+    int last = first;
+    if (AcceptPunct(","))
+      last = ExpectReg();
+    if (last < first || (!push && first == REG_SP))
+      throw AssemblyError("Invalid register range");
+    if (!AcceptWord(push ? "to" : "from"))
+      throw AssemblyError(push ? "Expected to" : "Expected from");
+    ExpectPunct("[");
+    const int rs = ExpectReg();
+    ExpectPunct("]");
+
+    const int count = last - first + 1;
+    if (push)
+      Emit(Encode(ALUOP_STORE, last, 16 + count, rs));
+    else
+      Emit(Encode(ALUOP_LOAD, first - 1, 16 + count, rs));
+  }
+
+  void EmitControl(int imm6) {
+    Emit(Encode(0xf, 0, 40, 0) | imm6);
+  }
+
+  // int off, int irq, int fiq or int fiq, irq
+  void AssembleInt() {
+    int imm6 = 0;
+    if (!AcceptWord("off")) {
+      do {
+        if (AcceptWord("irq"))
+          imm6 |= 1;
+        else if (AcceptWord("fiq"))
+          imm6 |= 2;
+        else
+          throw AssemblyError("Expected irq or fiq");
+      } while (AcceptPunct(","));
+    }
+    EmitControl(imm6);
+  }
+
+  // mr = rd * rs[, us] or mr = [rd] * [rs][, us][, n]
+  void AssembleMultiply() {
+    const bool sum = AcceptPunct("[");
+    const int rd = ExpectReg();
+    if (sum)
+      ExpectPunct("]");
+    ExpectPunct("*");
+    if (sum)
+      ExpectPunct("[");
+    const int rs = ExpectReg();
+    if (sum)
+      ExpectPunct("]");
+    if (rd == REG_PC || rs == REG_PC)
+      throw AssemblyError("Multiply can not use pc");
+
+    bool unsigned_rd = false;
+    int64_t count = 16;
+    while (AcceptPunct(",")) {
+      if (AcceptWord("us"))
+        unsigned_rd = true;
+      else if (AcceptWord("ss"))
+        unsigned_rd = false;
+      else if (sum)
+        count = ParseConstant();
+      else
+        throw AssemblyError("Expected us or ss");
+    }
+    if (count < 1 || count > 16)
+      throw AssemblyError("Multiply-accumulate count must be from 1 to 16");
+
+    if (sum)
+      Emit(Encode(0xf, rd, (unsigned_rd ? 16 : 48) | (count & 0xf), rs));
+    else
+      Emit(Encode(0xf, rd, (unsigned_rd ? 0 : 32) | 1, rs));
+  }
+
+  Operand ParseOperand() {
+    Operand operand;
+    if (IsPunct("[") || (IsWord("d") && IsPunct(":", 1)))
+      return ParseMemoryOperand();
+
+    if (auto reg = PeekReg(); reg.has_value()) {
+      Next();
+      operand.reg = *reg;
+      if (Peek().kind == Token::Kind::IDENT) {
+        auto shift = Lookup(kShiftNames, Peek().text);
+        if (shift.has_value()) {
+          Next();
+          const int64_t amount = ParseConstant();
+          if (amount < 1 || amount > 4)
+            throw AssemblyError("Shift amount must be from 1 to 4");
+          operand.kind = Operand::Kind::SHIFT;
+          operand.op1n = *shift + amount - 1;
+        }
+      }
+      return operand;
+    }
+
+    operand.kind = Operand::Kind::IMM;
+    operand.value = ParseExpression();
+    return operand;
+  }
+
+  Operand ParseMemoryOperand() {
+    Operand operand;
+    const bool ds = AcceptWord("d");
+    if (ds)
+      ExpectPunct(":");
+    ExpectPunct("[");
+
+    if (AcceptPunct("++")) {
+      operand.kind = Operand::Kind::INDIRECT;
+      operand.reg = ExpectReg();
+      operand.op1n = 27;
+    } else if (auto reg = PeekReg(); reg.has_value()) {
+      Next();
+      operand.reg = *reg;
+      if (*reg == REG_BP && !ds && AcceptPunct("+")) {
+        operand.kind = Operand::Kind::BP;
+        operand.value.value = ParseConstant();
+        if (operand.value.value < 0 || operand.value.value > 63)
+          throw AssemblyError("Offset from bp must be from 0 to 63");
+      } else {
+        operand.kind = Operand::Kind::INDIRECT;
+        operand.op1n = AcceptPunct("--") ? 25 : AcceptPunct("++") ? 26 : 24;
+      }
+    } else {
+      if (ds)
+        throw AssemblyError("Expected register after d:");
+      operand.kind = Operand::Kind::DIRECT;
+      operand.value = ParseExpression();
+    }
+    if (ds)
+      operand.op1n += 4;
+    ExpectPunct("]");
+    return operand;
+  }
+
+  // rd op= operand, with store for memory destinations
+  void EmitAlu(int op, int rd, const Operand& operand) {
+    const bool store = op == ALUOP_STORE;
+    switch (operand.kind) {
+      case Operand::Kind::REG:
+      case Operand::Kind::SHIFT:
+        if (store)
+          throw AssemblyError("Can not store to a register");
+        Emit(Encode(op, rd, operand.kind == Operand::Kind::REG ? 32 : operand.op1n,
+                    operand.reg));
+        return;
+      case Operand::Kind::IMM:
+        if (store)
+          throw AssemblyError("Can not store to a value");
+        if (rd != REG_PC && UseShortForm(operand.value, 0x40)) {
+          Emit(Encode(op, rd, 8, 0) | operand.value.value);
+        } else {
+          Emit(Encode(op, rd, 33, rd));
+          Emit(operand.value.value);
+        }
+        return;
+      case Operand::Kind::BP:
+        if (rd == REG_PC)
+          throw AssemblyError("Can not use pc with [bp+offset]");
+        Emit(Encode(op, rd, 0, 0) | operand.value.value);
+        return;
+      case Operand::Kind::INDIRECT:
+        Emit(Encode(op, rd, operand.op1n, operand.reg));
+        return;
+      case Operand::Kind::DIRECT:
+        if (UseShortForm(operand.value, 0x40)) {
+          Emit(Encode(op, rd, 56, 0) | operand.value.value);
+        } else {
+          Emit(Encode(op, store ? 0 : rd, store ? 35 : 34, rd));
+          Emit(operand.value.value);
+        }
+        return;
+    }
+  }
+
+  void AssembleAssignment() {
+    if (!PeekReg().has_value()) {
+      if (!IsPunct("[") && !(IsWord("d") && IsPunct(":", 1)))
+        throw AssemblyError("Unknown instruction " + Peek().text);
+
+      // Store to memory, optionally of the result of an operation
+      const Operand dest = ParseMemoryOperand();
+      ExpectPunct("=");
+      if (AcceptPunct("-")) {
+        if (dest.kind != Operand::Kind::DIRECT)
+          throw AssemblyError("Operation results can only be stored to [address]");
+        const int rd = ExpectReg();
+        Emit(Encode(ALUOP_NEG, rd, 35, rd));
+        Emit(dest.value.value);
+        return;
+      }
+      const int rs = ExpectReg();
+      auto op = ParseBinaryAluOp();
+      if (!op.has_value()) {
+        EmitAlu(ALUOP_STORE, rs, dest);
+        return;
+      }
+      if (dest.kind != Operand::Kind::DIRECT)
+        throw AssemblyError("Operation results can only be stored to [address]");
+      const int rd = ExpectReg();
+      Emit(Encode(ParseCarry(*op), rd, 35, rs));
+      Emit(dest.value.value);
+      return;
+    }
+
+    const int rd = ExpectReg();
+    const Token& assign = Next();
+    if (assign.kind != Token::Kind::PUNCT)
+      throw AssemblyError("Unknown instruction");
+
+    if (assign.text == "=") {
+      // Negation of a register or memory operand, as opposed to a negative value
+      if (IsPunct("-") && (PeekReg(1).has_value() || IsPunct("[", 1) || IsWord("d", 1))) {
+        Next();
+        EmitAlu(ALUOP_NEG, rd, ParseOperand());
+        return;
+      }
+
+      const Operand operand = ParseOperand();
+      auto op = ParseBinaryAluOp();
+      if (!op.has_value()) {
+        EmitAlu(ALUOP_LOAD, rd, operand);
+        return;
+      }
+
+      // rd = rs op value and rd = rs op [address]
+      if (operand.kind != Operand::Kind::REG)
+        throw AssemblyError("Expected register before operator");
+      const Operand rhs = ParseOperand();
+      *op = ParseCarry(*op);
+      if (rhs.kind == Operand::Kind::IMM) {
+        Emit(Encode(*op, rd, 33, operand.reg));
+      } else if (rhs.kind == Operand::Kind::DIRECT) {
+        Emit(Encode(*op, rd, 34, operand.reg));
+      } else {
+        throw AssemblyError("Three-operand form needs a value or [address]");
+      }
+      Emit(rhs.value.value);
+      return;
+    }
+
+    int op;
+    if (assign.text == "+=")
+      op = ALUOP_ADD;
+    else if (assign.text == "-=")
+      op = ALUOP_SUB;
+    else if (assign.text == "^=")
+      op = ALUOP_XOR;
+    else if (assign.text == "|=")
+      op = ALUOP_OR;
+    else if (assign.text == "&=")
+      op = ALUOP_AND;
+    else
+      throw AssemblyError("Unknown instruction");
+
+    const Operand operand = ParseOperand();
+    EmitAlu(ParseCarry(op), rd, operand);
+  }
+
+  // Turns add and subtract into their with-carry forms when followed by ", carry"
+  int ParseCarry(int op) {
+    if (!AcceptPunct(","))
+      return op;
+    if (!AcceptWord("carry") || (op != ALUOP_ADD && op != ALUOP_SUB))
+      throw AssemblyError("Expected carry after addition or subtraction");
+    return op == ALUOP_ADD ? ALUOP_ADC : ALUOP_SBC;
+  }
+
+  std::optional<int> ParseBinaryAluOp() {
+    constexpr std::pair<std::string_view, int> kOps[] = {
+        {"+", ALUOP_ADD}, {"-", ALUOP_SUB}, {"^", ALUOP_XOR}, {"|", ALUOP_OR}, {"&", ALUOP_AND},
+    };
+    if (Peek().kind != Token::Kind::PUNCT)
+      return std::nullopt;
+    auto op = Lookup(kOps, Peek().text);
+    if (op.has_value())
+      Next();
+    return op;
+  }
+
+  std::span<Word> image_;
+  std::map<std::string, int64_t>& symbols_;
+  std::set<std::string> defined_in_pass1_;
+  std::vector<bool> short_forms_;
+  size_t decision_index_ = 0;
+  int pass_ = 1;
+  int64_t pc_ = 0;
+  size_t line_number_ = 0;
+  std::vector<Token> tokens_;
+  size_t pos_ = 0;
+};
+
+}  // namespace
+
+std::optional<std::string> UnspAssembler::Assemble(std::string_view source,
+                                                   std::span<Word> image) {
+  std::vector<std::string_view> lines;
+  size_t start = 0;
+  while (start <= source.size()) {
+    size_t end = source.find('\n', start);
+    if (end == std::string_view::npos)
+      end = source.size();
+    lines.push_back(source.substr(start, end - start));
+    start = end + 1;
+  }
+
+  symbols_.clear();
+  Assembly assembly(image, symbols_);
+  try {
+    assembly.RunPass(1, lines);
+    assembly.RunPass(2, lines);
+  } catch (const AssemblyError& e) {
+    return "Line " + std::to_string(assembly.GetLineNumber()) + ": " + e.what();
+  }
+  return std::nullopt;
+}
+
+const std::map<std::string, int64_t>& UnspAssembler::GetSymbols() const {
+  return symbols_;
+}
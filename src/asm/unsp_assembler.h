@@ -0,0 +1,38 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "core/common.h"
+
+// Two-pass assembler for the unSP instruction set, using the same operand syntax as common
+// disassemblers, for example:
+//
+//   .org 0x8000
+//   start:  sp = 0x27ff
+//           r1 = [bp+2]
+//           r2 += r1 lsl 2
+//           [0x3d21] = r1
+//           push r1, r4 to [sp]
+//           mr = [r1] * [r2], 16
+//           jne start
+//   .org 0xfff7
+//   .dw start
+//
+// Directives are .org, .dw, .fill COUNT[, VALUE] and .equ NAME, VALUE. Expressions may use
+// labels, $ for the current address and the usual C operators. Comments start with ; or //.
+class UnspAssembler {
+public:
+  // Assembles into the image, leaving words not written by the source unchanged. Errors are
+  // returned with the number of the line they were found on.
+  std::optional<std::string> Assemble(std::string_view source, std::span<Word> image);
+
+  // Labels and .equ constants of the last assembled source
+  const std::map<std::string, int64_t>& GetSymbols() const;
+
+private:
+  std::map<std::string, int64_t> symbols_;
+};
@@ -0,0 +1,295 @@
+#include "unsp_disassembler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <optional>
+
+namespace {
+
+enum Reg { REG_SP = 0, REG_BP = 5, REG_SR = 6, REG_PC = 7 };
+
+enum AluOp {
+  ALUOP_ADD = 0,
+  ALUOP_ADC = 1,
+  ALUOP_SUB = 2,
+  ALUOP_SBC = 3,
+  ALUOP_CMP = 4,
+  ALUOP_NEG = 6,
+  ALUOP_XOR = 8,
+  ALUOP_LOAD = 9,
+  ALUOP_OR = 10,
+  ALUOP_AND = 11,
+  ALUOP_TEST = 12,
+  ALUOP_STORE = 13,
+};
+
+constexpr const char* kRegNames[] = {"sp", "r1", "r2", "r3", "r4", "bp", "sr", "pc"};
+
+constexpr const char* kBranchNames[] = {"jb",  "jae", "jge", "jl",  "jne", "je",  "jpl", "jmi",
+                                        "jbe", "ja",  "jle", "jg",  "jvc", "jvs", "jmp"};
+
+constexpr const char* kShiftNames[] = {"asr", "lsl", "lsr", "rol", "ror"};
+
+std::string Hex(unsigned value, int digits) {
+  char text[16];
+  std::snprintf(text, sizeof text, "0x%0*x", digits, value);
+  return text;
+}
+
+std::string Address(unsigned value, int digits) {
+  char text[16];
+  std::snprintf(text, sizeof text, "[0x%0*x]", digits, value);
+  return text;
+}
+
+DisassembledInstruction Invalid(Word word) {
+  return {".dw " + Hex(word, 4), 1, false};
+}
+
+// Encodings that the text would assemble to a different instruction from, as .dw with the text
+// as a comment
+DisassembledInstruction Verbatim(const std::string& text, Word word0, Word word1, int words) {
+  std::string directive = ".dw " + Hex(word0, 4);
+  if (words == 2)
+    directive += ", " + Hex(word1, 4);
+  return {directive + "  ; " + text, words};
+}
+
+// Operator for the three-operand form, where the ALU op combines two values into rd
+std::optional<std::string> BinaryOperator(int op) {
+  switch (op) {
+    case ALUOP_ADD:
+    case ALUOP_ADC:
+      return "+";
+    case ALUOP_SUB:
+    case ALUOP_SBC:
+      return "-";
+    case ALUOP_XOR:
+      return "^";
+    case ALUOP_OR:
+      return "|";
+    case ALUOP_AND:
+      return "&";
+    default:
+      return std::nullopt;
+  }
+}
+
+std::string CarrySuffix(int op) {
+  return op == ALUOP_ADC || op == ALUOP_SBC ? ", carry" : "";
+}
+
+// rd op= operand, for all ALU ops the CPU executes
+std::optional<std::string> AluText(int op, int rd, const std::string& operand) {
+  const std::string reg = kRegNames[rd];
+  switch (op) {
+    case ALUOP_LOAD:
+      return reg + " = " + operand;
+    case ALUOP_NEG:
+      return reg + " = -" + operand;
+    case ALUOP_CMP:
+      return "cmp " + reg + ", " + operand;
+    case ALUOP_TEST:
+      return "test " + reg + ", " + operand;
+    case ALUOP_STORE:
+      return operand + " = " + reg;
+    default:
+      break;
+  }
+  auto op_text = BinaryOperator(op);
+  if (!op_text.has_value())
+    return std::nullopt;
+  return reg + " " + *op_text + "= " + operand + CarrySuffix(op);
+}
+
+// rd = rs op value, where value is an immediate or [address]
+std::optional<std::string> ThreeOperandText(int op, int rd, int rs, const std::string& value) {
+  if (rd == rs || op == ALUOP_LOAD || op == ALUOP_NEG)
+    return AluText(op, rd, value);
+  if (op == ALUOP_CMP || op == ALUOP_TEST)
+    return AluText(op, rs, value);
+  auto op_text = BinaryOperator(op);
+  if (!op_text.has_value())
+    return std::nullopt;
+  return std::string(kRegNames[rd]) + " = " + kRegNames[rs] + " " + *op_text + " " + value +
+         CarrySuffix(op);
+}
+
+DisassembledInstruction DisassembleSpecial(Word word0, Word word1) {
+  const int rd = (word0 >> 9) & 7;
+  const int op1 = (word0 >> 6) & 7;
+  const int opn = (word0 >> 3) & 7;
+  const int rs = word0 & 7;
+  const int imm6 = word0 & 0x3f;
+  const std::string regs = std::string(kRegNames[rd]) + " * " + kRegNames[rs];
+  const std::string mem_regs = std::string("[") + kRegNames[rd] + "] * [" + kRegNames[rs] + "]";
+  const int muls_n = (word0 >> 3) & 0xf ? (word0 >> 3) & 0xf : 16;
+  const bool uses_pc = rd == REG_PC || rs == REG_PC;
+
+  switch (op1) {
+    case 0:
+      if (!uses_pc && opn == 1)
+        return {"mr = " + regs + ", us"};
+      break;
+    case 1:
+      return {"call " + Hex((imm6 << 16) | word1, 6), 2};
+    case 2:
+    case 3:
+      if (op1 == 2 && rd == REG_PC)
+        return {"goto " + Hex((imm6 << 16) | word1, 6), 2};
+      if (!uses_pc)
+        return {"mr = " + mem_regs + ", us, " + std::to_string(muls_n)};
+      break;
+    case 4:
+      if (!uses_pc && opn == 1)
+        return {"mr = " + regs};
+      break;
+    case 5:
+      switch (imm6) {
+        case 0:
+          return {"int off"};
+        case 1:
+          return {"int irq"};
+        case 2:
+          return {"int fiq"};
+        case 3:
+          return {"int fiq, irq"};
+        case 4:
+          return {"fir_mov on"};
+        case 5:
+          return {"fir_mov off"};
+        case 8:
+          return {"irq off"};
+        case 9:
+          return {"irq on"};
+        case 12:
+          return {"fiq off"};
+        case 14:
+          return {"fiq on"};
+        case 32:
+        case 40:
+        case 48:
+        case 56:
+          return {"break"};
+        case 37:
+          return {"nop"};
+      }
+      break;
+    case 6:
+    case 7:
+      if (!uses_pc)
+        return {"mr = " + mem_regs + ", " + std::to_string(muls_n)};
+      break;
+  }
+  return Invalid(word0);
+}
+
+DisassembledInstruction DisassembleAlu(Addr address, Word word0, Word word1) {
+  const int op0 = word0 >> 12;
+  const int rd = (word0 >> 9) & 7;
+  const int op1n = (word0 >> 3) & 0x3f;
+  const int opn = (word0 >> 3) & 7;
+  const int rs = word0 & 7;
+  const int imm6 = word0 & 0x3f;
+  const std::string rs_name = kRegNames[rs];
+
+  std::optional<std::string> text;
+  int words = 1;
+  // Whether the text assembles to an instruction of the same length and timing. Fields that the
+  // CPU ignores may still differ.
+  bool equivalent = true;
+  // The assembler picks the short form for values that fit in 6 bits, except for three-operand
+  // forms and loads of immediates into pc
+  const bool alu_form = rd == rs || op0 == ALUOP_LOAD || op0 == ALUOP_NEG || op0 == ALUOP_CMP ||
+                        op0 == ALUOP_TEST;
+  const int alu_reg = op0 == ALUOP_CMP || op0 == ALUOP_TEST ? rs : rd;
+  const bool short_value = word1 < 0x40;
+  // Compares are written with rs, and assembled with it as rd too, but rd being pc decides the
+  // timing and whether flags are set
+  const bool compare_matches = alu_reg == rd || (rd == REG_PC) == (rs == REG_PC);
+  if (op1n < 16 && rd == REG_PC) {
+    const Addr target = op1n < 8 ? address + 1 + imm6 : address + 1 - imm6;
+    return {std::string(kBranchNames[op0]) + " " + Hex(target & 0x3fffff, 6)};
+  } else if (op1n < 8) {
+    text = AluText(op0, rd, "[bp+" + std::to_string(imm6) + "]");
+  } else if (op1n < 16) {
+    // Negated immediates read back as loads of negative values
+    equivalent = op0 != ALUOP_NEG;
+    if (op0 != ALUOP_STORE)
+      text = AluText(op0, rd, std::to_string(imm6));
+  } else if (op1n < 24) {
+    if (op0 == ALUOP_LOAD && rd == REG_BP && rs == REG_SP && opn == 2) {
+      text = "retf";
+    } else if (op0 == ALUOP_LOAD && rd == REG_BP && rs == REG_SP && opn == 3) {
+      text = "reti";
+    } else if (op0 == ALUOP_LOAD && opn > 0 && rd < REG_PC) {
+      // The CPU stops at the last register, but still takes cycles for the whole count
+      const int last = std::min(rd + opn, 7);
+      equivalent = last == rd + opn;
+      text = std::string("pop ") + kRegNames[rd + 1] + ", " + kRegNames[last] + " from [" +
+             rs_name + "]";
+    } else if (op0 == ALUOP_STORE && opn > 0) {
+      const int first = std::max(rd - opn + 1, 0);
+      equivalent = first == rd - opn + 1;
+      text = std::string("push ") + kRegNames[first] + ", " + kRegNames[rd] + " to [" + rs_name +
+             "]";
+    }
+  } else if (op1n < 32) {
+    constexpr const char* kFormats[] = {"[%s]", "[%s--]", "[%s++]", "[++%s]"};
+    char operand[16];
+    std::snprintf(operand, sizeof operand, kFormats[op1n & 3], rs_name.c_str());
+    text = AluText(op0, rd, (op1n >= 28 ? "d:" : "") + std::string(operand));
+  } else if (op1n == 32) {
+    if (op0 != ALUOP_STORE)
+      text = AluText(op0, rd, rs_name);
+  } else if (op1n == 33) {
+    words = 2;
+    equivalent =
+        op0 != ALUOP_NEG && compare_matches && !(alu_form && alu_reg != REG_PC && short_value);
+    if (op0 != ALUOP_STORE)
+      text = ThreeOperandText(op0, rd, rs, Hex(word1, 4));
+  } else if (op1n == 34) {
+    words = 2;
+    equivalent = compare_matches && !(alu_form && short_value);
+    if (op0 != ALUOP_STORE)
+      text = ThreeOperandText(op0, rd, rs, Address(word1, 4));
+  } else if (op1n == 35) {
+    words = 2;
+    // Stores take a cycle longer with pc as the unused rd. Loads, which also set flags, have no
+    // syntax of their own.
+    const std::string dest = Address(word1, 4);
+    if (op0 == ALUOP_STORE) {
+      equivalent = rd != REG_PC && !short_value;
+      text = dest + " = " + rs_name;
+    } else if (op0 == ALUOP_LOAD) {
+      equivalent = false;
+      text = dest + " = " + kRegNames[rd];
+    } else if (op0 == ALUOP_NEG) {
+      text = dest + " = -" + kRegNames[rd];
+    } else if (auto op_text = BinaryOperator(op0); op_text.has_value()) {
+      text = dest + " = " + rs_name + " " + *op_text + " " + kRegNames[rd] + CarrySuffix(op0);
+    }
+  } else if (op1n < 56) {
+    if (op0 != ALUOP_STORE) {
+      const std::string shift = rs_name + " " + kShiftNames[(op1n - 36) / 4] + " " +
+                                std::to_string((op1n & 3) + 1);
+      text = AluText(op0, rd, shift);
+    }
+  } else {
+    text = AluText(op0, rd, Address(imm6, 2));
+  }
+
+  if (!text.has_value())
+    return Invalid(word0);
+  if (!equivalent)
+    return Verbatim(*text, word0, word1, words);
+  return {*text, words};
+}
+
+}  // namespace
+
+DisassembledInstruction DisassembleInstruction(Addr address, Word word0, Word word1) {
+  if ((word0 >> 12) == 0xf)
+    return DisassembleSpecial(word0, word1);
+  return DisassembleAlu(address, word0, word1);
+}
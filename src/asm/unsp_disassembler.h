@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+#include "core/common.h"
+
+struct DisassembledInstruction {
+  std::string text;
+  // Number of words used, 1 or 2
+  int words = 1;
+  // Whether the words were decoded as an instruction, including those shown as .dw
+  bool decoded = true;
+};
+
+// Disassembles the instruction at the address, in the syntax accepted by UnspAssembler. The
+// second word is only used by instructions with a 16-bit immediate or address. Words that the CPU
+// does not execute, and the few encodings that only store a constant, are shown as .dw directives.
+// So are encodings whose text would assemble to an instruction of another length or timing, such
+// as push and pop counting more registers than exist, followed by the text as a comment. All
+// other text assembles to the same instruction, apart from fields that the CPU ignores.
+DisassembledInstruction DisassembleInstruction(Addr address, Word word0, Word word1);
@@ -0,0 +1,70 @@
+#include "bench_json.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+std::string JsonString(std::string_view str) {
+  std::ostringstream out;
+  out << '"';
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+          << std::dec;
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+  return out.str();
+}
+
+bool ReadBaseline(const std::string& path, std::string_view key,
+                  std::map<std::string, double>& values) {
+  std::ifstream in(path);
+  if (!in)
+    return false;
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  const std::string json = buffer.str();
+
+  auto value_start = [&json](size_t key_pos, size_t key_size) {
+    size_t pos = key_pos + key_size;
+    while (pos < json.size() && (json[pos] == ' ' || json[pos] == ':')) {
+      pos++;
+    }
+    return pos;
+  };
+
+  const std::string name_key = "\"name\"";
+  std::string value_key = "\"";
+  value_key.append(key);
+  value_key += '"';
+  size_t pos = 0;
+  while ((pos = json.find(name_key, pos)) != std::string::npos) {
+    pos = value_start(pos, name_key.size());
+    if (pos >= json.size() || json[pos] != '"')
+      return false;
+
+    std::string name;
+    for (pos++; pos < json.size() && json[pos] != '"'; pos++) {
+      if (json[pos] == '\\' && pos + 1 < json.size())
+        pos++;
+      name += json[pos];
+    }
+
+    pos = json.find(value_key, pos);
+    if (pos == std::string::npos)
+      return false;
+    pos = value_start(pos, value_key.size());
+    char* end;
+    const double value = std::strtod(json.c_str() + pos, &end);
+    if (end == json.c_str() + pos)
+      return false;
+    values[name] = value;
+  }
+  return true;
+}
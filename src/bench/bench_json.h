@@ -0,0 +1,14 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+
+// Quotes and escapes a string for JSON output
+std::string JsonString(std::string_view str);
+
+// Reads one number per named entry from JSON results written by the benchmark tools, which
+// list entries as objects with a "name" member followed by the member given by key. Only this
+// structure is understood.
+bool ReadBaseline(const std::string& path, std::string_view key,
+                  std::map<std::string, double>& values);
@@ -0,0 +1,227 @@
+#include "bench_workloads.h"
+
+#include <stdexcept>
+
+#include "asm/unsp_assembler.h"
+
+namespace {
+
+constexpr Addr kSample = 0x9000;
+constexpr Addr kTiles = 0x10000;
+
+// Assembles the program to run from reset at 0x8000, after setting up the stack
+std::shared_ptr<VSmile::CartRomType> AssembleCart(std::shared_ptr<VSmile::CartRomType> cart,
+                                                  std::string_view program) {
+  const std::string source = ".equ SAMPLE, " + std::to_string(kSample) +
+                             "\n.equ TILES, " + std::to_string(kTiles) +
+                             "\n.org 0xfff7\n.dw reset\n.org 0x8000\nreset: sp = 0x27ff\n" +
+                             std::string(program);
+  if (auto error = UnspAssembler().Assemble(source, *cart); error.has_value())
+    throw std::runtime_error("Invalid workload program: " + *error);
+  return cart;
+}
+
+// Nothing but a jump to itself, leaving the fixed cost of each frame
+std::shared_ptr<VSmile::CartRomType> MakeIdleCart() {
+  return AssembleCart(std::make_shared<VSmile::CartRomType>(), R"(
+halt:   jmp halt
+)");
+}
+
+// Loop of register, memory, stack, multiply and call instructions
+std::shared_ptr<VSmile::CartRomType> MakeCpuCart() {
+  return AssembleCart(std::make_shared<VSmile::CartRomType>(), R"(
+        bp = 0x0100
+        r1 = 0
+        r2 = 1
+loop:   r2 += r1
+        r3 ^= r2
+        r4 = r1 lsl 2
+        r4 += r2 asr 1
+        [bp+1] = r2
+        r3 += [bp+1]
+        [0x0200] = r3
+        r4 = [0x0200]
+        mr = r1 * r2
+        push r1, r2 to [sp]
+        pop r1, r2 from [sp]
+        call subroutine
+        r1 += 1
+        test r1, 1
+        je skip
+        r2 |= 0x1234
+skip:   jmp loop
+
+subroutine:
+        r2 += 3
+        retf
+)");
+}
+
+// All 16 channels playing looped PCM at different pitches, with a timer interrupt
+std::shared_ptr<VSmile::CartRomType> MakeAudioCart() {
+  auto cart = std::make_shared<VSmile::CartRomType>();
+  auto& c = *cart;
+  for (int i = 0; i < 0x100; i++) {
+    c[kSample + i] = ((i * 37) & 0x7f) | (((i * 91) & 0x7f) << 8);
+  }
+  c[kSample + 0x100] = 0xffff;
+
+  return AssembleCart(cart, R"(
+        bp = 0x3000
+        r2 = 0x0800
+channel_loop:
+        r1 = SAMPLE
+        [bp+0] = r1
+        [bp+2] = r1
+        r1 = 0x2000
+        [bp+1] = r1
+        r1 = 0x4040
+        [bp+3] = r1
+        r1 = 0x007f
+        [bp+5] = r1
+        r1 = bp + 0x0204
+        [r1] = r2
+        r2 += 0x0100
+        bp += 0x10
+        cmp bp, 0x3100
+        jne channel_loop
+
+        ; Envelopes are left at the initial volume
+        r1 = 0xffff
+        [0x3415] = r1
+        r1 = 0x007f
+        [0x3401] = r1
+        r1 = 0xffff
+        [0x3400] = r1
+
+        ; Timer A interrupt
+        r1 = 0xff00
+        [0x3d12] = r1
+        r1 = 0x0032
+        [0x3d13] = r1
+        r1 = 0x0001
+        [0x3d14] = r1
+        r1 = 0x0800
+        [0x3d21] = r1
+        int irq
+halt:   jmp halt
+
+irq_handler:
+        push r1, r4 to [sp]
+        r1 = [0x0101]
+        r1 += 3
+        [0x0101] = r1
+        r1 = 0x0800
+        [0x3d22] = r1
+        pop r1, r4 from [sp]
+        reti
+
+.org 0xfffa
+.dw irq_handler
+)");
+}
+
+// Two scrolling 16x16 tile layers, one blended, and 256 sprites in all layers
+std::shared_ptr<VSmile::CartRomType> MakeVideoCart() {
+  auto cart = std::make_shared<VSmile::CartRomType>();
+  uint32_t seed = 1;
+  for (int i = 0; i < 17 * 64; i++) {
+    seed = seed * 1103515245 + 12345;
+    (*cart)[kTiles + i] = seed >> 16;
+  }
+
+  return AssembleCart(cart, R"(
+.equ TILE_MAP, 0x1000
+
+        ; Palette of opaque colors
+        r1 = 0x2b00
+        r2 = 0
+palette_loop:
+        [r1++] = r2
+        r2 += 0x0421
+        r2 &= 0x7fff
+        cmp r1, 0x2c00
+        jne palette_loop
+
+        ; Tile maps can only be in RAM. Both layers share a map of tiles 1 to 16.
+        r1 = TILE_MAP
+        r2 = 0
+tile_map_loop:
+        r3 = r2
+        r3 &= 15
+        r3 += 1
+        [r1++] = r3
+        r2 += 7
+        cmp r1, TILE_MAP + 32 * 16
+        jne tile_map_loop
+
+        ; 4 bits per pixel, 16x16 tiles, with the attribute from the registers
+        r1 = 0x0051
+        [0x2812] = r1
+        r1 = 0x000a
+        [0x2813] = r1
+        r1 = TILE_MAP
+        [0x2814] = r1
+        r1 = TILES >> 6
+        [0x2820] = r1
+        r1 = 0x1151
+        [0x2818] = r1
+        r1 = 0x010a
+        [0x2819] = r1
+        r1 = TILE_MAP
+        [0x281a] = r1
+        r1 = TILES >> 6
+        [0x2821] = r1
+        r1 = 0x0002
+        [0x282a] = r1
+
+        ; Sprite i uses tile i % 16 + 1, with layer and blending from the low bits of i
+        r1 = TILES >> 6
+        [0x2822] = r1
+        r1 = 0x2c00
+        r2 = 0
+        r4 = 0
+        bp = 0
+sprite_loop:
+        r3 = r2
+        r3 &= 15
+        r3 += 1
+        [r1++] = r3
+        r4 += 37
+        [r1++] = r4
+        bp += 23
+        [r1++] = bp
+        r3 = r2
+        r3 &= 7
+        r3 = r3 lsl 4
+        r3 = r3 lsl 4
+        r3 = r3 lsl 4
+        r3 |= 0x0051
+        [r1++] = r3
+        r2 += 1
+        cmp r2, 0x0100
+        jne sprite_loop
+        r1 = 0x0001
+        [0x2842] = r1
+
+        ; Scroll both layers continuously
+        r2 = 0
+scroll_loop:
+        r2 += 1
+        [0x2810] = r2
+        [0x2817] = r2
+        jmp scroll_loop
+)");
+}
+
+}  // namespace
+
+std::vector<BenchWorkload> MakeSyntheticWorkloads() {
+  return {
+      {"idle", "Jump to itself, with nothing enabled", MakeIdleCart()},
+      {"cpu", "Loop of ALU, memory, stack, multiply and call instructions", MakeCpuCart()},
+      {"audio", "16 looping PCM channels and a timer interrupt", MakeAudioCart()},
+      {"video", "Two scrolling tile layers and 256 sprites", MakeVideoCart()},
+  };
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/vsmile/vsmile.h"
+
+// Cartridge images generated in code, each stressing one part of the emulator while the rest
+// stays mostly idle
+struct BenchWorkload {
+  std::string name;
+  std::string description;
+  std::shared_ptr<const VSmile::CartRomType> cartrom;
+};
+
+std::vector<BenchWorkload> MakeSyntheticWorkloads();
@@ -0,0 +1,465 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "asm/unsp_assembler.h"
+#include "bench_json.h"
+#include "core/spg200/bus_interface.h"
+#include "core/spg200/cpu.h"
+#include "core/spg200/irq.h"
+#include "core/spg200/ppu.h"
+#include "core/spg200/spu.h"
+
+// Drives single components with synthetic state through a flat memory bus, and reports the
+// time per instruction, pixel or sample. The PPU is run one scanline and the SPU one sample
+// per call, so the time is that of drawing lines and generating samples plus a small fixed
+// cost per call.
+
+namespace {
+
+struct Options {
+  int repeat = 9;
+  std::optional<std::string> filter;
+  std::optional<std::string> json_path;
+  std::optional<std::string> baseline_path;
+  double threshold_percent = 5;
+};
+
+// Plain memory covering the whole address space, without any registers
+class MockBus : public BusInterface {
+public:
+  MockBus() : memory_(0x400000) {}
+
+  Word ReadWord(Addr addr) override {
+    return memory_[addr & 0x3fffff];
+  }
+
+  void WriteWord(Addr addr, Word value) override {
+    memory_[addr & 0x3fffff] = value;
+  }
+
+  std::span<Word> GetMemory() {
+    return memory_;
+  }
+
+private:
+  std::vector<Word> memory_;
+};
+
+struct Machine {
+  MockBus bus;
+  Cpu cpu{bus};
+  Irq irq{cpu};
+};
+
+struct BenchCase {
+  std::string name;
+  std::string unit;
+  // Runs a fixed amount of work and returns the number of units done
+  std::function<uint64_t()> run;
+};
+
+struct CaseResult {
+  std::string name;
+  std::string unit;
+  double ns_per_unit = 0;
+  double median_ns_per_unit = 0;
+  std::optional<double> baseline_ns_per_unit;
+  bool regression = false;
+};
+
+constexpr Addr kCode = 0x8000;
+constexpr Addr kSubroutine = 0x8800;
+constexpr Addr kData = 0x0200;
+constexpr Addr kTileMap = 0x1000;
+constexpr Addr kBitmapLinesLo = 0x1000;
+constexpr Addr kBitmapLinesHi = 0x1200;
+constexpr Addr kSample = 0x9000;
+constexpr Addr kTiles = 0x10000;
+constexpr Addr kBitmap = 0x20000;
+constexpr int kScanlineCycles = 432 * 4;
+constexpr int kSampleCycles = 96;
+
+void FillRandom(std::span<Word> memory, uint32_t seed, Word mask = 0xffff) {
+  for (auto& word : memory) {
+    seed = seed * 1103515245 + 12345;
+    word = (seed >> 16) & mask;
+  }
+}
+
+// Each program sets up its registers and loops forever
+BenchCase MakeCpuCase(const std::string& name, std::string_view loop) {
+  auto machine = std::make_shared<Machine>();
+  auto memory = machine->bus.GetMemory();
+  FillRandom(memory.subspan(kData, 0x100), 1);
+
+  const std::string source = ".equ DATA, " + std::to_string(kData) + "\n.org 0xfff7\n.dw " +
+                             std::to_string(kCode) + "\n.org " + std::to_string(kCode) +
+                             "\nsp = 0x27ff\nbp = DATA\nloop:\n" + std::string(loop) +
+                             "\njmp loop\n.org " + std::to_string(kSubroutine) +
+                             "\nsubroutine: r4 += 1\nretf\n";
+  if (auto error = UnspAssembler().Assemble(source, memory); error.has_value())
+    throw std::runtime_error("Invalid program for " + name + ": " + *error);
+
+  machine->cpu.Reset();
+  return {name, "instruction", [machine] {
+            constexpr int kInstructions = 2000000;
+            for (int i = 0; i < kInstructions; i++) {
+              machine->cpu.Step();
+            }
+            return kInstructions;
+          }};
+}
+
+void AddCpuCases(std::vector<BenchCase>& cases) {
+  cases.push_back(MakeCpuCase("cpu/alu", R"(
+        r1 += r2
+        r2 ^= r3
+        r3 -= 5
+        r4 = r1 lsl 2
+        r4 |= 0x1234
+        r2 += r4 asr 1
+        cmp r1, r4
+        r3 &= 0x0ff0
+)"));
+
+  // Branches taken every other time, never and always
+  cases.push_back(MakeCpuCase("cpu/branch", R"(
+        r1 += 1
+        test r1, 1
+        je skip1
+        r2 += 1
+skip1:  cmp r1, 0
+        je skip2
+        r3 += 1
+skip2:  test r1, 0
+        je skip3
+        r4 += 1
+skip3:
+)"));
+
+  cases.push_back(MakeCpuCase("cpu/memory", R"(
+        [bp+1] = r1
+        r2 = [bp+2]
+        [DATA + 0x80] = r2
+        r3 = [DATA + 0x81]
+        r4 = DATA + 0x10
+        r1 += [r4++]
+        r2 ^= [r4++]
+        [r4++] = r1
+)"));
+
+  cases.push_back(MakeCpuCase("cpu/muls", R"(
+        r1 = DATA
+        r2 = DATA + 0x40
+        mr = [r1] * [r2], 16
+        r1 = DATA + 0x80
+        r2 = DATA + 0xc0
+        mr = [r1] * [r2], 4
+        mr = r3 * r4
+)"));
+
+  cases.push_back(MakeCpuCase("cpu/stack", R"(
+        push r1, r4 to [sp]
+        pop r1, r4 from [sp]
+        push r2, r3 to [sp]
+        pop r2, r3 from [sp]
+        call subroutine
+)"));
+}
+
+struct PpuMachine : Machine {
+  Ppu ppu{VideoTiming::PAL, bus, irq};
+};
+
+struct SpriteSetup {
+  int count = 0;
+  int bits_per_pixel = 4;
+  bool blend = false;
+};
+
+// Tiles are 16x16, with 16 different ones from 1 to 16
+struct BgSetup {
+  int bits_per_pixel = 4;
+  bool blend = false;
+  bool bitmap = false;
+};
+
+BenchCase MakePpuCase(const std::string& name, std::vector<BgSetup> bgs, SpriteSetup sprites) {
+  auto machine = std::make_shared<PpuMachine>();
+  auto memory = machine->bus.GetMemory();
+  auto& ppu = machine->ppu;
+  ppu.Reset();
+
+  FillRandom(memory.subspan(kTiles, 17 * 16 * 16), 2);
+  for (int i = 0; i < 256; i++) {
+    ppu.SetPaletteColor(i, (i * 0x1ce7) & 0x7fff);
+  }
+  ppu.SetBlendLevel(2);
+
+  for (size_t bg = 0; bg < bgs.size(); bg++) {
+    const auto& setup = bgs[bg];
+    const int color_mode = setup.bits_per_pixel / 2 - 1;
+    if (setup.bitmap) {
+      // 16-bit color bitmap with lines 512 words apart
+      FillRandom(memory.subspan(kBitmap, 256 * 512), 3, 0x7fff);
+      for (int y = 0; y < 256; y++) {
+        const Addr line = kBitmap + y * 512;
+        memory[kBitmapLinesLo + y] = line & 0xffff;
+        memory[kBitmapLinesHi + y / 2] |= (line >> 16) << ((y & 1) ? 8 : 0);
+      }
+      ppu.SetBgTileMapPtr(bg, kBitmapLinesLo);
+      ppu.SetBgAttributeMapPtr(bg, kBitmapLinesHi);
+      ppu.SetBgAttribute(bg, bg << 12);
+      ppu.SetBgControl(bg, 0x0089 | (setup.blend << 8));
+      continue;
+    }
+
+    for (int i = 0; i < 32 * 16; i++) {
+      memory[kTileMap + i] = 1 + (i * 7 + bg) % 16;
+    }
+    ppu.SetBgTileMapPtr(bg, kTileMap);
+    ppu.SetBgSegmentPtr(bg, kTiles >> 6);
+    ppu.SetBgAttribute(bg, color_mode | 0x0050 | (bg << 12));
+    ppu.SetBgControl(bg, 0x000a | (setup.blend << 8));
+    ppu.SetBgXScroll(bg, bg * 5);
+  }
+
+  ppu.SetSpriteSegmentPtr(kTiles >> 6);
+  ppu.SetSpriteControl(sprites.count > 0);
+  const int sprite_color_mode = sprites.bits_per_pixel / 2 - 1;
+  for (int i = 0; i < sprites.count; i++) {
+    const bool blend = sprites.blend && (i & 1);
+    ppu.WriteSpriteMemory(i * 4 + 0, 1 + i % 16);
+    ppu.WriteSpriteMemory(i * 4 + 1, (i * 37) % 320 - 160);
+    ppu.WriteSpriteMemory(i * 4 + 2, (i * 23) % 240 - 112);
+    ppu.WriteSpriteMemory(i * 4 + 3,
+                          sprite_color_mode | 0x0050 | ((i & 3) << 12) | (blend << 14));
+  }
+
+  return {name, "pixel", [machine] {
+            constexpr int kFrames = 20;
+            for (int i = 0; i < kFrames * 312; i++) {
+              machine->ppu.RunCycles(kScanlineCycles);
+            }
+            return kFrames * 240 * 320;
+          }};
+}
+
+void AddPpuCases(std::vector<BenchCase>& cases) {
+  cases.push_back(MakePpuCase("ppu/empty", {}, {}));
+  cases.push_back(MakePpuCase("ppu/bg_2bpp", {{.bits_per_pixel = 2}}, {}));
+  cases.push_back(MakePpuCase("ppu/bg_4bpp", {{.bits_per_pixel = 4}}, {}));
+  cases.push_back(MakePpuCase("ppu/bg_8bpp", {{.bits_per_pixel = 8}}, {}));
+  cases.push_back(MakePpuCase("ppu/bg_bitmap_16bpp", {{.bitmap = true}}, {}));
+  cases.push_back(MakePpuCase("ppu/bg_4bpp_x2_blend", {{}, {.blend = true}}, {}));
+  cases.push_back(MakePpuCase("ppu/sprites_16", {}, {.count = 16}));
+  cases.push_back(MakePpuCase("ppu/sprites_64", {}, {.count = 64}));
+  cases.push_back(MakePpuCase("ppu/sprites_256", {}, {.count = 256}));
+  cases.push_back(MakePpuCase("ppu/sprites_64_8bpp", {}, {.count = 64, .bits_per_pixel = 8}));
+  cases.push_back(MakePpuCase("ppu/sprites_256_blend", {}, {.count = 256, .blend = true}));
+  cases.push_back(MakePpuCase("ppu/bg_x2_sprites_256", {{}, {.blend = true}}, {.count = 256}));
+}
+
+struct SpuMachine : Machine {
+  Spu spu{bus, irq};
+};
+
+// Channels loop over the same 256 word sample at different pitches, reading a new word every
+// 8 to 16 samples
+BenchCase MakeSpuCase(const std::string& name, int channels, bool adpcm, bool mixing) {
+  auto machine = std::make_shared<SpuMachine>();
+  auto memory = machine->bus.GetMemory();
+  auto& spu = machine->spu;
+  spu.Reset();
+  spu.SetMixingEnabled(mixing);
+
+  FillRandom(memory.subspan(kSample, 0x100), 4, adpcm ? 0xfffe : 0x7f7f);
+  memory[kSample + 0x100] = 0xffff;
+
+  for (int channel = 0; channel < channels; channel++) {
+    spu.SetWaveAddressLo(channel, kSample);
+    spu.SetMode(channel, adpcm ? 0xa000 : 0x2000);
+    spu.SetLoopAddressLo(channel, kSample);
+    spu.SetPan(channel, 0x4040);
+    spu.SetEnvelopeData(channel, 0x007f);
+    spu.SetPhaseHi(channel, 1);
+    spu.SetPhaseLo(channel, channel * 0x1000);
+  }
+  spu.SetChannelEnvMode(0xffff);
+  spu.SetMainVolume(0x007f);
+  spu.SetChannelEnable((1 << channels) - 1);
+
+  return {name, "sample", [machine] {
+            constexpr int kSamples = 200000;
+            for (int i = 0; i < kSamples; i++) {
+              machine->spu.RunCycles(kSampleCycles);
+              if (i % 4096 == 0)
+                machine->spu.GetAudio();
+            }
+            return kSamples;
+          }};
+}
+
+void AddSpuCases(std::vector<BenchCase>& cases) {
+  cases.push_back(MakeSpuCase("spu/pcm_1", 1, false, true));
+  cases.push_back(MakeSpuCase("spu/pcm_4", 4, false, true));
+  cases.push_back(MakeSpuCase("spu/pcm_16", 16, false, true));
+  cases.push_back(MakeSpuCase("spu/adpcm_16", 16, true, true));
+  cases.push_back(MakeSpuCase("spu/pcm_16_unmixed", 16, false, false));
+}
+
+// The fastest repetition is reported, as it is the least disturbed by the rest of the system
+CaseResult RunCase(const BenchCase& bench_case, int repeat) {
+  using Clock = std::chrono::steady_clock;
+
+  bench_case.run();  // warm up caches and branch predictors
+  std::vector<double> ns_per_unit;
+  for (int i = 0; i < repeat; i++) {
+    const auto start = Clock::now();
+    const uint64_t units = bench_case.run();
+    const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    ns_per_unit.push_back(elapsed.count() / units);
+  }
+  std::sort(ns_per_unit.begin(), ns_per_unit.end());
+
+  CaseResult result;
+  result.name = bench_case.name;
+  result.unit = bench_case.unit;
+  result.ns_per_unit = ns_per_unit.front();
+  result.median_ns_per_unit = ns_per_unit[ns_per_unit.size() / 2];
+  return result;
+}
+
+bool WriteJson(const std::string& path, const std::vector<CaseResult>& results) {
+  std::ofstream out(path);
+  if (!out)
+    return false;
+
+  out << std::setprecision(6) << "{" << std::endl << "  \"benchmarks\": [" << std::endl;
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto& result = results[i];
+    out << "    {\"name\": " << JsonString(result.name)
+        << ", \"unit\": " << JsonString(result.unit) << ", \"ns_per_unit\": " << result.ns_per_unit
+        << ", \"median_ns_per_unit\": " << result.median_ns_per_unit << "}"
+        << (i + 1 < results.size() ? "," : "") << std::endl;
+  }
+  out << "  ]" << std::endl << "}" << std::endl;
+  return out.good();
+}
+
+void PrintUsage(std::string exec_name) {
+  std::cerr << "Usage: " << exec_name << " [options]" << std::endl
+            << std::endl
+            << "  -repeat N         Number of timed repetitions per benchmark (default 9)"
+            << std::endl
+            << "  -filter TEXT      Only run benchmarks with TEXT in their name" << std::endl
+            << "  -json FILE        Write results to FILE as JSON" << std::endl
+            << "  -baseline FILE    Compare with results from an earlier -json FILE" << std::endl
+            << "  -threshold PCT    Slowdown from the baseline counted as a regression "
+               "(default 5)"
+            << std::endl;
+}
+
+template <typename T>
+bool ParseNumber(std::string_view str, T& value) {
+  auto [ptr, error] = std::from_chars(str.data(), str.data() + str.size(), value);
+  return ptr == str.data() + str.size() && error == std::errc();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+
+  const std::vector<std::string_view> args(argv + 1, argv + argc);
+  for (size_t i = 0; i < args.size(); i++) {
+    const auto& arg = args[i];
+    const bool has_value = i + 1 < args.size();
+    bool valid = true;
+    if (arg == "-repeat" && has_value) {
+      valid = ParseNumber(args[++i], options.repeat) && options.repeat > 0;
+    } else if (arg == "-filter" && has_value) {
+      options.filter = args[++i];
+    } else if (arg == "-json" && has_value) {
+      options.json_path = args[++i];
+    } else if (arg == "-baseline" && has_value) {
+      options.baseline_path = args[++i];
+    } else if (arg == "-threshold" && has_value) {
+      valid = ParseNumber(args[++i], options.threshold_percent) &&
+              options.threshold_percent >= 0;
+    } else {
+      PrintUsage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    if (!valid) {
+      std::cerr << "Argument error: Invalid value for " << arg << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::map<std::string, double> baseline;
+  if (options.baseline_path.has_value() &&
+      !ReadBaseline(*options.baseline_path, "ns_per_unit", baseline)) {
+    std::cerr << "Could not read baseline file" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<BenchCase> cases;
+  AddCpuCases(cases);
+  AddPpuCases(cases);
+  AddSpuCases(cases);
+  if (options.filter.has_value()) {
+    std::erase_if(cases, [&options](const BenchCase& bench_case) {
+      return bench_case.name.find(*options.filter) == std::string::npos;
+    });
+  }
+
+  std::cout << std::fixed << std::setprecision(2) << std::left << std::setw(24) << "benchmark"
+            << std::setw(12) << "unit" << std::right << std::setw(10) << "ns" << std::setw(10)
+            << "median" << std::endl;
+
+  std::vector<CaseResult> results;
+  bool regression = false;
+  for (const auto& bench_case : cases) {
+    auto result = RunCase(bench_case, options.repeat);
+    std::cout << std::left << std::setw(24) << result.name << std::setw(12) << result.unit
+              << std::right << std::setw(10) << result.ns_per_unit << std::setw(10)
+              << result.median_ns_per_unit;
+
+    auto it = baseline.find(result.name);
+    if (it != baseline.end()) {
+      result.baseline_ns_per_unit = it->second;
+      result.regression = result.ns_per_unit > it->second * (1 + options.threshold_percent / 100);
+      regression |= result.regression;
+      std::cout << "  " << std::showpos << 100 * (result.ns_per_unit / it->second - 1)
+                << std::noshowpos << "%" << (result.regression ? " REGRESSION" : "");
+    }
+    std::cout << std::endl;
+    results.push_back(std::move(result));
+  }
+
+  if (options.json_path.has_value() && !WriteJson(*options.json_path, results)) {
+    std::cerr << "Could not write JSON file" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (regression) {
+    std::cerr << "Time per unit regressed by more than " << options.threshold_percent
+              << "% from the baseline" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,326 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench_json.h"
+#include "bench_workloads.h"
+#include "core/host_clock.h"
+#include "core/vsmile/vsmile.h"
+#include "core/vsmile/vsmile_loader.h"
+
+// Runs fixed workloads as fast as possible and reports emulation throughput, with the time
+// spent in each component. Results can be saved as JSON and compared with a previous run.
+
+namespace {
+
+struct Options {
+  std::optional<std::string> sysrom_path;
+  std::vector<std::string> cartrom_paths;
+  bool synthetic = true;
+  int warmup_frames = 120;
+  int frames = 600;
+  int runs = 3;
+  std::optional<std::string> json_path;
+  std::optional<std::string> baseline_path;
+  double threshold_percent = 5;
+  std::optional<std::string> write_roms_dir;
+};
+
+constexpr std::array<const char*, 5> kComponentNames = {"cpu", "ppu", "spu", "timers", "other"};
+
+struct WorkloadResult {
+  std::string name;
+  double frames_per_second = 0;
+  double instructions_per_second = 0;
+  double instructions_per_frame = 0;
+  std::array<double, kComponentNames.size()> component_ms_per_frame = {};
+  std::optional<double> baseline_frames_per_second;
+  bool regression = false;
+};
+
+void PrintUsage(std::string exec_name) {
+  std::cerr << "Usage: " << exec_name << " [options] [cartrom ...]" << std::endl
+            << std::endl
+            << "Runs the built-in synthetic workloads and any given cartridge ROMs." << std::endl
+            << std::endl
+            << "  -sysrom FILE      Use system ROM FILE for cartridges instead of dummy system ROM"
+            << std::endl
+            << "  -no-synthetic     Only run the given cartridge ROMs" << std::endl
+            << "  -frames N         Number of frames to time per run (default 600)" << std::endl
+            << "  -warmup N         Number of frames to run before timing (default 120)"
+            << std::endl
+            << "  -runs N           Number of timed runs, of which the fastest is kept (default 3)"
+            << std::endl
+            << "  -json FILE        Write results to FILE as JSON" << std::endl
+            << "  -baseline FILE    Compare with results from an earlier -json FILE" << std::endl
+            << "  -threshold PCT    Slowdown from the baseline counted as a regression "
+               "(default 5)"
+            << std::endl
+            << "  -write-roms DIR   Write the synthetic workload ROMs to DIR as NAME.bin and exit"
+            << std::endl;
+}
+
+template <typename T>
+bool ParseNumber(std::string_view str, T& value) {
+  auto [ptr, error] = std::from_chars(str.data(), str.data() + str.size(), value);
+  return ptr == str.data() + str.size() && error == std::errc();
+}
+
+void RunFrames(VSmile& vsmile, int frames) {
+  for (int i = 0; i < frames; i++) {
+    vsmile.RunFrame();
+    vsmile.GetAudio();
+  }
+}
+
+// Frame rate is taken from unprofiled runs, and split between components in the proportions
+// measured by a profiled run from the same starting state
+WorkloadResult RunWorkload(const std::string& name,
+                           std::shared_ptr<const VSmile::SysRomType> sysrom,
+                           std::shared_ptr<const VSmile::CartRomType> cartrom,
+                           const Options& options) {
+  using Clock = std::chrono::steady_clock;
+
+  VSmile vsmile(std::move(sysrom), std::move(cartrom), VSmile::CartType::STANDARD, nullptr, 0xe,
+                true, VideoTiming::PAL);
+  vsmile.SetDeterministicRandom(true);
+  vsmile.Reset();
+  RunFrames(vsmile, options.warmup_frames);
+
+  std::vector<uint8_t> start_state;
+  vsmile.SaveState(start_state);
+
+  double best_seconds = std::numeric_limits<double>::infinity();
+  for (int run = 0; run < options.runs; run++) {
+    vsmile.LoadState(start_state);
+    const auto start = Clock::now();
+    RunFrames(vsmile, options.frames);
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+    best_seconds = std::min(best_seconds, elapsed.count());
+  }
+
+  vsmile.LoadState(start_state);
+  vsmile.ResetComponentTimes();
+  vsmile.SetProfilingEnabled(true);
+  RunFrames(vsmile, options.frames);
+  vsmile.SetProfilingEnabled(false);
+
+  const auto& times = vsmile.GetComponentTimes();
+  const auto shares = times.GetShares();
+
+  WorkloadResult result;
+  result.name = name;
+  result.frames_per_second = options.frames / best_seconds;
+  result.instructions_per_second = times.instructions / best_seconds;
+  result.instructions_per_frame = static_cast<double>(times.instructions) / options.frames;
+  const double ms_per_frame = best_seconds * 1000 / options.frames;
+  for (size_t i = 0; i < shares.size(); i++) {
+    result.component_ms_per_frame[i] = ms_per_frame * shares[i];
+  }
+  return result;
+}
+
+bool WriteJson(const std::string& path, const std::vector<WorkloadResult>& results,
+               const Options& options) {
+  std::ofstream out(path);
+  if (!out)
+    return false;
+
+  out << std::setprecision(6) << "{" << std::endl
+      << "  \"frames\": " << options.frames << "," << std::endl
+      << "  \"workloads\": [" << std::endl;
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto& result = results[i];
+    out << "    {" << std::endl
+        << "      \"name\": " << JsonString(result.name) << "," << std::endl
+        << "      \"frames_per_second\": " << result.frames_per_second << "," << std::endl
+        << "      \"instructions_per_second\": " << result.instructions_per_second << ","
+        << std::endl
+        << "      \"instructions_per_frame\": " << result.instructions_per_frame << ","
+        << std::endl
+        << "      \"ms_per_frame\": {";
+    for (size_t j = 0; j < kComponentNames.size(); j++) {
+      out << (j ? ", " : "") << "\"" << kComponentNames[j]
+          << "\": " << result.component_ms_per_frame[j];
+    }
+    out << "}" << std::endl << "    }" << (i + 1 < results.size() ? "," : "") << std::endl;
+  }
+  out << "  ]" << std::endl << "}" << std::endl;
+  return out.good();
+}
+
+void PrintResult(const WorkloadResult& result) {
+  double total_ms = 0;
+  for (double ms : result.component_ms_per_frame) {
+    total_ms += ms;
+  }
+
+  std::cout << std::left << std::setw(16) << result.name << std::right << std::setw(9)
+            << result.frames_per_second << std::setw(9)
+            << result.instructions_per_second / 1000000;
+  for (double ms : result.component_ms_per_frame) {
+    std::cout << std::setw(8) << (total_ms > 0 ? 100 * ms / total_ms : 0);
+  }
+  if (result.baseline_frames_per_second.has_value()) {
+    const double change =
+        100 * (result.frames_per_second / *result.baseline_frames_per_second - 1);
+    std::cout << "  " << std::showpos << change << std::noshowpos << "%"
+              << (result.regression ? " REGRESSION" : "");
+  }
+  std::cout << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+
+  const std::vector<std::string_view> args(argv + 1, argv + argc);
+  for (size_t i = 0; i < args.size(); i++) {
+    const auto& arg = args[i];
+    const bool has_value = i + 1 < args.size();
+    bool valid = true;
+    if (arg == "-sysrom" && has_value) {
+      options.sysrom_path = args[++i];
+    } else if (arg == "-no-synthetic") {
+      options.synthetic = false;
+    } else if (arg == "-frames" && has_value) {
+      valid = ParseNumber(args[++i], options.frames) && options.frames > 0;
+    } else if (arg == "-warmup" && has_value) {
+      valid = ParseNumber(args[++i], options.warmup_frames) && options.warmup_frames >= 0;
+    } else if (arg == "-runs" && has_value) {
+      valid = ParseNumber(args[++i], options.runs) && options.runs > 0;
+    } else if (arg == "-json" && has_value) {
+      options.json_path = args[++i];
+    } else if (arg == "-baseline" && has_value) {
+      options.baseline_path = args[++i];
+    } else if (arg == "-threshold" && has_value) {
+      valid = ParseNumber(args[++i], options.threshold_percent) &&
+              options.threshold_percent >= 0;
+    } else if (arg == "-write-roms" && has_value) {
+      options.write_roms_dir = args[++i];
+    } else if (arg[0] != '-') {
+      options.cartrom_paths.emplace_back(arg);
+    } else {
+      PrintUsage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    if (!valid) {
+      std::cerr << "Argument error: Invalid value for " << arg << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Lets the headless runner check the output of the workloads against golden frame hashes
+  if (options.write_roms_dir.has_value()) {
+    std::error_code error;
+    std::filesystem::create_directories(*options.write_roms_dir, error);
+    for (const auto& workload : MakeSyntheticWorkloads()) {
+      const auto path = std::filesystem::path(*options.write_roms_dir) / (workload.name + ".bin");
+      if (!WriteRomFile(path.string(), *workload.cartrom)) {
+        std::cerr << "Could not write " << path.string() << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+    return EXIT_SUCCESS;
+  }
+
+  std::map<std::string, double> baseline;
+  if (options.baseline_path.has_value() && !ReadBaseline(*options.baseline_path, "frames_per_second", baseline)) {
+    std::cerr << "Could not read baseline file" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto sysrom = std::make_shared<VSmile::SysRomType>();
+  if (options.sysrom_path.has_value()) {
+    if (!ReadRomFile(*options.sysrom_path, *sysrom)) {
+      std::cerr << "Could not open system ROM file" << std::endl;
+      return EXIT_FAILURE;
+    }
+  } else {
+    MakeDummySysRom(*sysrom);
+  }
+
+  // Synthetic workloads always start directly in the cartridge
+  auto dummy_sysrom = sysrom;
+  if (options.sysrom_path.has_value()) {
+    dummy_sysrom = std::make_shared<VSmile::SysRomType>();
+    MakeDummySysRom(*dummy_sysrom);
+  }
+
+  std::vector<BenchWorkload> workloads;
+  if (options.synthetic)
+    workloads = MakeSyntheticWorkloads();
+  const size_t synthetic_count = workloads.size();
+  for (const auto& path : options.cartrom_paths) {
+    auto cartrom = std::make_shared<VSmile::CartRomType>();
+    if (!ReadRomFile(path, *cartrom)) {
+      std::cerr << "Could not open cartridge ROM file " << path << std::endl;
+      return EXIT_FAILURE;
+    }
+    workloads.push_back({std::filesystem::path(path).stem().string(), path, cartrom});
+  }
+  if (workloads.empty()) {
+    PrintUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // Measured before the first workload rather than in the middle of one
+  HostClock::GetReadTicks();
+
+  std::cout << std::fixed << std::setprecision(1) << std::left << std::setw(16) << "workload"
+            << std::right << std::setw(9) << "fps" << std::setw(9) << "MIPS";
+  for (const char* component : kComponentNames) {
+    std::cout << std::setw(8) << (std::string(component) + "%");
+  }
+  std::cout << std::endl;
+
+  std::vector<WorkloadResult> results;
+  bool regression = false;
+  for (size_t i = 0; i < workloads.size(); i++) {
+    const auto& workload = workloads[i];
+    WorkloadResult result;
+    try {
+      result = RunWorkload(workload.name, i < synthetic_count ? dummy_sysrom : sysrom,
+                           workload.cartrom, options);
+    } catch (const EmulationError& e) {
+      std::cerr << workload.name << ": Emulation error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    auto it = baseline.find(result.name);
+    if (it != baseline.end()) {
+      result.baseline_frames_per_second = it->second;
+      result.regression =
+          result.frames_per_second < it->second * (1 - options.threshold_percent / 100);
+      regression |= result.regression;
+    }
+    PrintResult(result);
+    results.push_back(std::move(result));
+  }
+
+  if (options.json_path.has_value() && !WriteJson(*options.json_path, results, options)) {
+    std::cerr << "Could not write JSON file" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (regression) {
+    std::cerr << "Frame rate regressed by more than " << options.threshold_percent
+              << "% from the baseline" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
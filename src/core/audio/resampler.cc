@@ -0,0 +1,166 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace {
+typedef float Float4 __attribute__((vector_size(16)));
+
+inline Float4 Load4(const float* p) {
+  Float4 v;
+  __builtin_memcpy(&v, p, sizeof v);
+  return v;
+}
+
+inline float HorizontalSum(Float4 v) {
+  return (v[0] + v[1]) + (v[2] + v[3]);
+}
+
+// Zeroth order modified Bessel function of the first kind, used by the Kaiser window
+double BesselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  for (int k = 1; k < 64; k++) {
+    term *= (x / (2 * k)) * (x / (2 * k));
+    sum += term;
+    if (term < sum * 1e-17)
+      break;
+  }
+  return sum;
+}
+
+inline int16_t ToOutputSample(float value) {
+  return static_cast<int16_t>(std::clamp(std::lrintf(value), -32768l, 32767l));
+}
+}  // namespace
+
+Resampler::Resampler(int input_rate, int output_rate, Quality quality)
+    : input_rate_(input_rate), output_rate_(output_rate), quality_(quality) {
+  step_ = static_cast<double>(input_rate_) / output_rate_;
+
+  // Cutoff frequencies are relative to the output Nyquist frequency
+  switch (quality_) {
+    case Quality::LINEAR:
+      taps_ = 2;
+      phases_ = 1;
+      break;
+    case Quality::MEDIUM:
+      BuildFilter(8, 0.80, 5.65);
+      break;
+    case Quality::HIGH:
+      BuildFilter(24, 0.90, 9.51);
+      break;
+  }
+
+  Reset();
+}
+
+void Resampler::BuildFilter(int zero_crossings, double cutoff, double beta) {
+  // Normalized cutoff in cycles per input sample, scaled down when downsampling
+  const double fc = 0.5 * cutoff * std::min(1.0, 1.0 / step_);
+  const double half_width = zero_crossings / (2 * fc);
+
+  taps_ = (static_cast<int>(std::ceil(half_width)) * 2 + 3) & ~3;
+  phases_ = 256;
+  filter_.assign((phases_ + 1) * taps_, 0.0f);
+
+  const int center = taps_ / 2 - 1;
+  const double window_norm = BesselI0(beta);
+  for (int phase = 0; phase <= phases_; phase++) {
+    float* coeffs = &filter_[phase * taps_];
+    double sum = 0;
+    for (int tap = 0; tap < taps_; tap++) {
+      const double t = (tap - center) - static_cast<double>(phase) / phases_;
+      if (std::abs(t) >= half_width)
+        continue;
+
+      const double x = 2 * fc * t;
+      const double sinc = x == 0 ? 1.0 : std::sin(std::numbers::pi * x) / (std::numbers::pi * x);
+      const double r = t / half_width;
+      const double window = BesselI0(beta * std::sqrt(1 - r * r)) / window_norm;
+      coeffs[tap] = 2 * fc * sinc * window;
+      sum += coeffs[tap];
+    }
+
+    // Normalize each phase for unity DC gain
+    for (int tap = 0; tap < taps_; tap++) {
+      coeffs[tap] /= sum;
+    }
+  }
+}
+
+void Resampler::Reset() {
+  // Pre-fill history so that the first output sample is centered on the first input sample
+  const int history = quality_ == Quality::LINEAR ? 0 : taps_ / 2 - 1;
+  left_.assign(history, 0.0f);
+  right_.assign(history, 0.0f);
+  pos_ = 0;
+}
+
+void Resampler::SetRateAdjust(double rate_adjust) {
+  rate_adjust_ = rate_adjust;
+}
+
+double Resampler::GetRateAdjust() const {
+  return rate_adjust_;
+}
+
+Resampler::Quality Resampler::GetQuality() const {
+  return quality_;
+}
+
+int Resampler::GetOutputRate() const {
+  return output_rate_;
+}
+
+inline float Resampler::FilterPhase(const float* samples, const float* coeffs,
+                                    const float* next_coeffs, float alpha) const {
+  const Float4 alpha4 = {alpha, alpha, alpha, alpha};
+  Float4 acc = {};
+  for (int tap = 0; tap < taps_; tap += 4) {
+    const Float4 c0 = Load4(coeffs + tap);
+    const Float4 c1 = Load4(next_coeffs + tap);
+    acc += (c0 + (c1 - c0) * alpha4) * Load4(samples + tap);
+  }
+  return HorizontalSum(acc);
+}
+
+void Resampler::Process(std::span<const uint16_t> input, std::vector<int16_t>& output) {
+  for (size_t i = 0; i + 1 < input.size(); i += 2) {
+    left_.push_back(static_cast<int16_t>(input[i] ^ 0x8000));
+    right_.push_back(static_cast<int16_t>(input[i + 1] ^ 0x8000));
+  }
+
+  const size_t available = left_.size();
+  const double step = step_ * rate_adjust_;
+  if (quality_ == Quality::LINEAR) {
+    while (static_cast<size_t>(pos_) + 1 < available) {
+      const size_t index = static_cast<size_t>(pos_);
+      const float frac = pos_ - index;
+      output.push_back(ToOutputSample(left_[index] + (left_[index + 1] - left_[index]) * frac));
+      output.push_back(ToOutputSample(right_[index] + (right_[index + 1] - right_[index]) * frac));
+      pos_ += step;
+    }
+  } else {
+    while (static_cast<size_t>(pos_) + taps_ <= available) {
+      const size_t index = static_cast<size_t>(pos_);
+      const double phase_pos = (pos_ - index) * phases_;
+      const int phase = static_cast<int>(phase_pos);
+      const float alpha = phase_pos - phase;
+      const float* coeffs = &filter_[phase * taps_];
+
+      output.push_back(
+          ToOutputSample(FilterPhase(&left_[index], coeffs, coeffs + taps_, alpha)));
+      output.push_back(
+          ToOutputSample(FilterPhase(&right_[index], coeffs, coeffs + taps_, alpha)));
+      pos_ += step;
+    }
+  }
+
+  // Drop input samples that no future output sample depends on
+  const size_t consumed = std::min(static_cast<size_t>(pos_), available);
+  left_.erase(left_.begin(), left_.begin() + consumed);
+  right_.erase(right_.begin(), right_.begin() + consumed);
+  pos_ -= consumed;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Converts the interleaved stereo SPU output (unsigned 16-bit) to signed 16-bit samples at a
+// host sample rate. The sinc tiers use a polyphase windowed-sinc FIR filter with linear
+// interpolation between neighbouring phases.
+class Resampler {
+public:
+  enum class Quality {
+    LINEAR,  // Linear interpolation without anti-aliasing filter
+    MEDIUM,  // 16 zero crossings, ~60 dB stopband
+    HIGH,    // 48 zero crossings, ~95 dB stopband
+  };
+
+  Resampler(int input_rate, int output_rate, Quality quality);
+
+  void Reset();
+  void Process(std::span<const uint16_t> input, std::vector<int16_t>& output);
+
+  // Scales the conversion ratio, e.g. 1.001 consumes input 0.1% faster
+  void SetRateAdjust(double rate_adjust);
+  double GetRateAdjust() const;
+
+  Quality GetQuality() const;
+  int GetOutputRate() const;
+
+private:
+  void BuildFilter(int zero_crossings, double cutoff, double beta);
+  float FilterPhase(const float* samples, const float* coeffs, const float* next_coeffs,
+                    float alpha) const;
+
+  const int input_rate_;
+  const int output_rate_;
+  const Quality quality_;
+
+  int taps_ = 2;
+  int phases_ = 1;
+  std::vector<float> filter_;
+
+  double step_;
+  double rate_adjust_ = 1.0;
+  double pos_ = 0;
+  std::vector<float> left_;
+  std::vector<float> right_;
+};
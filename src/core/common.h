@@ -1,15 +1,24 @@
 #pragma once
 
 #include <cstdint>
-#include <iostream>
 #include <source_location>
 #include <span>
+#include <stdexcept>
+#include <string>
 #include <type_traits>
 
+// Thrown when emulation cannot continue, such as on an unknown instruction. The machine that
+// threw it is left in an undefined state and must not be run further, but other machines in
+// the same process are unaffected.
+class EmulationError : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
 [[noreturn]] inline void die(
     const char* msg, const std::source_location location = std::source_location::current()) {
-  std::clog << location.file_name() << "(" << location.line() << "): " << msg << std::endl;
-  abort();
+  throw EmulationError(std::string(location.file_name()) + "(" +
+                       std::to_string(location.line()) + "): " + msg);
 }
 
 using Word = uint16_t;
@@ -47,6 +56,11 @@ public:
 
   inline void Reset() { counter_ = a_; }
 
+  template <typename S>
+  void Serialize(S& s) {
+    s.Value(counter_);
+  }
+
 protected:
   int counter_;
   const int a_;
@@ -69,6 +83,14 @@ public:
 
   inline void Reset() { counter_ = A; }
 
+  // Number of cycles until the next tick
+  inline int GetRemainingCycles() const { return (counter_ + B - 1) / B; }
+
+  template <typename S>
+  void Serialize(S& s) {
+    s.Value(counter_);
+  }
+
 protected:
   int counter_ = A;
 };
@@ -95,6 +117,14 @@ public:
 
   inline void ClearDivCounter() { div_counter_ = 0; }
 
+  inline unsigned GetDivCounter() const { return div_counter_; }
+
+  template <typename S>
+  void Serialize(S& s) {
+    SimpleClock<A, B>::Serialize(s);
+    s.Value(div_counter_);
+  }
+
 private:
   int div_counter_ = 0;
 };
@@ -0,0 +1,43 @@
+#include "host_clock.h"
+
+#include <algorithm>
+#include <array>
+#include <thread>
+
+double HostClock::GetTicksPerSecond() {
+#if defined(__x86_64__) || defined(__i386__)
+  static const double ticks_per_second = [] {
+    using Clock = std::chrono::steady_clock;
+    const auto start_time = Clock::now();
+    const uint64_t start_ticks = Now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const uint64_t end_ticks = Now();
+    const std::chrono::duration<double> elapsed = Clock::now() - start_time;
+    return (end_ticks - start_ticks) / elapsed.count();
+  }();
+  return ticks_per_second;
+#else
+  return 1e9;
+#endif
+}
+
+double HostClock::GetReadTicks() {
+  static const double read_ticks = [] {
+    constexpr int kReads = 100000;
+    std::array<double, 9> measurements;
+    for (double& measurement : measurements) {
+      uint64_t time = Now();
+      uint64_t total = 0;
+      for (int i = 0; i < kReads; i++) {
+        const uint64_t now = Now();
+        total += now - time;
+        time = now;
+      }
+      measurement = static_cast<double>(total) / kReads;
+    }
+    const auto median = measurements.begin() + measurements.size() / 2;
+    std::nth_element(measurements.begin(), median, measurements.end());
+    return *median;
+  }();
+  return read_ticks;
+}
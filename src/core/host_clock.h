@@ -0,0 +1,30 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Cheap monotonic timestamps for profiling the emulator on the host. The time stamp counter is
+// used where available, as reading steady_clock costs about as much as a short instruction.
+class HostClock {
+public:
+  static inline uint64_t Now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+  }
+
+  // Measured against steady_clock on first use, which takes a few milliseconds
+  static double GetTicksPerSecond();
+  // Ticks between two consecutive reads, which timing each component separately adds to every
+  // component. The median of several measurements taken on first use, so that a measurement
+  // interrupted by the host does not skew it.
+  static double GetReadTicks();
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Unreliable datagram channel to the remote peer of a netplay session. Packets may be lost,
+// duplicated or reordered.
+class NetplayTransport {
+public:
+  virtual ~NetplayTransport() {}
+
+  virtual void Send(std::span<const uint8_t> packet) = 0;
+  // Returns false when no packet is waiting
+  virtual bool Receive(std::vector<uint8_t>& packet) = 0;
+};
@@ -0,0 +1,269 @@
+#include "rollback_session.h"
+
+#include <algorithm>
+
+#include "core/state/xxhash.h"
+
+namespace {
+constexpr uint16_t kPacketMagic = 0x4e56;  // "VN"
+constexpr uint8_t kPacketVersion = 1;
+constexpr size_t kHeaderSize = 29;
+constexpr size_t kMaxInputsPerPacket = 255;
+constexpr uint32_t kNoHash = 0xffffffff;
+constexpr size_t kLocalHashHistory = 8;
+constexpr uint32_t kSyncStallInterval = 30;
+
+void WriteLe(std::vector<uint8_t>& out, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    out.push_back(value >> (i * 8));
+  }
+}
+
+uint64_t ReadLe(const uint8_t* p, int bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; i++) {
+    value |= static_cast<uint64_t>(p[i]) << (i * 8);
+  }
+  return value;
+}
+}  // namespace
+
+RollbackSession::RollbackSession(VSmile& vsmile, NetplayTransport& transport,
+                                 const Settings& settings)
+    : vsmile_(vsmile),
+      transport_(transport),
+      settings_(settings),
+      local_inputs_(settings.input_delay, PackInput({})),
+      predicted_inputs_(settings.max_rollback + 1),
+      snapshots_(settings.max_rollback + 1) {
+  vsmile_.SetControllerConnected(1, true);
+}
+
+bool RollbackSession::AdvanceFrame(const VSmile::JoyInput& local_input) {
+  host_frame_++;
+  Update();
+
+  // Snapshots only cover a limited number of unconfirmed frames
+  if (frame_ + 1 > remote_inputs_.size() + settings_.max_rollback) {
+    stats_.input_stalls++;
+    SendInput();
+    return false;
+  }
+
+  // Both peers see the other one behind by the transport latency. When this peer is further
+  // ahead than that, wait a frame now and then to let the other one catch up.
+  const int local_advantage = static_cast<int>(frame_ - remote_frame_);
+  if ((local_advantage - remote_advantage_) / 2 >= 2 &&
+      frame_ - last_sync_stall_frame_ >= kSyncStallInterval) {
+    last_sync_stall_frame_ = frame_;
+    stats_.sync_stalls++;
+    SendInput();
+    return false;
+  }
+
+  local_inputs_.push_back(PackInput(local_input));
+  SendInput();
+  RunFrame();
+  return true;
+}
+
+void RollbackSession::Idle() {
+  host_frame_++;
+  Update();
+  SendInput();
+}
+
+uint32_t RollbackSession::GetFrame() const {
+  return frame_;
+}
+
+uint32_t RollbackSession::GetConfirmedFrame() const {
+  return std::min<uint32_t>(frame_, remote_inputs_.size());
+}
+
+std::optional<uint32_t> RollbackSession::GetDesyncFrame() const {
+  return desync_frame_;
+}
+
+uint32_t RollbackSession::GetFramesSinceReceive() const {
+  return host_frame_ - last_receive_host_frame_;
+}
+
+const RollbackSession::Stats& RollbackSession::GetStats() const {
+  return stats_;
+}
+
+// Buttons in bits 0-7, joystick axes offset to 0-10 in bits 8-11 and 12-15
+uint16_t RollbackSession::PackInput(const VSmile::JoyInput& input) {
+  return input.red | (input.yellow << 1) | (input.blue << 2) | (input.green << 3) |
+         (input.enter << 4) | (input.back << 5) | (input.help << 6) | (input.abc << 7) |
+         ((std::clamp(input.x, -5, 5) + 5) << 8) | ((std::clamp(input.y, -5, 5) + 5) << 12);
+}
+
+VSmile::JoyInput RollbackSession::UnpackInput(uint16_t packed) {
+  VSmile::JoyInput input;
+  input.red = packed & 1;
+  input.yellow = (packed >> 1) & 1;
+  input.blue = (packed >> 2) & 1;
+  input.green = (packed >> 3) & 1;
+  input.enter = (packed >> 4) & 1;
+  input.back = (packed >> 5) & 1;
+  input.help = (packed >> 6) & 1;
+  input.abc = (packed >> 7) & 1;
+  input.x = std::clamp(((packed >> 8) & 0xf) - 5, -5, 5);
+  input.y = std::clamp(((packed >> 12) & 0xf) - 5, -5, 5);
+  return input;
+}
+
+void RollbackSession::Update() {
+  ReceivePackets();
+  if (rollback_frame_.has_value())
+    Rollback(*rollback_frame_);
+  CheckHashes();
+}
+
+void RollbackSession::ReceivePackets() {
+  std::vector<uint8_t> packet;
+  while (transport_.Receive(packet)) {
+    HandlePacket(packet);
+  }
+}
+
+void RollbackSession::HandlePacket(const std::vector<uint8_t>& packet) {
+  const uint8_t* p = packet.data();
+  if (packet.size() < kHeaderSize || ReadLe(&p[0], 2) != kPacketMagic || p[2] != kPacketVersion)
+    return;
+
+  const uint32_t frame = ReadLe(&p[3], 4);
+  const uint32_t ack = ReadLe(&p[7], 4);
+  const int advantage = static_cast<int8_t>(p[11]);
+  const uint32_t hash_frame = ReadLe(&p[12], 4);
+  const uint64_t hash = ReadLe(&p[16], 8);
+  const uint32_t input_start = ReadLe(&p[24], 4);
+  const size_t input_count = p[28];
+  if (packet.size() != kHeaderSize + input_count * 2)
+    return;
+
+  stats_.packets_received++;
+  last_receive_host_frame_ = host_frame_;
+  if (frame >= remote_frame_) {
+    remote_frame_ = frame;
+    remote_advantage_ = advantage;
+  }
+  remote_ack_ = std::max(remote_ack_, ack);
+  if (hash_frame != kNoHash && (!remote_hash_.has_value() || hash_frame > remote_hash_->first))
+    remote_hash_ = {hash_frame, hash};
+
+  // Inputs start at the first one not acknowledged when sent, so a packet that is not out of
+  // date continues or overlaps the known inputs
+  if (input_start > remote_inputs_.size())
+    return;
+  for (size_t i = remote_inputs_.size() - input_start; i < input_count; i++) {
+    const uint32_t input_frame = input_start + i;
+    const uint16_t input = ReadLe(&p[kHeaderSize + i * 2], 2);
+    if (input_frame < frame_ && !rollback_frame_.has_value() &&
+        input != predicted_inputs_[input_frame % predicted_inputs_.size()])
+      rollback_frame_ = input_frame;
+    remote_inputs_.push_back(input);
+  }
+}
+
+void RollbackSession::SendInput() {
+  packet_.clear();
+  WriteLe(packet_, kPacketMagic, 2);
+  packet_.push_back(kPacketVersion);
+  WriteLe(packet_, frame_, 4);
+  WriteLe(packet_, remote_inputs_.size(), 4);
+  packet_.push_back(std::clamp(static_cast<int>(frame_ - remote_frame_), -128, 127));
+  if (!local_hashes_.empty()) {
+    WriteLe(packet_, local_hashes_.back().first, 4);
+    WriteLe(packet_, local_hashes_.back().second, 8);
+  } else {
+    WriteLe(packet_, kNoHash, 4);
+    WriteLe(packet_, 0, 8);
+  }
+
+  // All input not yet acknowledged is repeated in every packet, so lost packets do not need to
+  // be detected and sent again
+  const size_t input_start = std::min<size_t>(remote_ack_, local_inputs_.size());
+  const size_t input_count = std::min(local_inputs_.size() - input_start, kMaxInputsPerPacket);
+  WriteLe(packet_, input_start, 4);
+  packet_.push_back(input_count);
+  for (size_t i = 0; i < input_count; i++) {
+    WriteLe(packet_, local_inputs_[input_start + i], 2);
+  }
+
+  transport_.Send(packet_);
+  stats_.packets_sent++;
+}
+
+void RollbackSession::Rollback(uint32_t frame) {
+  const uint32_t end_frame = frame_;
+  if (!vsmile_.LoadState(snapshots_[frame % snapshots_.size()]))
+    die("Failed to restore rollback snapshot");
+  frame_ = frame;
+
+  // Accesses of the frames rolled back were already counted when first run
+  MemoryAccessStats* access_stats = vsmile_.GetMemoryAccessStats();
+  vsmile_.SetMemoryAccessStats(nullptr);
+  vsmile_.SetAudioEnabled(false);
+  while (frame_ < end_frame) {
+    RunFrame();
+  }
+  vsmile_.SetAudioEnabled(true);
+  vsmile_.SetMemoryAccessStats(access_stats);
+
+  const int resimulated_frames = end_frame - frame;
+  stats_.rollbacks++;
+  stats_.resimulated_frames += resimulated_frames;
+  stats_.max_resimulated_frames = std::max(stats_.max_resimulated_frames, resimulated_frames);
+  rollback_frame_.reset();
+}
+
+void RollbackSession::RunFrame() {
+  const size_t slot = frame_ % snapshots_.size();
+  const uint16_t remote_input = GetRemoteInput(frame_);
+
+  // Frames run with confirmed input from both players are never rolled back to
+  if (frame_ >= remote_inputs_.size()) {
+    predicted_inputs_[slot] = remote_input;
+    vsmile_.SaveState(snapshots_[slot]);
+  }
+
+  if (settings_.hash_interval > 0 && frame_ % settings_.hash_interval == 0 &&
+      (!hash_state_frame_.has_value() || *hash_state_frame_ >= frame_)) {
+    vsmile_.SaveState(hash_state_);
+    hash_state_frame_ = frame_;
+  }
+
+  vsmile_.UpdateJoystick(UnpackInput(local_inputs_[frame_]), settings_.local_player);
+  vsmile_.UpdateJoystick(UnpackInput(remote_input), 1 - settings_.local_player);
+  vsmile_.RunFrame();
+  frame_++;
+}
+
+void RollbackSession::CheckHashes() {
+  // The state at the start of a frame is final once all input before it is confirmed
+  if (hash_state_frame_.has_value() && *hash_state_frame_ <= remote_inputs_.size()) {
+    local_hashes_.emplace_back(*hash_state_frame_, Xxh64::Hash(hash_state_));
+    if (local_hashes_.size() > kLocalHashHistory)
+      local_hashes_.pop_front();
+    hash_state_frame_.reset();
+  }
+
+  if (remote_hash_.has_value() && !desync_frame_.has_value()) {
+    for (const auto& [frame, hash] : local_hashes_) {
+      if (frame == remote_hash_->first && hash != remote_hash_->second)
+        desync_frame_ = frame;
+    }
+  }
+}
+
+// Remote input is predicted to stay the same as the last confirmed input
+uint16_t RollbackSession::GetRemoteInput(uint32_t frame) const {
+  if (frame < remote_inputs_.size())
+    return remote_inputs_[frame];
+  if (!remote_inputs_.empty())
+    return remote_inputs_.back();
+  return PackInput({});
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "core/vsmile/vsmile.h"
+#include "netplay_transport.h"
+
+// Two-player session over an unreliable transport using rollback. Remote input is predicted
+// to be unchanged until it arrives, and on a misprediction the machine is restored to the
+// snapshot of the first mispredicted frame and run forward again with the correct input.
+//
+// Both peers must start from identical machines, hard reset with deterministic random numbers
+// enabled. The session connects the second controller, and each player controls the port
+// with the same number.
+class RollbackSession {
+public:
+  struct Settings {
+    int local_player = 0;
+    // Frames that local input is held back, which hides this much latency without rollback
+    int input_delay = 1;
+    // Unconfirmed frames that may be run ahead of remote input before waiting for it
+    int max_rollback = 8;
+    // Confirmed states of frames at this interval are hashed and compared with the peer
+    int hash_interval = 60;
+  };
+
+  struct Stats {
+    uint64_t rollbacks = 0;
+    uint64_t resimulated_frames = 0;
+    int max_resimulated_frames = 0;
+    uint64_t input_stalls = 0;
+    uint64_t sync_stalls = 0;
+    uint64_t packets_sent = 0;
+    uint64_t packets_received = 0;
+  };
+
+  RollbackSession(VSmile& vsmile, NetplayTransport& transport, const Settings& settings);
+
+  // Receives remote input, corrects mispredicted frames and runs the next frame with the given
+  // local input. Returns false without running a frame while waiting for the remote peer,
+  // either because it is too far behind or to let it catch up.
+  bool AdvanceFrame(const VSmile::JoyInput& local_input);
+  // Exchanges input with the peer and corrects mispredicted frames without running a new frame,
+  // for when the local side is paused or done
+  void Idle();
+
+  // Number of frames run, and how many of those have confirmed input from both players
+  uint32_t GetFrame() const;
+  uint32_t GetConfirmedFrame() const;
+  // First compared frame where the state hash of the peer differed, if any
+  std::optional<uint32_t> GetDesyncFrame() const;
+  // Calls to AdvanceFrame since anything was received from the peer
+  uint32_t GetFramesSinceReceive() const;
+  const Stats& GetStats() const;
+
+  static uint16_t PackInput(const VSmile::JoyInput& input);
+  static VSmile::JoyInput UnpackInput(uint16_t packed);
+
+private:
+  void Update();
+  void ReceivePackets();
+  void HandlePacket(const std::vector<uint8_t>& packet);
+  void SendInput();
+  void Rollback(uint32_t frame);
+  void RunFrame();
+  void CheckHashes();
+
+  uint16_t GetRemoteInput(uint32_t frame) const;
+
+  VSmile& vsmile_;
+  NetplayTransport& transport_;
+  const Settings settings_;
+
+  uint32_t frame_ = 0;
+  std::vector<uint16_t> local_inputs_;
+  std::vector<uint16_t> remote_inputs_;
+  // Remote input used for each unconfirmed frame, indexed by frame modulo rollback window
+  std::vector<uint16_t> predicted_inputs_;
+  // Earliest frame whose prediction turned out wrong, restored before running the next frame
+  std::optional<uint32_t> rollback_frame_;
+
+  // State at the start of each unconfirmed frame, indexed like predicted_inputs_
+  std::vector<std::vector<uint8_t>> snapshots_;
+
+  // Remote progress, as reported in its packets
+  uint32_t remote_frame_ = 0;
+  uint32_t remote_ack_ = 0;
+  int remote_advantage_ = 0;
+  uint32_t last_sync_stall_frame_ = 0;
+
+  // Calls to AdvanceFrame, which keep counting while waiting for the peer
+  uint32_t host_frame_ = 0;
+  uint32_t last_receive_host_frame_ = 0;
+
+  // State of the next frame to hash, kept until its input is confirmed
+  std::vector<uint8_t> hash_state_;
+  std::optional<uint32_t> hash_state_frame_;
+  std::deque<std::pair<uint32_t, uint64_t>> local_hashes_;
+  std::optional<std::pair<uint32_t, uint64_t>> remote_hash_;
+  std::optional<uint32_t> desync_frame_;
+
+  std::vector<uint8_t> packet_;
+  Stats stats_;
+};
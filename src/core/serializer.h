@@ -0,0 +1,63 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "core/state/xxhash.h"
+
+// Reads or writes machine state as a flat binary blob in host byte order, or feeds it to a hash
+// without storing it. Components implement a single Serialize(Serializer&) method that is used
+// for all modes.
+class Serializer {
+public:
+  enum class Mode { SAVE, LOAD, HASH };
+
+  explicit Serializer(std::vector<uint8_t>& out) : mode_(Mode::SAVE), out_(&out) {}
+  explicit Serializer(std::span<const uint8_t> in) : mode_(Mode::LOAD), in_(in) {}
+  explicit Serializer(Xxh64& hasher) : mode_(Mode::HASH), hasher_(&hasher) {}
+
+  template <typename T>
+  inline void Value(T& value) {
+    // Types with padding or unused bitfield bits have indeterminate bytes, which would make
+    // saved states and their hashes differ between otherwise identical machines
+    static_assert(std::has_unique_object_representations_v<T>);
+    if (mode_ == Mode::SAVE) {
+      const auto bytes = reinterpret_cast<const uint8_t*>(&value);
+      out_->insert(out_->end(), bytes, bytes + sizeof(T));
+    } else if (mode_ == Mode::HASH) {
+      hasher_->Update(&value, sizeof(T));
+    } else {
+      if (in_.size() - pos_ < sizeof(T)) {
+        error_ = true;
+        return;
+      }
+      std::memcpy(&value, in_.data() + pos_, sizeof(T));
+      pos_ += sizeof(T);
+    }
+  }
+
+  template <std::size_t N>
+  inline void Value(std::bitset<N>& value) {
+    static_assert(N <= 64);
+    uint64_t bits = value.to_ullong();
+    Value(bits);
+    if (mode_ == Mode::LOAD)
+      value = std::bitset<N>(bits);
+  }
+
+  inline Mode GetMode() const { return mode_; }
+  inline bool IsLoading() const { return mode_ == Mode::LOAD; }
+  inline bool HasError() const { return error_; }
+
+private:
+  const Mode mode_;
+  std::vector<uint8_t>* out_ = nullptr;
+  std::span<const uint8_t> in_;
+  Xxh64* hasher_ = nullptr;
+  size_t pos_ = 0;
+  bool error_ = false;
+};
@@ -2,6 +2,7 @@
 
 #include "irq.h"
 #include "spg200_io.h"
+#include "core/serializer.h"
 
 Adc::Adc(Irq& irq, Spg200Io& io) : irq_(irq), io_(io) {}
 
@@ -14,6 +15,14 @@ void Adc::Reset() {
   data_.raw = 0;
 }
 
+void Adc::Serialize(Serializer& s) {
+  s.Value(ctrl_.raw);
+  s.Value(status_.raw);
+  s.Value(data_.raw);
+  adc_clock_.Serialize(s);
+  s.Value(active_channel_);
+}
+
 void Adc::RunCycles(int cycles) {
   if (active_channel_ >= 0) {
     if (adc_clock_.Tick(cycles) && adc_clock_.GetDividedTick(ctrl_.clock)) {
@@ -3,6 +3,7 @@
 #include "core/common.h"
 
 class Irq;
+class Serializer;
 class Spg200Io;
 
 class Adc {
@@ -10,6 +11,7 @@ public:
   Adc(Irq& irq, Spg200Io& spg200);
 
   void Reset();
+  void Serialize(Serializer& s);
   void RunCycles(int cycles);
 
   void SetControl(Word value);
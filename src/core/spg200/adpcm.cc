@@ -2,6 +2,8 @@
 
 #include <algorithm>
 
+#include "core/serializer.h"
+
 namespace {
 static const int StepSizeTable[89] = {
     7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,
@@ -21,6 +23,11 @@ void Adpcm::Reset() {
   last_sample_ = 0;
 }
 
+void Adpcm::Serialize(Serializer& s) {
+  s.Value(step_index_);
+  s.Value(last_sample_);
+}
+
 int16_t Adpcm::Decode(uint8_t code) {
   int ss = StepSizeTable[step_index_];
   int e =
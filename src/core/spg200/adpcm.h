@@ -3,10 +3,13 @@
 #include <cstdint>
 #include <unordered_map>
 
+class Serializer;
+
 class Adpcm {
 public:
   Adpcm() = default;
   void Reset();
+  void Serialize(Serializer& s);
   int16_t Decode(uint8_t nibble);
 
 private:
@@ -0,0 +1,187 @@
+#include "call_graph_profiler.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cinttypes>
+#include <fstream>
+#include <sstream>
+
+std::optional<std::string> SymbolMap::Load(const std::string& path) {
+  std::ifstream file(path);
+  if (!file.good())
+    return "Could not open symbol file";
+
+  names_.clear();
+  std::string line;
+  for (int line_number = 1; std::getline(file, line); line_number++) {
+    std::istringstream fields(line);
+    std::string address, name;
+    if (!(fields >> address))
+      continue;
+    fields >> name;
+
+    Addr value;
+    auto [ptr, error] =
+        std::from_chars(address.data(), address.data() + address.size(), value, 16);
+    if (ptr != address.data() + address.size() || error != std::errc() || name.empty())
+      return "Invalid symbol file at line " + std::to_string(line_number);
+    names_.emplace(value, name);
+  }
+  return {};
+}
+
+std::string SymbolMap::GetName(Addr address) const {
+  if (auto it = names_.find(address); it != names_.end())
+    return it->second;
+  char text[16];
+  std::snprintf(text, sizeof text, "%06x", address);
+  return text;
+}
+
+CallGraphProfiler::CallGraphProfiler() {
+  Reset();
+}
+
+void CallGraphProfiler::Reset() {
+  nodes_.clear();
+  for (uint32_t root = 0; root < kRootCount; root++) {
+    nodes_.push_back({kRootFunction + root, kNoParent, 0});
+  }
+  children_.clear();
+  stack_.clear();
+  current_ = 0;
+}
+
+void CallGraphProfiler::Record(Word instruction, std::optional<int> interrupt, Addr new_pc,
+                               Word new_sp, int cycles) {
+  // Interrupt entry is counted in the handler, and the call or return itself in the caller
+  if (interrupt.has_value()) {
+    Enter(1 + *interrupt, new_sp);
+    nodes_[current_].cycles += cycles;
+    return;
+  }
+  nodes_[current_].cycles += cycles;
+
+  const int op0 = instruction >> 12;
+  const int rd = (instruction >> 9) & 7;
+  const int op1 = (instruction >> 6) & 7;
+  const int opn = (instruction >> 3) & 7;
+  const int rs = instruction & 7;
+  if (op0 == 0xf && op1 == 1) {
+    Enter(GetChild(current_, new_pc), new_sp);
+  } else if (op0 == 9 && op1 == 2 && rs == 0 && opn > 0 && rd + opn >= 7) {
+    // Pop from [sp] including PC, which covers retf and reti
+    Leave(new_sp);
+  }
+}
+
+void CallGraphProfiler::Enter(uint32_t node, Word sp) {
+  // Code that calls without ever returning would otherwise grow the stack forever
+  if (stack_.size() == kMaxDepth)
+    stack_.erase(stack_.begin());
+  stack_.push_back({current_, sp});
+  current_ = node;
+  nodes_[node].calls++;
+}
+
+// Leaves all frames whose return address and SR are no longer on the stack. SP is compared as
+// a signed difference, as it wraps around for code that never sets it.
+void CallGraphProfiler::Leave(Word sp) {
+  while (!stack_.empty() && static_cast<int16_t>(sp - stack_.back().sp) > 0) {
+    current_ = stack_.back().return_node;
+    stack_.pop_back();
+  }
+}
+
+uint32_t CallGraphProfiler::GetChild(uint32_t parent, Addr function) {
+  if (nodes_[parent].depth >= kMaxDepth)
+    return parent;
+
+  const uint64_t key = (static_cast<uint64_t>(parent) << 32) | function;
+  auto [it, inserted] = children_.try_emplace(key, nodes_.size());
+  if (inserted)
+    nodes_.push_back({function, parent, nodes_[parent].depth + 1});
+  return it->second;
+}
+
+std::string CallGraphProfiler::GetName(Addr function, const SymbolMap& symbols) const {
+  if (function == kRootFunction)
+    return "main";
+  if (function == kRootFunction + kRootCount - 1)
+    return "fiq";
+  if (function > kRootFunction)
+    return "irq" + std::to_string(function - kRootFunction - 1);
+  return symbols.GetName(function);
+}
+
+void CallGraphProfiler::WriteCollapsed(std::FILE* out, const SymbolMap& symbols) const {
+  std::vector<std::string> paths(nodes_.size());
+  for (uint32_t node = 0; node < nodes_.size(); node++) {
+    // Parents are always created before their children
+    const std::string name = GetName(nodes_[node].function, symbols);
+    paths[node] = node < kRootCount ? name : paths[nodes_[node].parent] + ";" + name;
+    if (nodes_[node].cycles)
+      std::fprintf(out, "%s %" PRIu64 "\n", paths[node].c_str(), nodes_[node].cycles);
+  }
+}
+
+void CallGraphProfiler::WriteReport(std::FILE* out, const SymbolMap& symbols,
+                                    size_t max_entries) const {
+  struct Function {
+    Addr address;
+    uint64_t inclusive = 0;
+    uint64_t exclusive = 0;
+    uint64_t calls = 0;
+  };
+
+  std::vector<uint64_t> totals(nodes_.size());
+  uint64_t total_cycles = 0;
+  for (uint32_t node = nodes_.size(); node-- > 0;) {
+    totals[node] += nodes_[node].cycles;
+    if (node < kRootCount)
+      total_cycles += totals[node];
+    else
+      totals[nodes_[node].parent] += totals[node];
+  }
+
+  std::unordered_map<Addr, Function> functions;
+  for (uint32_t node = 0; node < nodes_.size(); node++) {
+    const Addr address = nodes_[node].function;
+    Function& function = functions.try_emplace(address, address).first->second;
+    function.exclusive += nodes_[node].cycles;
+    function.calls += nodes_[node].calls;
+
+    // Recursive calls are already included in the outermost call
+    bool recursive = false;
+    for (uint32_t parent = nodes_[node].parent; parent != kNoParent && !recursive;
+         parent = nodes_[parent].parent) {
+      recursive = nodes_[parent].function == address;
+    }
+    if (!recursive)
+      function.inclusive += totals[node];
+  }
+
+  std::vector<Function> sorted;
+  for (const auto& [address, function] : functions) {
+    if (function.inclusive)
+      sorted.push_back(function);
+  }
+  std::ranges::sort(sorted, [](const Function& a, const Function& b) {
+    return a.inclusive != b.inclusive ? a.inclusive > b.inclusive : a.address < b.address;
+  });
+
+  // Roots and stacks that were entered but never ran are not counted
+  const size_t stacks =
+      std::ranges::count_if(nodes_, [](const Node& node) { return node.cycles != 0; });
+  std::fprintf(out, "%" PRIu64 " cycles, %zu functions, %zu call stacks\n\n", total_cycles,
+               sorted.size(), stacks);
+  std::fprintf(out, "%14s %7s %14s %7s %10s  %s\n", "inclusive", "share", "exclusive", "share",
+               "calls", "function");
+  for (size_t i = 0; i < std::min(max_entries, sorted.size()); i++) {
+    const Function& function = sorted[i];
+    std::fprintf(out, "%14" PRIu64 " %6.2f%% %14" PRIu64 " %6.2f%% %10" PRIu64 "  %s\n",
+                 function.inclusive, 100.0 * function.inclusive / total_cycles,
+                 function.exclusive, 100.0 * function.exclusive / total_cycles, function.calls,
+                 GetName(function.address, symbols).c_str());
+  }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/common.h"
+
+// Names for code addresses, loaded from a text file with one hex address and name per line as
+// written by veesem_assembler -symbols
+class SymbolMap {
+public:
+  std::optional<std::string> Load(const std::string& path);
+
+  // The symbol at the address, or the address in hex
+  std::string GetName(Addr address) const;
+
+private:
+  std::map<Addr, std::string> names_;
+};
+
+// Attributes CPU cycles to emulated functions by keeping a shadow call stack, entered by call
+// instructions and left by pops into PC such as retf and reti. Interrupts are roots of their own
+// rather than callees of the interrupted code. Frames remember the stack pointer, so that code
+// leaving several functions at once by resetting SP is followed as well.
+class CallGraphProfiler {
+public:
+  CallGraphProfiler();
+
+  // Records one CPU step, given the first word of the instruction at PC, the interrupt that the
+  // step entered instead (0-7 for IRQs and 8 for FIQ) and the registers after it
+  void Record(Word instruction, std::optional<int> interrupt, Addr new_pc, Word new_sp,
+              int cycles);
+
+  void Reset();
+
+  // Writes one line per call stack with the cycles spent in its innermost function, in the
+  // collapsed stack format read by flame graph tools
+  void WriteCollapsed(std::FILE* out, const SymbolMap& symbols) const;
+  // Writes the functions with the most cycles including callees as a table, along with their
+  // cycles excluding callees and their number of calls
+  void WriteReport(std::FILE* out, const SymbolMap& symbols, size_t max_entries = 200) const;
+
+private:
+  static constexpr size_t kMaxDepth = 256;
+  // The first nodes are roots, one for code started from reset followed by one for each
+  // interrupt. Their function addresses are outside the address space.
+  static constexpr uint32_t kRootCount = 10;
+  static constexpr Addr kRootFunction = 0x400000;
+  static constexpr uint32_t kNoParent = UINT32_MAX;
+
+  // A function in one calling context
+  struct Node {
+    Addr function;
+    uint32_t parent;
+    uint32_t depth;
+    uint64_t cycles = 0;
+    uint64_t calls = 0;
+  };
+
+  struct Frame {
+    uint32_t return_node;
+    Word sp;
+  };
+
+  void Enter(uint32_t node, Word sp);
+  void Leave(Word sp);
+  uint32_t GetChild(uint32_t parent, Addr function);
+  std::string GetName(Addr function, const SymbolMap& symbols) const;
+
+  std::vector<Node> nodes_;
+  // Node of each function called from a node, by parent node and function address
+  std::unordered_map<uint64_t, uint32_t> children_;
+  std::vector<Frame> stack_;
+  uint32_t current_ = 0;
+};
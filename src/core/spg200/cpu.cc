@@ -4,6 +4,7 @@
 #include <iostream>
 
 #include "bus_interface.h"
+#include "core/serializer.h"
 
 #define SR (reinterpret_cast<StatusReg&>(regs_[REG_SR]))
 
@@ -91,6 +92,18 @@ void Cpu::Reset() {
   regs_[REG_PC] = bus_.ReadWord(0xfff7);
 }
 
+void Cpu::Serialize(Serializer& s) {
+  s.Value(regs_);
+  s.Value(sb_);
+  s.Value(irq_signal_);
+  s.Value(fiq_signal_);
+  s.Value(irq_);
+  s.Value(fiq_);
+  s.Value(irq_enable_);
+  s.Value(fiq_enable_);
+  s.Value(fir_mov_);
+}
+
 void Cpu::PrintRegisterState() {
   std::printf(
       "SP: %04x, R1: %04x, R2: %04x, R3: %04x, "
@@ -129,6 +142,14 @@ bool Cpu::CheckInterrupts() {
   return false;
 }
 
+std::optional<int> Cpu::GetPendingInterrupt() const {
+  if (fiq_signal_ && !fiq_ && fiq_enable_)
+    return 8;
+  if (irq_signal_.any() && !irq_ && irq_enable_)
+    return std::countr_zero(irq_signal_.to_ullong());
+  return std::nullopt;
+}
+
 int Cpu::Step() {
   if (CheckInterrupts()) {
     return 10;
@@ -672,6 +693,10 @@ Addr Cpu::GetCsPc() {
   return (SR.cs << 16) | regs_[REG_PC];
 }
 
+const std::array<uint16_t, 8>& Cpu::GetRegisters() const {
+  return regs_;
+}
+
 inline void Cpu::SetCsPc(Addr val) {
   regs_[REG_PC] = val & 0xffff;
   SR.cs = val >> 16;
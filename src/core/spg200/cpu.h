@@ -3,10 +3,12 @@
 #include <array>
 #include <bitset>
 #include <cstdint>
+#include <optional>
 
 #include "core/common.h"
 
 class BusInterface;
+class Serializer;
 
 class Cpu {
 public:
@@ -17,10 +19,16 @@ public:
   void SetFiq(bool value);
 
   void Reset();
+  void Serialize(Serializer& s);
 
   Word GetDs();
   void SetDs(Word val);
   Addr GetCsPc();
+  // In instruction encoding order: SP, R1-R4, BP, SR and PC
+  const std::array<uint16_t, 8>& GetRegisters() const;
+  // Interrupt that the next step enters instead of running an instruction, 0-7 for IRQs and 8
+  // for FIQ
+  std::optional<int> GetPendingInterrupt() const;
 
   void PrintRegisterState();
 
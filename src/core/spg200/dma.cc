@@ -1,6 +1,7 @@
 #include "dma.h"
 
 #include "bus_interface.h"
+#include "core/serializer.h"
 
 Dma::Dma(BusInterface& bus) : bus_(bus) {};
 
@@ -10,6 +11,12 @@ void Dma::Reset() {
   length_ = 0;
 }
 
+void Dma::Serialize(Serializer& s) {
+  s.Value(source_);
+  s.Value(target_);
+  s.Value(length_);
+}
+
 Word Dma::GetSourceLo() {
   return source_ & 0xffff;
 }
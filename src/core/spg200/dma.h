@@ -3,12 +3,14 @@
 #include "core/common.h"
 
 class BusInterface;
+class Serializer;
 
 class Dma {
 public:
   Dma(BusInterface& bus);
 
   void Reset();
+  void Serialize(Serializer& s);
 
   Word GetSourceHi();
   void SetSourceHi(Word value);
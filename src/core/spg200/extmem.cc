@@ -1,6 +1,7 @@
 #include "extmem.h"
 
 #include "spg200_io.h"
+#include "core/serializer.h"
 
 Extmem::Extmem(Spg200Io& io) : io_(io) {}
 
@@ -9,6 +10,10 @@ void Extmem::Reset() {
   ctrl_.bus_arbiter = 5;
 }
 
+void Extmem::Serialize(Serializer& s) {
+  s.Value(ctrl_.raw);
+}
+
 void Extmem::SetControl(uint16_t value) {
   ctrl_.raw = value & ExternalMemControl::WriteMask;
 }
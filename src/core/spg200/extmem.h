@@ -5,6 +5,7 @@
 
 #include "core/common.h"
 
+class Serializer;
 class Spg200Io;
 
 class Extmem {
@@ -12,6 +13,7 @@ public:
   Extmem(Spg200Io& io);
 
   void Reset();
+  void Serialize(Serializer& s);
 
   Word GetControl();
   void SetControl(Word value);
@@ -1,6 +1,7 @@
 #include "gpio.h"
 
 #include "spg200_io.h"
+#include "core/serializer.h"
 
 Gpio::Gpio(Spg200Io& io) : io_(io) {}
 
@@ -8,6 +9,11 @@ void Gpio::Reset() {
   ports_.fill({});
 }
 
+void Gpio::Serialize(Serializer& s) {
+  s.Value(mode_.raw);
+  s.Value(ports_);
+}
+
 Word Gpio::GetMode() {
   return mode_.raw;
 }
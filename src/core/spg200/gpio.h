@@ -4,12 +4,14 @@
 
 #include "core/common.h"
 
+class Serializer;
 class Spg200Io;
 
 class Gpio {
 public:
   Gpio(Spg200Io& vsmile_io);
   void Reset();
+  void Serialize(Serializer& s);
 
   Word GetMode();
   void SetMode(Word value);
@@ -0,0 +1,73 @@
+#include "instruction_profiler.h"
+
+#include <algorithm>
+#include <cinttypes>
+
+InstructionProfiler::InstructionProfiler(uint32_t sample_interval)
+    : sample_interval_(std::max(sample_interval, 1u)), countdown_(sample_interval_) {}
+
+void InstructionProfiler::Reset() {
+  for (auto& page : pages_) {
+    page.reset();
+  }
+  countdown_ = sample_interval_;
+}
+
+uint32_t InstructionProfiler::GetSampleInterval() const {
+  return sample_interval_;
+}
+
+std::vector<InstructionProfiler::Entry> InstructionProfiler::GetEntries() const {
+  std::vector<Entry> entries;
+  for (size_t page = 0; page < pages_.size(); page++) {
+    if (!pages_[page])
+      continue;
+    for (Addr offset = 0; offset < kPageSize; offset++) {
+      const Counts& counts = (*pages_[page])[offset];
+      if (counts.instructions) {
+        entries.push_back({static_cast<Addr>((page << kPageBits) | offset),
+                           {counts.instructions * sample_interval_,
+                            counts.cycles * sample_interval_}});
+      }
+    }
+  }
+  std::ranges::stable_sort(entries, [](const Entry& a, const Entry& b) {
+    return a.counts.cycles > b.counts.cycles;
+  });
+  return entries;
+}
+
+void InstructionProfiler::WriteReport(std::FILE* out, size_t max_entries) const {
+  const auto entries = GetEntries();
+  Counts total;
+  for (const auto& entry : entries) {
+    total.instructions += entry.counts.instructions;
+    total.cycles += entry.counts.cycles;
+  }
+
+  std::fprintf(out, "%" PRIu64 " instructions, %" PRIu64 " cycles, %zu addresses",
+               total.instructions, total.cycles, entries.size());
+  if (sample_interval_ > 1)
+    std::fprintf(out, ", estimated from 1 in %u instructions", sample_interval_);
+  std::fprintf(out, "\n\n%-8s %14s %7s %7s %14s %8s\n", "address", "cycles", "share", "total",
+               "instructions", "average");
+
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < std::min(max_entries, entries.size()); i++) {
+    const Entry& entry = entries[i];
+    cumulative += entry.counts.cycles;
+    std::fprintf(out, "%06x   %14" PRIu64 " %6.2f%% %6.2f%% %14" PRIu64 " %8.2f\n", entry.address,
+                 entry.counts.cycles, 100.0 * entry.counts.cycles / total.cycles,
+                 100.0 * cumulative / total.cycles, entry.counts.instructions,
+                 static_cast<double>(entry.counts.cycles) / entry.counts.instructions);
+  }
+}
+
+void InstructionProfiler::WriteCollapsed(std::FILE* out) const {
+  auto entries = GetEntries();
+  std::ranges::sort(entries, {}, &Entry::address);
+  for (const auto& entry : entries) {
+    std::fprintf(out, "cs_%02x;%06x %" PRIu64 "\n", entry.address >> 16, entry.address,
+                 entry.counts.cycles);
+  }
+}
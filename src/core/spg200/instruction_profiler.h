@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "core/common.h"
+
+// Counts executed instructions and CPU cycles per CS:PC address, for finding the routines where
+// emulated time goes. Only one in every sample_interval instructions is recorded when sampling,
+// and counts are scaled back up when read. Interrupt entry is counted at the interrupted address.
+class InstructionProfiler {
+public:
+  struct Counts {
+    uint64_t instructions = 0;
+    uint64_t cycles = 0;
+  };
+
+  struct Entry {
+    Addr address;
+    Counts counts;
+  };
+
+  explicit InstructionProfiler(uint32_t sample_interval = 1);
+
+  void Record(Addr pc, int cycles) {
+    if (--countdown_ != 0)
+      return;
+    countdown_ = sample_interval_;
+
+    auto& page = pages_[(pc >> kPageBits) & (kPageCount - 1)];
+    if (!page)
+      page = std::make_unique<PageCounts>();
+    Counts& counts = (*page)[pc & (kPageSize - 1)];
+    counts.instructions++;
+    counts.cycles += cycles;
+  }
+
+  void Reset();
+  uint32_t GetSampleInterval() const;
+  // All addresses that were recorded, by descending cycle count
+  std::vector<Entry> GetEntries() const;
+
+  // Writes the addresses with the most cycles as a table, with their share of all cycles
+  void WriteReport(std::FILE* out, size_t max_entries = 200) const;
+  // Writes one line per address in the collapsed stack format read by flame graph tools, with
+  // the code segment as parent frame
+  void WriteCollapsed(std::FILE* out) const;
+
+private:
+  static constexpr int kPageBits = 16;
+  static constexpr Addr kPageSize = 1 << kPageBits;
+  static constexpr size_t kPageCount = 1 << (22 - kPageBits);
+  using PageCounts = std::array<Counts, kPageSize>;
+
+  const uint32_t sample_interval_;
+  uint32_t countdown_;
+  // Allocated when first executed from, as code is usually confined to a few segments
+  std::array<std::unique_ptr<PageCounts>, kPageCount> pages_;
+};
@@ -1,6 +1,7 @@
 #include "irq.h"
 
 #include "cpu.h"
+#include "core/serializer.h"
 
 Irq::Irq(Cpu& cpu) : cpu_(cpu) {};
 
@@ -12,6 +13,14 @@ void Irq::Reset() {
   spu_channel_active_ = false;
 }
 
+void Irq::Serialize(Serializer& s) {
+  s.Value(io_irq_ctrl_.raw);
+  s.Value(io_irq_status_.raw);
+  s.Value(fiq_select_);
+  s.Value(ppu_active_);
+  s.Value(spu_channel_active_);
+}
+
 Word Irq::GetIoIrqControl() {
   return io_irq_ctrl_.raw;
 }
@@ -3,12 +3,14 @@
 #include "core/common.h"
 
 class Cpu;
+class Serializer;
 
 class Irq {
 public:
   Irq(Cpu& cpu);
 
   void Reset();
+  void Serialize(Serializer& s);
 
   Word GetIoIrqControl();
   void SetIoIrqControl(Word value);
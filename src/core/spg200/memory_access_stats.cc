@@ -0,0 +1,74 @@
+#include "memory_access_stats.h"
+
+#include <algorithm>
+#include <cinttypes>
+
+namespace {
+constexpr const char* kRequesterNames[] = {"CPU fetch", "CPU data", "PPU", "SPU", "DMA"};
+
+void WriteCsvCounts(std::FILE* out, const char* kind, Addr addr,
+                    const MemoryAccessStats::Counts& counts) {
+  std::fprintf(out, "%s,%06x,%s", kind, addr, MemoryAccessStats::GetAreaName(addr));
+  for (int requester = 0; requester < MemoryAccessStats::REQUESTER_COUNT; requester++) {
+    std::fprintf(out, ",%" PRIu64 ",%" PRIu64, counts.reads[requester], counts.writes[requester]);
+  }
+  std::fputc('\n', out);
+}
+}  // namespace
+
+uint64_t MemoryAccessStats::Counts::GetTotal() const {
+  uint64_t total = 0;
+  for (int requester = 0; requester < REQUESTER_COUNT; requester++) {
+    total += reads[requester] + writes[requester];
+  }
+  return total;
+}
+
+MemoryAccessStats::MemoryAccessStats()
+    : regions_(kRegionCount), registers_(kRegisterEnd - kRegisterStart) {}
+
+void MemoryAccessStats::Reset() {
+  std::fill(regions_.begin(), regions_.end(), Counts());
+  std::fill(registers_.begin(), registers_.end(), Counts());
+}
+
+const MemoryAccessStats::Counts& MemoryAccessStats::GetRegion(Addr region) const {
+  return regions_[region];
+}
+
+const MemoryAccessStats::Counts& MemoryAccessStats::GetRegister(Addr addr) const {
+  return registers_[addr - kRegisterStart];
+}
+
+const char* MemoryAccessStats::GetRequesterName(int requester) {
+  return kRequesterNames[requester];
+}
+
+const char* MemoryAccessStats::GetAreaName(Addr addr) {
+  if (addr < 0x2800)
+    return "RAM";
+  if (addr < 0x3000)
+    return "PPU";
+  if (addr < 0x3800)
+    return "SPU";
+  if (addr < 0x4000)
+    return "IO";
+  return "External";
+}
+
+void MemoryAccessStats::WriteCsv(std::FILE* out) const {
+  std::fprintf(out, "kind,address,area");
+  for (const char* name : {"cpu_fetch", "cpu_data", "ppu", "spu", "dma"}) {
+    std::fprintf(out, ",%s_reads,%s_writes", name, name);
+  }
+  std::fputc('\n', out);
+
+  for (Addr addr = kRegisterStart; addr < kRegisterEnd; addr++) {
+    if (GetRegister(addr).GetTotal())
+      WriteCsvCounts(out, "register", addr, GetRegister(addr));
+  }
+  for (Addr region = 0; region < kRegionCount; region++) {
+    if (regions_[region].GetTotal())
+      WriteCsvCounts(out, "region", region * kRegionWords, regions_[region]);
+  }
+}
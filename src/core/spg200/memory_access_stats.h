@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "core/common.h"
+
+// Counts bus reads and writes per I/O register and per 1K-word region of the address space,
+// split by the component making them. CPU reads at the current PC are counted as instruction
+// fetches. Reads by debugging tools through Spg200::PeekWord are not counted.
+class MemoryAccessStats {
+public:
+  enum Requester {
+    REQUESTER_CPU_FETCH,
+    REQUESTER_CPU_DATA,
+    REQUESTER_PPU,
+    REQUESTER_SPU,
+    REQUESTER_DMA,
+    REQUESTER_COUNT
+  };
+
+  struct Counts {
+    std::array<uint64_t, REQUESTER_COUNT> reads = {};
+    std::array<uint64_t, REQUESTER_COUNT> writes = {};
+
+    uint64_t GetTotal() const;
+  };
+
+  static constexpr Addr kRegionWords = 0x400;
+  static constexpr Addr kRegionCount = 0x400000 / kRegionWords;
+  static constexpr Addr kRegisterStart = 0x2800;
+  static constexpr Addr kRegisterEnd = 0x4000;
+
+  MemoryAccessStats();
+
+  void Record(Addr addr, Requester requester, bool write) {
+    Counts& region = regions_[addr / kRegionWords];
+    (write ? region.writes : region.reads)[requester]++;
+    if (addr >= kRegisterStart && addr < kRegisterEnd) {
+      Counts& reg = registers_[addr - kRegisterStart];
+      (write ? reg.writes : reg.reads)[requester]++;
+    }
+  }
+
+  void Reset();
+
+  const Counts& GetRegion(Addr region) const;
+  const Counts& GetRegister(Addr addr) const;
+
+  static const char* GetRequesterName(int requester);
+  // Memory or I/O block that the address belongs to, such as RAM, PPU or external memory
+  static const char* GetAreaName(Addr addr);
+
+  // Writes one line per accessed register, followed by one per accessed region, with reads and
+  // writes of each requester
+  void WriteCsv(std::FILE* out) const;
+
+private:
+  std::vector<Counts> regions_;
+  std::vector<Counts> registers_;
+};
@@ -2,6 +2,7 @@
 
 #include "bus_interface.h"
 #include "irq.h"
+#include "core/serializer.h"
 
 namespace {
 inline Addr CalculateLineSegmentAddr(Word segment_ptr, int ch, int tile_y, int tile_width,
@@ -54,6 +55,32 @@ void Ppu::Reset() {
   UpdateIrq();
 }
 
+void Ppu::Serialize(Serializer& s) {
+  s.Value(framebuffer_);
+  s.Value(cur_scanline_);
+  scanline_clock_.Serialize(s);
+  s.Value(frame_count_);
+  s.Value(irq_ctrl_.raw);
+  s.Value(irq_status_.raw);
+  s.Value(bg_data_);
+  s.Value(sprite_data_);
+  s.Value(sprite_segment_ptr_);
+  s.Value(stn_lcd_control_);
+  s.Value(blend_level_);
+  s.Value(fade_level_);
+  s.Value(vertical_compress_amount_);
+  s.Value(vertical_compress_offset_);
+  s.Value(line_scroll_);
+  s.Value(line_compress_);
+  s.Value(palette_memory_);
+  s.Value(sprite_enable_);
+  s.Value(sprite_dma_source_);
+  s.Value(sprite_dma_target_);
+  s.Value(sprite_dma_length_);
+  s.Value(irq_vpos_);
+  s.Value(irq_hpos_);
+}
+
 bool Ppu::RunCycles(int cycles) {
   if (scanline_clock_.Tick(cycles)) {
     const int scanlines = video_timing_ == VideoTiming::NTSC ? 262 : 312;
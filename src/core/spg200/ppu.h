@@ -8,6 +8,7 @@
 
 class BusInterface;
 class Irq;
+class Serializer;
 
 class Ppu {
 public:
@@ -15,6 +16,7 @@ public:
 
   bool RunCycles(int cycles);
   void Reset();
+  void Serialize(Serializer& s);
   void SetViewSettings(PpuViewSettings& view_settings);
 
   Word GetBgXScroll(int bg_index);
@@ -1,15 +1,35 @@
 #include "random.h"
 
-#include <cstdlib>
+#include <random>
+
+#include "core/serializer.h"
+
+Random::Random() : host_state_(std::random_device()() | 1) {}
 
 void Random::Set(Word value) {
   seed_ = value;
 }
+
+void Random::SetDeterministic(bool deterministic) {
+  deterministic_ = deterministic;
+}
+
+void Random::Serialize(Serializer& s) {
+  s.Value(seed_);
+}
+
 Word Random::Get() {
-  return rand() & 0x7fff;
-  // word_t value = seed;
-  // update_seed();
-  // return value;
+  // Host randomness is not part of the machine state, so replays need the hardware LFSR instead
+  if (!deterministic_) {
+    host_state_ ^= host_state_ << 13;
+    host_state_ ^= host_state_ >> 17;
+    host_state_ ^= host_state_ << 5;
+    return host_state_ & 0x7fff;
+  }
+
+  Word value = seed_ & 0x7fff;
+  UpdateSeed();
+  return value;
 }
 
 void Random::UpdateSeed() {
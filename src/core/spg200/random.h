@@ -2,12 +2,21 @@
 
 #include "core/common.h"
 
+class Serializer;
+
 class Random {
 public:
+  Random();
+
   void Set(Word value);
+  void SetDeterministic(bool deterministic);
+  void Serialize(Serializer& s);
   Word Get();
 
 private:
   void UpdateSeed();
   Word seed_ = 0;
+  bool deterministic_ = false;
+  // Host randomness, kept per instance so that machines on different threads do not share it
+  uint32_t host_state_;
 };
\ No newline at end of file
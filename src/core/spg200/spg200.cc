@@ -1,5 +1,12 @@
 #include "spg200.h"
 
+#include <algorithm>
+
+#include "call_graph_profiler.h"
+#include "core/host_clock.h"
+#include "core/serializer.h"
+#include "instruction_profiler.h"
+#include "memory_access_stats.h"
 #include "spg200_io.h"
 
 Spg200::Spg200(VideoTiming video_timing, Spg200Io& io)
@@ -18,7 +25,9 @@ Spg200::Spg200(VideoTiming video_timing, Spg200Io& io)
       watchdog_(cpu_) {}
 
 void Spg200::Reset() {
+  cycles_in_frame_ = 0;
   ram_.fill(0);
+  ram_dirty_pages_.MarkAll();
   cpu_.Reset();
   ppu_.Reset();
   spu_.Reset();
@@ -35,25 +44,198 @@ void Spg200::Reset() {
   SetSystemControl(0);
 }
 
-void Spg200::Step() {}
+void Spg200::Serialize(Serializer& s) {
+  s.Value(ram_);
+  if (s.IsLoading())
+    ram_dirty_pages_.MarkAll();
+  cpu_.Serialize(s);
+  ppu_.Serialize(s);
+  spu_.Serialize(s);
+  SerializeSystem(s);
+}
 
-void Spg200::RunFrame() {
-  int cycles_in_frame = 0;
-  for (;;) {
-    int cycles = cpu_.Step();
-    cycles_in_frame += cycles;
-    // cpu_.PrintRegisterState();
-
-    io_.RunCycles(cycles);
-    adc_.RunCycles(cycles);
-    uart_.RunCycles(cycles);
-    timer_.RunCycles(cycles);
-    spu_.RunCycles(cycles);
-    if (ppu_.RunCycles(cycles))
-      break;
+// System control and the smaller peripherals, hashed together
+void Spg200::SerializeSystem(Serializer& s) {
+  s.Value(system_ctrl_.raw);
+  s.Value(cycles_in_frame_);
+  irq_.Serialize(s);
+  timer_.Serialize(s);
+  extmem_.Serialize(s);
+  gpio_.Serialize(s);
+  adc_.Serialize(s);
+  uart_.Serialize(s);
+  dma_.Serialize(s);
+  random1_.Serialize(s);
+  random2_.Serialize(s);
+  watchdog_.Serialize(s);
+}
+
+VideoTiming Spg200::GetVideoTiming() const {
+  return video_timing_;
+}
+
+uint64_t Spg200::StateHashes::GetCombined() const {
+  Xxh64 hasher;
+  for (uint64_t hash : {cpu, ram, ppu, spu, io}) {
+    hasher.Update(&hash, sizeof hash);
+  }
+  return hasher.Digest();
+}
+
+template <typename T>
+static uint64_t HashComponent(T& component) {
+  Xxh64 hasher;
+  Serializer s(hasher);
+  component.Serialize(s);
+  return hasher.Digest();
+}
+
+std::array<double, 5> Spg200::ComponentTimes::GetShares() const {
+  const std::array<double, 5> ticks = {static_cast<double>(cpu), static_cast<double>(ppu),
+                                       static_cast<double>(spu), static_cast<double>(timers),
+                                       static_cast<double>(other)};
+  // Every component is timed once per instruction
+  const double reads = HostClock::GetReadTicks() * instructions;
+  std::array<double, 5> net = {};
+  double total = 0;
+  double net_total = 0;
+  for (size_t i = 0; i < ticks.size(); i++) {
+    net[i] = std::max(ticks[i] - reads, 0.0);
+    total += ticks[i];
+    net_total += net[i];
   }
+
+  // Falls back to the measured proportions if the clock reads took all of the time
+  const auto& parts = net_total > 0 ? net : ticks;
+  const double sum = net_total > 0 ? net_total : total;
+  std::array<double, 5> shares = {};
+  for (size_t i = 0; i < ticks.size(); i++) {
+    if (sum > 0)
+      shares[i] = parts[i] / sum;
+  }
+  return shares;
+}
+
+Spg200::StateHashes Spg200::HashState() {
+  StateHashes hashes;
+  hashes.cpu = HashComponent(cpu_);
+  hashes.ram = ram_hash_.Update(ram_dirty_pages_, ram_.data());
+  hashes.ppu = HashComponent(ppu_);
+  hashes.spu = HashComponent(spu_);
+
+  Xxh64 hasher;
+  Serializer s(hasher);
+  SerializeSystem(s);
+  hashes.io = hasher.Digest();
+  return hashes;
+}
+
+// Shared by RunFrame and Step, forcibly inlined to keep the frame loop free of calls
+template <bool kProfileInstructions>
+inline bool Spg200::RunInstruction() {
+  int cycles = kProfileInstructions ? StepCpuProfiled() : cpu_.Step();
+  cycles_in_frame_ += cycles;
+  // cpu_.PrintRegisterState();
+
+  io_.RunCycles(cycles);
+  adc_.RunCycles(cycles);
+  uart_.RunCycles(cycles);
+  timer_.RunCycles(cycles);
+  if constexpr (kProfileInstructions)
+    access_requester_ = MemoryAccessStats::REQUESTER_SPU;
+  spu_.RunCycles(cycles);
+  if constexpr (kProfileInstructions)
+    access_requester_ = MemoryAccessStats::REQUESTER_PPU;
+  if (!ppu_.RunCycles(cycles))
+    return false;
+
   // The watchdog timer can be checked less often
-  watchdog_.RunCycles(cycles_in_frame);
+  watchdog_.RunCycles(cycles_in_frame_);
+  cycles_in_frame_ = 0;
+  return true;
+}
+
+// Same as RunInstruction, attributing the time since the last lap to each component
+bool Spg200::RunInstructionProfiled(uint64_t& time) {
+  auto lap = [&time](uint64_t& total) {
+    const uint64_t now = HostClock::Now();
+    total += now - time;
+    time = now;
+  };
+
+  component_times_.instructions++;
+  int cycles = HasInstrumentation() ? StepCpuProfiled() : cpu_.Step();
+  cycles_in_frame_ += cycles;
+  lap(component_times_.cpu);
+
+  io_.RunCycles(cycles);
+  adc_.RunCycles(cycles);
+  uart_.RunCycles(cycles);
+  lap(component_times_.other);
+  timer_.RunCycles(cycles);
+  lap(component_times_.timers);
+  access_requester_ = MemoryAccessStats::REQUESTER_SPU;
+  spu_.RunCycles(cycles);
+  lap(component_times_.spu);
+  access_requester_ = MemoryAccessStats::REQUESTER_PPU;
+  const bool frame_finished = ppu_.RunCycles(cycles);
+  lap(component_times_.ppu);
+  if (!frame_finished)
+    return false;
+
+  watchdog_.RunCycles(cycles_in_frame_);
+  cycles_in_frame_ = 0;
+  lap(component_times_.timers);
+  return true;
+}
+
+// Runs a CPU step, recording it to the instruction and call graph profilers
+int Spg200::StepCpuProfiled() {
+  const Addr pc = cpu_.GetCsPc();
+  const auto interrupt = call_graph_profiler_ ? cpu_.GetPendingInterrupt() : std::nullopt;
+  const Word instruction = call_graph_profiler_ && !interrupt ? PeekWord(pc) : 0;
+
+  access_requester_ = MemoryAccessStats::REQUESTER_CPU_DATA;
+  const int cycles = cpu_.Step();
+  if (instruction_profiler_)
+    instruction_profiler_->Record(pc, cycles);
+  if (call_graph_profiler_) {
+    call_graph_profiler_->Record(instruction, interrupt, cpu_.GetCsPc(),
+                                 cpu_.GetRegisters()[0], cycles);
+  }
+  return cycles;
+}
+
+bool Spg200::HasInstrumentation() const {
+  return instruction_profiler_ || call_graph_profiler_ || access_stats_;
+}
+
+void Spg200::RunFrame() {
+  if (profiling_enabled_) {
+    uint64_t time = HostClock::Now();
+    while (!RunInstructionProfiled(time)) {
+    }
+    return;
+  }
+
+  if (HasInstrumentation()) {
+    while (!RunInstruction<true>()) {
+    }
+    return;
+  }
+
+  while (!RunInstruction<false>()) {
+  }
+}
+
+bool Spg200::Step() {
+  if (profiling_enabled_) {
+    uint64_t time = HostClock::Now();
+    return RunInstructionProfiled(time);
+  }
+  if (HasInstrumentation())
+    return RunInstruction<true>();
+  return RunInstruction<false>();
 }
 
 std::span<uint8_t> Spg200::GetPicture() const {
@@ -64,10 +246,51 @@ std::span<uint16_t> Spg200::GetAudio() {
   return spu_.GetAudio();
 }
 
+void Spg200::SetAudioEnabled(bool enabled) {
+  spu_.SetMixingEnabled(enabled);
+}
+
+void Spg200::SetDeterministicRandom(bool deterministic) {
+  random1_.SetDeterministic(deterministic);
+  random2_.SetDeterministic(deterministic);
+}
+
+void Spg200::SetProfilingEnabled(bool enabled) {
+  profiling_enabled_ = enabled;
+}
+
+const Spg200::ComponentTimes& Spg200::GetComponentTimes() const {
+  return component_times_;
+}
+
+void Spg200::ResetComponentTimes() {
+  component_times_ = {};
+}
+
+void Spg200::SetInstructionProfiler(InstructionProfiler* profiler) {
+  instruction_profiler_ = profiler;
+}
+
+void Spg200::SetCallGraphProfiler(CallGraphProfiler* profiler) {
+  call_graph_profiler_ = profiler;
+}
+
+void Spg200::SetMemoryAccessStats(MemoryAccessStats* stats) {
+  access_stats_ = stats;
+}
+
+MemoryAccessStats* Spg200::GetMemoryAccessStats() {
+  return access_stats_;
+}
+
 void Spg200::SetPpuViewSettings(PpuViewSettings& ppu_view_settings) {
   ppu_.SetViewSettings(ppu_view_settings);
 }
 
+Spg200::RamDirtyPages& Spg200::GetRamDirtyPages() {
+  return ram_dirty_pages_;
+}
+
 void Spg200::UartTx(uint8_t value) {
   uart_.RxStart(value);
 }
@@ -80,7 +303,7 @@ void Spg200::SetExt2Irq(bool value) {
   irq_.SetExt2Irq(value);
 }
 
-Word Spg200::ReadWord(Addr addr) {
+inline Word Spg200::ReadBus(Addr addr) {
   addr = addr & 0x3fffff;
   switch (addr) {
     case 0 ... 0x27ff:
@@ -352,11 +575,12 @@ Word Spg200::ReadWord(Addr addr) {
   }
 };
 
-void Spg200::WriteWord(Addr addr, Word value) {
+inline void Spg200::WriteBus(Addr addr, Word value) {
   addr = addr & 0x3fffff;
   switch (addr) {
     case 0 ... 0x27ff:
       ram_[addr] = value;
+      ram_dirty_pages_.MarkWrite(addr);
       return;
     case 0x2810:
     case 0x2816: {
@@ -440,7 +664,7 @@ void Spg200::WriteWord(Addr addr, Word value) {
       ppu_.SetSpriteDmaTarget(value);
       return;
     case 0x2872:
-      ppu_.StartSpriteDma(value);
+      StartSpriteDma(value);
       return;
     case 0x2900 ... 0x29ff:
       ppu_.SetLineScroll(addr & 0xff, value);
@@ -661,6 +885,7 @@ void Spg200::WriteWord(Addr addr, Word value) {
       return;
     case 0x3d22:
       irq_.ClearIoIrqStatus(value);
+      timer_.ScheduleNextEvent();
       return;
     case 0x3d23:
       extmem_.SetControl(value);
@@ -709,7 +934,7 @@ void Spg200::WriteWord(Addr addr, Word value) {
       dma_.SetSourceHi(value);
       return;
     case 0x3e02:
-      dma_.StartDma(value);
+      StartDma(value);
       return;
     case 0x3e03:
       dma_.SetTarget(value);
@@ -721,11 +946,46 @@ void Spg200::WriteWord(Addr addr, Word value) {
   }
 }
 
+Word Spg200::ReadWord(Addr addr) {
+  if (access_stats_) [[unlikely]]
+    RecordAccess(addr & 0x3fffff, false);
+  return ReadBus(addr);
+}
+
+void Spg200::WriteWord(Addr addr, Word value) {
+  if (access_stats_) [[unlikely]]
+    RecordAccess(addr & 0x3fffff, true);
+  WriteBus(addr, value);
+}
+
+// CPU reads at the current PC are taken to be instruction fetches
+void Spg200::RecordAccess(Addr addr, bool write) {
+  auto requester = static_cast<MemoryAccessStats::Requester>(access_requester_);
+  if (requester == MemoryAccessStats::REQUESTER_CPU_DATA && !write && addr == cpu_.GetCsPc())
+    requester = MemoryAccessStats::REQUESTER_CPU_FETCH;
+  access_stats_->Record(addr, requester, write);
+}
+
+// DMA started by a register write accesses the bus on behalf of the DMA controller
+void Spg200::StartDma(Word value) {
+  const int requester = access_requester_;
+  access_requester_ = MemoryAccessStats::REQUESTER_DMA;
+  dma_.StartDma(value);
+  access_requester_ = requester;
+}
+
+void Spg200::StartSpriteDma(Word value) {
+  const int requester = access_requester_;
+  access_requester_ = MemoryAccessStats::REQUESTER_DMA;
+  ppu_.StartSpriteDma(value);
+  access_requester_ = requester;
+}
+
 Word Spg200::PeekWord(Addr addr) {
   if (addr == 0x3d36) {
     return uart_.PeekRx();
   }
-  return ReadWord(addr);
+  return ReadBus(addr);
 }
 
 Word Spg200::GetSystemControl() {
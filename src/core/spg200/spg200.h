@@ -1,8 +1,11 @@
 #pragma once
 
+#include <array>
+
 #include "adc.h"
 #include "bus_interface.h"
 #include "core/common.h"
+#include "core/state/dirty_page_tracker.h"
 #include "cpu.h"
 #include "dma.h"
 #include "extmem.h"
@@ -17,26 +20,76 @@
 #include "uart.h"
 #include "watchdog.h"
 
+class CallGraphProfiler;
+class InstructionProfiler;
+class MemoryAccessStats;
+class Serializer;
 class Spg200Io;
 
 class Spg200 : public BusInterface {
 public:
+  using RamDirtyPages = DirtyPageTracker<0x2800>;
+
   Spg200(VideoTiming video_timing, Spg200Io& io);
   ~Spg200() = default;
 
+  // Hashes of machine state by component, for locating where two runs diverge
+  struct StateHashes {
+    uint64_t cpu = 0;
+    uint64_t ram = 0;
+    uint64_t ppu = 0;
+    uint64_t spu = 0;
+    uint64_t io = 0;
+
+    uint64_t GetCombined() const;
+  };
+
+  // Host time spent in each component while profiling is enabled, in HostClock ticks. Profiled
+  // frames run a separate, slower loop, so disabled profiling costs nothing per instruction.
+  struct ComponentTimes {
+    uint64_t instructions = 0;
+    uint64_t cpu = 0;
+    uint64_t ppu = 0;
+    uint64_t spu = 0;
+    uint64_t timers = 0;
+    uint64_t other = 0;  // IO, ADC and UART
+
+    // Shares of the CPU, PPU, SPU, timers and other in the time, without the clock reads
+    // between them. Components that took no longer than the clock reads get no share.
+    std::array<double, 5> GetShares() const;
+  };
+
   void RunFrame();
-  void Step();
+  // Runs a single instruction and returns whether it completed a frame
+  bool Step();
   void Reset();
+  void Serialize(Serializer& s);
+  StateHashes HashState();
 
   void UartTx(uint8_t value);
   void SetExt1Irq(bool value);
   void SetExt2Irq(bool value);
 
+  VideoTiming GetVideoTiming() const;
   std::span<uint8_t> GetPicture() const;
   std::span<uint16_t> GetAudio();
+  void SetAudioEnabled(bool enabled);
+  void SetDeterministicRandom(bool deterministic);
+  void SetProfilingEnabled(bool enabled);
+  const ComponentTimes& GetComponentTimes() const;
+  void ResetComponentTimes();
+  // Records every instruction to the profiler until set to null. Frames run in a separate loop
+  // while a profiler is set, like with profiling enabled.
+  void SetInstructionProfiler(InstructionProfiler* profiler);
+  void SetCallGraphProfiler(CallGraphProfiler* profiler);
+  // Counts bus accesses until set to null, running frames in the same loop as the profilers
+  void SetMemoryAccessStats(MemoryAccessStats* stats);
+  MemoryAccessStats* GetMemoryAccessStats();
 
   void SetPpuViewSettings(PpuViewSettings& ppu_view_settings);
 
+  RamDirtyPages& GetRamDirtyPages();
+
   // BusInterface
   Word ReadWord(Addr addr) override;
   void WriteWord(Addr addr, Word val) override;
@@ -45,13 +98,35 @@ public:
   Word PeekWord(Addr addr);
 
 private:
+  template <bool kProfileInstructions>
+  inline __attribute__((always_inline)) bool RunInstruction();
+  bool RunInstructionProfiled(uint64_t& time);
+  int StepCpuProfiled();
+  bool HasInstrumentation() const;
+  inline __attribute__((always_inline)) Word ReadBus(Addr addr);
+  inline __attribute__((always_inline)) void WriteBus(Addr addr, Word value);
+  void RecordAccess(Addr addr, bool write);
+  void StartDma(Word value);
+  void StartSpriteDma(Word value);
+  void SerializeSystem(Serializer& s);
+
   Word GetSystemControl();
   void SetSystemControl(Word value);
 
   const VideoTiming video_timing_;
   Spg200Io& io_;
 
+  int cycles_in_frame_ = 0;
+  bool profiling_enabled_ = false;
+  ComponentTimes component_times_;
+  InstructionProfiler* instruction_profiler_ = nullptr;
+  CallGraphProfiler* call_graph_profiler_ = nullptr;
+  MemoryAccessStats* access_stats_ = nullptr;
+  // Component on whose behalf the bus is accessed, only kept up to date while access_stats_ is set
+  int access_requester_ = 0;
   std::array<uint16_t, 0x2800> ram_ = {0};
+  RamDirtyPages ram_dirty_pages_;
+  PagedHash<0x2800> ram_hash_;
   union SystemControl {
     Word raw = 0;
     Bitfield<15, 1> watchdog_enable;
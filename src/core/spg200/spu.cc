@@ -3,6 +3,7 @@
 #include "bus_interface.h"
 #include "cpu.h"
 #include "irq.h"
+#include "core/serializer.h"
 
 #include <algorithm>
 
@@ -16,6 +17,8 @@ Spu::Spu(BusInterface& bus, Irq& irq) : bus_(bus), irq_(irq) {}
 
 void Spu::Reset() {
   audio_buffer_pos_ = 0;
+  wave_out_stale_ = false;
+  mix_channels_.reset();
   sample_clock_.Reset();
   envelope_clock_.Reset();
   rampdown_clock_.Reset();
@@ -44,6 +47,69 @@ void Spu::Reset() {
   control_.raw = 0;
 }
 
+void Spu::Serialize(Serializer& s) {
+  // Audio buffer contents are not part of the state, only samples generated after loading are
+  // returned by GetAudio
+  if (s.IsLoading())
+    audio_buffer_pos_ = 0;
+  // Deferred mixing is resolved first, so that the state does not depend on whether audio was
+  // enabled
+  if (!s.IsLoading())
+    SyncWaveOut();
+  s.Value(wave_out_stale_);
+  s.Value(mix_channels_);
+  sample_clock_.Serialize(s);
+  envelope_clock_.Serialize(s);
+  rampdown_clock_.Serialize(s);
+  for (auto& channel : channel_data_) {
+    channel.Serialize(s);
+  }
+  s.Value(channel_enable_);
+  s.Value(channel_fiq_enable_);
+  s.Value(channel_fiq_status_);
+  s.Value(channel_env_rampdown_);
+  s.Value(channel_stop_);
+  s.Value(channel_zero_cross_);
+  s.Value(channel_repeat_);
+  s.Value(channel_env_mode_);
+  s.Value(channel_tone_release_);
+  s.Value(channel_env_irq_);
+  s.Value(channel_pitch_bend_);
+  s.Value(wave_out_l_);
+  s.Value(wave_out_r_);
+  s.Value(wave_in_l_);
+  s.Value(wave_in_r_);
+  s.Value(main_volume_);
+  s.Value(beat_base_count_);
+  s.Value(current_beat_base_count_);
+  s.Value(beat_count_.raw);
+  s.Value(control_.raw);
+}
+
+// Serialized field by field, since the structure contains padding
+void Spu::ChannelData::Serialize(Serializer& s) {
+  s.Value(wave_address);
+  s.Value(loop_address);
+  s.Value(wave_shift);
+  s.Value(envelope_address);
+  s.Value(mode.raw);
+  s.Value(pan.raw);
+  s.Value(envelope0.raw);
+  s.Value(envelope1.raw);
+  s.Value(envelope_irq.raw);
+  s.Value(envelope_data.raw);
+  s.Value(envelope_loop_control.raw);
+  s.Value(wave_data_0);
+  s.Value(wave_data);
+  s.Value(phase);
+  s.Value(phase_acc);
+  s.Value(target_phase);
+  s.Value(env_clk);
+  s.Value(rampdown_clk);
+  s.Value(pitch_bend_control.raw);
+  adpcm.Serialize(s);
+}
+
 void Spu::RunCycles(int cycles) {
   if (sample_clock_.Tick(cycles)) {
     GenerateSample();
@@ -75,13 +141,36 @@ void Spu::RunCycles(int cycles) {
 }
 
 void Spu::GenerateSample() {
+  wave_out_stale_ = false;
+
+  // Channels stopped by their own tick are still part of this sample's mix
+  mix_channels_ = channel_enable_ & ~channel_stop_;
+  for (int channel_index = 0; channel_index < 16; channel_index++) {
+    if (mix_channels_[channel_index])
+      TickChannel(channel_index);
+  }
+
+  if (!mixing_enabled_) {
+    // Defer mixing until the wave out registers are read or mixer inputs are about to change
+    wave_out_stale_ = true;
+    return;
+  }
+
+  MixSample();
+
+  audio_buffer_[audio_buffer_pos_++] = wave_out_l_;
+  audio_buffer_[audio_buffer_pos_++] = wave_out_r_;
+  if (audio_buffer_pos_ == audio_buffer_.size())
+    audio_buffer_pos_ = 0;
+}
+
+void Spu::MixSample() {
   int32_t left_out = 0;
   int32_t right_out = 0;
   for (int channel_index = 0; channel_index < 16; channel_index++) {
     const auto& channel = channel_data_[channel_index];
-    if (!channel_enable_[channel_index] || channel_stop_[channel_index])
+    if (!mix_channels_[channel_index])
       continue;
-    TickChannel(channel_index);
 
     uint16_t prev_sample_part =
         (static_cast<uint64_t>(channel.wave_data_0) * ((1 << 19) - channel.phase_acc)) >> 19;
@@ -106,11 +195,7 @@ void Spu::GenerateSample() {
 
   wave_out_l_ = left_final ^ 0x8000;
   wave_out_r_ = right_final ^ 0x8000;
-
-  audio_buffer_[audio_buffer_pos_++] = wave_out_l_;
-  audio_buffer_[audio_buffer_pos_++] = wave_out_r_;
-  if (audio_buffer_pos_ == audio_buffer_.size() + 1)
-    audio_buffer_pos_ = 0;
+  wave_out_stale_ = false;
 }
 
 void Spu::UpdateEnvelopes() {
@@ -206,6 +291,7 @@ void Spu::TickChannelEnvelope(int channel_index) {
 
     if (channel.envelope_data.count == 0) {
       if (channel.envelope_data.edd != channel.envelope0.target) {
+        SyncWaveOut();
         if (channel.envelope0.sign) {
           channel.envelope_data.edd = std::clamp(
               static_cast<int>(channel.envelope_data.edd) - static_cast<int>(channel.envelope0.inc),
@@ -282,6 +368,7 @@ void Spu::TickChannelRampdown(int channel_index) {
   auto& channel = channel_data_[channel_index];
   if (channel_env_rampdown_[channel_index] &&
       rampdown_clock_.GetDividedTick(kRampdownFrameDivides[channel.rampdown_clk])) {
+    SyncWaveOut();
     channel.envelope_data.edd =
         std::clamp(static_cast<int>(channel.envelope_data.edd) -
                        static_cast<int>(channel.envelope_loop_control.rampdown_offset),
@@ -304,6 +391,7 @@ void Spu::StartChannel(int channel_index) {
 }
 
 void Spu::StopChannel(int channel_index) {
+  SyncWaveOut();
   channel_stop_[channel_index] = true;
 
   channel_tone_release_[channel_index] = false;
@@ -322,6 +410,11 @@ void Spu::UpdateBeatIrq() {
   irq_.SetSpuBeatIrq(beat_enabled || envirq_enabled);
 }
 
+void Spu::SetMixingEnabled(bool enabled) {
+  SyncWaveOut();
+  mixing_enabled_ = enabled;
+}
+
 std::span<uint16_t> Spu::GetAudio() {
   auto size = audio_buffer_pos_;
   audio_buffer_pos_ = 0;
@@ -366,6 +459,7 @@ Word Spu::GetPan(int channel_index) {
 }
 
 void Spu::SetPan(int channel_index, Word value) {
+  SyncWaveOut();
   channel_data_[channel_index].pan.raw = value & ChannelData::Pan::WriteMask;
 }
 
@@ -382,6 +476,7 @@ Word Spu::GetEnvelopeData(int channel_index) {
 }
 
 void Spu::SetEnvelopeData(int channel_index, Word value) {
+  SyncWaveOut();
   channel_data_[channel_index].envelope_data.raw = value & ChannelData::EnvelopeData::WriteMask;
 }
 
@@ -418,6 +513,7 @@ Word Spu::GetWaveData0(int channel_index) {
 }
 
 void Spu::SetWaveData0(int channel_index, Word value) {
+  SyncWaveOut();
   channel_data_[channel_index].wave_data_0 = value;
 }
 
@@ -434,6 +530,7 @@ Word Spu::GetWaveData(int channel_index) {
 }
 
 void Spu::SetWaveData(int channel_index, Word value) {
+  SyncWaveOut();
   channel_data_[channel_index].wave_data = value;
 }
 
@@ -451,6 +548,7 @@ Word Spu::GetPhaseAccumulatorHi(int channel_index) {
 }
 
 void Spu::SetPhaseAccumulatorHi(int channel_index, Word value) {
+  SyncWaveOut();
   auto& phase_acc = channel_data_[channel_index].phase_acc;
   phase_acc = ((value & 0x07) << 16) | (phase_acc & 0xffff);
 }
@@ -486,6 +584,7 @@ Word Spu::GetPhaseAccumulatorLo(int channel_index) {
 }
 
 void Spu::SetPhaseAccumulatorLo(int channel_index, Word value) {
+  SyncWaveOut();
   auto& phase_acc = channel_data_[channel_index].phase_acc;
   phase_acc = (phase_acc & ~0xffff) | value;
 }
@@ -512,6 +611,7 @@ Word Spu::GetChannelEnable() {
 }
 
 void Spu::SetChannelEnable(Word value) {
+  SyncWaveOut();
   auto old_channel_enable = channel_enable_;
   channel_enable_ = value;
   for (int channel_index = 0; channel_index < 16; channel_index++) {
@@ -534,6 +634,7 @@ Word Spu::GetMainVolume() {
 }
 
 void Spu::SetMainVolume(Word value) {
+  SyncWaveOut();
   main_volume_ = value & 0x7f;
 }
 
@@ -636,6 +737,7 @@ Word Spu::GetChannelStop() {
 }
 
 void Spu::ClearChannelStop(Word value) {
+  SyncWaveOut();
   auto old_channel_stop = channel_stop_;
   channel_stop_ &= ~value;
 
@@ -662,6 +764,7 @@ Word Spu::GetControl() {
 }
 
 void Spu::SetControl(Word value) {
+  SyncWaveOut();
   bool old_overflow = control_.overflow;
   control_.raw = value & Control::WriteMask;
   control_.overflow = old_overflow;
@@ -672,18 +775,22 @@ Word Spu::GetChannelStatus() {
 }
 
 void Spu::SetWaveInLeft(Word value) {
+  SyncWaveOut();
   wave_in_l_ = value;
 }
 
 void Spu::SetWaveInRight(Word value) {
+  SyncWaveOut();
   wave_in_r_ = value;
 }
 
 Word Spu::GetWaveOutLeft() {
+  SyncWaveOut();
   return wave_out_l_;
 }
 
 Word Spu::GetWaveOutRight() {
+  SyncWaveOut();
   return wave_out_r_;
 }
 
@@ -9,16 +9,23 @@
 
 class BusInterface;
 class Irq;
+class Serializer;
 
 class Spu {
 public:
+  static constexpr int SampleRate = 281250;
+
   Spu(BusInterface& bus, Irq& irq_);
 
   void Reset();
+  void Serialize(Serializer& s);
   void RunCycles(int cycles);
 
   std::span<uint16_t> GetAudio();
 
+  // When disabled, channels are still advanced but output is neither mixed nor buffered
+  void SetMixingEnabled(bool enabled);
+
   /* 30xx values */
   Word GetWaveAddressLo(int channel_index);
   void SetWaveAddressLo(int channel_index, Word value);
@@ -114,6 +121,11 @@ public:
 
 private:
   void GenerateSample();
+  void MixSample();
+  inline void SyncWaveOut() {
+    if (wave_out_stale_)
+      MixSample();
+  }
   void UpdateEnvelopes();
   void UpdateRampdowns();
   void TickChannel(int channel_index);
@@ -129,6 +141,9 @@ private:
 
   std::array<uint16_t, 6144 * 2> audio_buffer_;
   size_t audio_buffer_pos_;
+  bool mixing_enabled_ = true;
+  bool wave_out_stale_ = false;
+  std::bitset<16> mix_channels_;
   SimpleClock<96> sample_clock_;
   DivisibleClock<384> envelope_clock_;
   DivisibleClock<13> rampdown_clock_;
@@ -199,6 +214,8 @@ private:
       Bitfield<0, 12> offset;
     } pitch_bend_control;
     Adpcm adpcm;
+
+    void Serialize(Serializer& s);
   };
 
   std::array<ChannelData, 16> channel_data_;
@@ -1,6 +1,9 @@
 #include "timer.h"
 
 #include "irq.h"
+#include "core/serializer.h"
+
+#include <algorithm>
 
 Timer::Timer(Irq& irq) : irq_(irq) {}
 
@@ -24,51 +27,137 @@ void Timer::Reset() {
   timer_b_enabled_ = false;
   timer_b_control_.source_c = 6;
   UpdateTimerBDivisors();
+
+  synced_tick_ = 0;
+  ScheduleNextEvent();
+}
+
+void Timer::Serialize(Serializer& s) {
+  timer_clock_.Serialize(s);
+  s.Value(timer_a_divisor_);
+  s.Value(timer_b_divisor_);
+  s.Value(timer_a_enabled_);
+  s.Value(timer_a_data_);
+  s.Value(timer_a_preload_);
+  s.Value(timer_b_enabled_);
+  s.Value(timer_b_data_);
+  s.Value(timer_b_preload_);
+  s.Value(synced_tick_);
+  s.Value(next_event_tick_);
+  s.Value(timebase_setup_.raw);
+  s.Value(timer_a_control_.raw);
+  s.Value(timer_b_control_.raw);
 }
 
 void Timer::RunCycles(int cycles) {
   while (timer_clock_.Tick(cycles)) {  // 32768 Hz tick
-    if (timer_a_enabled_ && timer_a_divisor_ >= 0 && timer_clock_.GetDividedTick(timer_a_divisor_))
-      TickTimerA();
+    if (timer_clock_.GetDivCounter() == next_event_tick_)
+      RunTick();
+  }
+}
+
+void Timer::RunTick() {
+  const unsigned tick = timer_clock_.GetDivCounter();
+  CatchUp(tick - 1);
+  synced_tick_ = tick;
+
+  if (timer_a_enabled_ && timer_a_divisor_ >= 0 && timer_clock_.GetDividedTick(timer_a_divisor_))
+    TickTimerA();
+
+  if (timer_b_enabled_ && timer_b_divisor_ >= 0 && timer_clock_.GetDividedTick(timer_b_divisor_))
+    TickTimerB();
+
+  TickTimebase();
+  ScheduleNextEvent();
+}
+
+void Timer::TickTimebase() {
+  if (!timer_clock_.GetDividedTick(3))
+    return;
+
+  irq_.Set4096HzIrq(true);
+
+  if (!timer_clock_.GetDividedTick(4))
+    return;
 
-    if (timer_b_enabled_ && timer_b_divisor_ >= 0 && timer_clock_.GetDividedTick(timer_b_divisor_))
-      TickTimerB();
+  irq_.Set2048HzIrq(true);
 
-    if (!timer_clock_.GetDividedTick(3))
-      continue;
+  if (!timer_clock_.GetDividedTick(5))
+    return;
 
-    irq_.Set4096HzIrq(true);
+  irq_.Set1024HzIrq(true);
 
-    if (!timer_clock_.GetDividedTick(4))
-      continue;
+  if (timer_clock_.GetDividedTick(8 - timebase_setup_.tmb2))
+    irq_.SetTmb2Irq(true);
 
-    irq_.Set2048HzIrq(true);
+  if (timer_clock_.GetDividedTick(12 - timebase_setup_.tmb1))
+    irq_.SetTmb1Irq(true);
 
-    if (!timer_clock_.GetDividedTick(5))
-      continue;
+  if (!timer_clock_.GetDividedTick(13))
+    return;
 
-    irq_.Set1024HzIrq(true);
+  irq_.Set4HzIrq(true);
+}
 
-    if (timer_clock_.GetDividedTick(8 - timebase_setup_.tmb2))
-      irq_.SetTmb2Irq(true);
+void Timer::CatchUp(unsigned tick) {
+  // Skipped ticks never overflow a timer, since overflows are always scheduled events
+  if (timer_a_enabled_ && timer_a_divisor_ >= 0) {
+    timer_a_data_ += (tick >> timer_a_divisor_) - (synced_tick_ >> timer_a_divisor_);
+  }
+  if (timer_b_enabled_ && timer_b_divisor_ >= 0) {
+    timer_b_data_ += (tick >> timer_b_divisor_) - (synced_tick_ >> timer_b_divisor_);
+  }
+  synced_tick_ = tick;
+}
 
-    if (timer_clock_.GetDividedTick(12 - timebase_setup_.tmb1))
-      irq_.SetTmb1Irq(true);
+void Timer::ScheduleNextEvent() {
+  CatchUp(timer_clock_.GetDivCounter());
 
-    if (!timer_clock_.GetDividedTick(13))
-      continue;
+  const unsigned now = synced_tick_;
+  unsigned next_event_distance = ~0u;
+  auto schedule = [&](unsigned tick) {
+    next_event_distance = std::min(next_event_distance, tick - now);
+  };
+  auto next_divided_tick = [&](unsigned div) { return (now | ((1u << div) - 1)) + 1; };
 
-    irq_.Set4HzIrq(true);
+  // Timers overflow after 0x10000 - data ticks of their divided clock
+  if (timer_a_enabled_ && timer_a_divisor_ >= 0) {
+    schedule(next_divided_tick(timer_a_divisor_) +
+             ((0xffffu - timer_a_data_) << timer_a_divisor_));
+  }
+  if (timer_b_enabled_ && timer_b_divisor_ >= 0) {
+    schedule(next_divided_tick(timer_b_divisor_) +
+             ((0xffffu - timer_b_data_) << timer_b_divisor_));
   }
+
+  // Timebase IRQs only have an effect when their status bit is not already set
+  const Word status = irq_.GetIoIrqStatus();
+  if (!(status & 0x0040))
+    schedule(next_divided_tick(3));
+  if (!(status & 0x0020))
+    schedule(next_divided_tick(4));
+  if (!(status & 0x0010))
+    schedule(next_divided_tick(5));
+  if (!(status & 0x0002))
+    schedule(next_divided_tick(8 - timebase_setup_.tmb2));
+  if (!(status & 0x0001))
+    schedule(next_divided_tick(12 - timebase_setup_.tmb1));
+  if (!(status & 0x0008))
+    schedule(next_divided_tick(13));
+
+  next_event_tick_ = now + next_event_distance;
 }
 
 Word Timer::GetTimerAData() {
+  CatchUp(timer_clock_.GetDivCounter());
   return timer_a_data_;
 }
 
 void Timer::SetTimerAData(Word value) {
+  CatchUp(timer_clock_.GetDivCounter());
   timer_a_preload_ = value;
   timer_a_data_ = value;
+  ScheduleNextEvent();
 }
 
 Word Timer::GetTimerAControl() {
@@ -76,9 +165,11 @@ Word Timer::GetTimerAControl() {
 }
 
 void Timer::SetTimerAControl(Word value) {
+  CatchUp(timer_clock_.GetDivCounter());
   timer_a_control_.raw = value;
 
   UpdateTimerADivisors();
+  ScheduleNextEvent();
 }
 
 Word Timer::GetTimerAEnabled() {
@@ -86,7 +177,9 @@ Word Timer::GetTimerAEnabled() {
 }
 
 void Timer::SetTimerAEnabled(Word value) {
+  CatchUp(timer_clock_.GetDivCounter());
   timer_a_enabled_ = value & 1;
+  ScheduleNextEvent();
 }
 
 void Timer::ClearTimerAIrq() {
@@ -94,12 +187,15 @@ void Timer::ClearTimerAIrq() {
 }
 
 Word Timer::GetTimerBData() {
+  CatchUp(timer_clock_.GetDivCounter());
   return timer_b_data_;
 }
 
 void Timer::SetTimerBData(Word value) {
+  CatchUp(timer_clock_.GetDivCounter());
   timer_b_preload_ = value;
   timer_b_data_ = value;
+  ScheduleNextEvent();
 }
 
 Word Timer::GetTimerBControl() {
@@ -107,9 +203,11 @@ Word Timer::GetTimerBControl() {
 }
 
 void Timer::SetTimerBControl(Word value) {
+  CatchUp(timer_clock_.GetDivCounter());
   timer_b_control_.raw = value;
 
   UpdateTimerBDivisors();
+  ScheduleNextEvent();
 }
 
 Word Timer::GetTimerBEnabled() {
@@ -117,7 +215,9 @@ Word Timer::GetTimerBEnabled() {
 }
 
 void Timer::SetTimerBEnabled(Word value) {
+  CatchUp(timer_clock_.GetDivCounter());
   timer_b_enabled_ = value & 1;
+  ScheduleNextEvent();
 }
 
 void Timer::ClearTimerBIrq() {
@@ -129,13 +229,18 @@ Word Timer::GetTimebaseSetup() {
 }
 
 void Timer::SetTimebaseSetup(Word value) {
+  CatchUp(timer_clock_.GetDivCounter());
   timebase_setup_.raw = value & timebase_setup_.WriteMask;
 
   UpdateTimerADivisors();
+  ScheduleNextEvent();
 }
 
 void Timer::ClearTimebaseCounter() {
+  CatchUp(timer_clock_.GetDivCounter());
   timer_clock_.ClearDivCounter();
+  synced_tick_ = 0;
+  ScheduleNextEvent();
 }
 
 void Timer::TickTimerA() {
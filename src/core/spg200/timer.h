@@ -3,11 +3,13 @@
 #include "core/common.h"
 
 class Irq;
+class Serializer;
 
 class Timer {
 public:
   Timer(Irq& irq);
   void Reset();
+  void Serialize(Serializer& s);
   void RunCycles(int cycles);
 
   Word GetTimebaseSetup();
@@ -37,6 +39,9 @@ public:
 
   void ClearTimerBIrq();
 
+  // Must be called after timebase IRQ status bits are cleared
+  void ScheduleNextEvent();
+
 private:
   Irq& irq_;
   DivisibleClock<27000000, 32768> timer_clock_;
@@ -51,6 +56,14 @@ private:
   Word timer_b_data_ = 0;
   Word timer_b_preload_ = 0;
 
+  // Ticks where nothing observable happens are skipped. Timer data is caught up in bulk
+  // from synced_tick_ on access, and the full tick logic runs only at next_event_tick_.
+  unsigned synced_tick_ = 0;
+  unsigned next_event_tick_ = 0;
+
+  void RunTick();
+  void TickTimebase();
+  void CatchUp(unsigned tick);
   void TickTimerA();
   void TickTimerB();
   void UpdateTimerADivisors();
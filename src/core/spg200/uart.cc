@@ -2,6 +2,7 @@
 
 #include "irq.h"
 #include "spg200_io.h"
+#include "core/serializer.h"
 
 Uart::Uart(Irq& irq, Spg200Io& io) : irq_(irq), io_(io) {}
 
@@ -21,6 +22,19 @@ void Uart::Reset() {
   tx_counter_ = 0;
 }
 
+void Uart::Serialize(Serializer& s) {
+  s.Value(control_.raw);
+  s.Value(status_.raw);
+  s.Value(baud_lo_);
+  s.Value(baud_hi_);
+  s.Value(tx_buf_);
+  s.Value(tx_running_);
+  s.Value(rx_buf_);
+  s.Value(rx_running_);
+  s.Value(tx_counter_);
+  s.Value(rx_counter_);
+}
+
 void Uart::RunCycles(int cycles) {
   if (tx_counter_) {
     tx_counter_ -= cycles;
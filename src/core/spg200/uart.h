@@ -5,6 +5,7 @@
 #include <array>
 
 class Irq;
+class Serializer;
 class Spg200Io;
 
 class Uart {
@@ -12,6 +13,7 @@ public:
   Uart(Irq& irq, Spg200Io& io);
 
   void Reset();
+  void Serialize(Serializer& s);
   void RunCycles(int cycles);
 
   Word GetControl();
@@ -1,12 +1,18 @@
 #include "watchdog.h"
 
 #include "cpu.h"
+#include "core/serializer.h"
 
 void Watchdog::Reset() {
   enabled_ = false;
   clock_.Reset();
 }
 
+void Watchdog::Serialize(Serializer& s) {
+  s.Value(enabled_);
+  clock_.Serialize(s);
+}
+
 void Watchdog::RunCycles(int cycles) {
   if (!enabled_)
     return;
@@ -3,6 +3,7 @@
 #include "core/common.h"
 
 class Cpu;
+class Serializer;
 
 class Watchdog {
 public:
@@ -10,6 +11,7 @@ public:
 
   void RunCycles(int cycles);
   void Reset();
+  void Serialize(Serializer& s);
 
   void SetEnabled(bool enabled);
 
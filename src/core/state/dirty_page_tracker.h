@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "xxhash.h"
+
+// Users of dirty page information. Each user has its own flag per page, so that clearing the
+// flags of one user does not hide changes from the others.
+enum class DirtyPageUser : unsigned {
+  STATE_HASH,
+  NVRAM_SAVE,
+};
+
+// Tracks which pages of a memory of Words words have been written since each user last cleared
+// them. Marking a write sets all user flags of the page with a single byte store.
+template <size_t Words, size_t PageWords = 256>
+class DirtyPageTracker {
+public:
+  static_assert(Words % PageWords == 0);
+  static constexpr size_t PageSize = PageWords;
+  static constexpr size_t PageCount = Words / PageWords;
+
+  // All pages start out dirty, as no user has seen the contents yet
+  DirtyPageTracker() { MarkAll(); }
+
+  inline void MarkWrite(size_t addr) { flags_[addr / PageWords] = 0xff; }
+  void MarkAll() { flags_.fill(0xff); }
+
+  bool IsDirty(size_t page, DirtyPageUser user) const {
+    return flags_[page] & UserBit(user);
+  }
+
+  bool IsAnyDirty(DirtyPageUser user) const {
+    for (uint8_t flags : flags_) {
+      if (flags & UserBit(user))
+        return true;
+    }
+    return false;
+  }
+
+  void ClearPage(size_t page, DirtyPageUser user) { flags_[page] &= ~UserBit(user); }
+
+  void Clear(DirtyPageUser user) {
+    for (uint8_t& flags : flags_) {
+      flags &= ~UserBit(user);
+    }
+  }
+
+  // Calls func(page) for every page that is dirty for the user and clears it
+  template <typename Func>
+  void ConsumeDirty(DirtyPageUser user, Func&& func) {
+    for (size_t page = 0; page < PageCount; page++) {
+      if (flags_[page] & UserBit(user)) {
+        flags_[page] &= ~UserBit(user);
+        func(page);
+      }
+    }
+  }
+
+private:
+  static constexpr uint8_t UserBit(DirtyPageUser user) {
+    return 1 << static_cast<unsigned>(user);
+  }
+
+  std::array<uint8_t, PageCount> flags_;
+};
+
+// Hash of a tracked memory that only rehashes pages written since the last update
+template <size_t Words, size_t PageWords = 256>
+class PagedHash {
+public:
+  template <typename Word>
+  uint64_t Update(DirtyPageTracker<Words, PageWords>& tracker, const Word* data) {
+    tracker.ConsumeDirty(DirtyPageUser::STATE_HASH, [&](size_t page) {
+      page_hashes_[page] = Xxh64::Hash(
+          {reinterpret_cast<const uint8_t*>(data + page * PageWords), PageWords * sizeof(Word)});
+    });
+    return Xxh64::Hash(
+        {reinterpret_cast<const uint8_t*>(page_hashes_.data()), sizeof(page_hashes_)});
+  }
+
+private:
+  std::array<uint64_t, Words / PageWords> page_hashes_ = {};
+};
@@ -0,0 +1,150 @@
+#include "lz.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr int kHashBits = 12;
+constexpr size_t kMinMatch = 4;
+constexpr ptrdiff_t kMaxOffset = 0xffff;
+
+inline uint32_t Read32(const uint8_t* p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof value);
+  return value;
+}
+
+inline uint32_t Hash(uint32_t value) {
+  return (value * 2654435761u) >> (32 - kHashBits);
+}
+
+// Lengths that do not fit in a token nibble continue in bytes of up to 255 each
+inline void WriteLength(std::vector<uint8_t>& output, size_t length) {
+  while (length >= 255) {
+    output.push_back(255);
+    length -= 255;
+  }
+  output.push_back(length);
+}
+
+inline bool ReadLength(const uint8_t*& ip, const uint8_t* end, size_t& length) {
+  uint8_t byte;
+  do {
+    if (ip == end)
+      return false;
+    byte = *ip++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+void WriteSequence(std::vector<uint8_t>& output, const uint8_t* literals, size_t literal_length,
+                   size_t offset, size_t match_length) {
+  const size_t match_code = match_length ? match_length - kMinMatch : 0;
+  output.push_back((std::min<size_t>(literal_length, 15) << 4) | std::min<size_t>(match_code, 15));
+  if (literal_length >= 15)
+    WriteLength(output, literal_length - 15);
+  output.insert(output.end(), literals, literals + literal_length);
+
+  if (match_length) {
+    output.push_back(offset & 0xff);
+    output.push_back(offset >> 8);
+    if (match_code >= 15)
+      WriteLength(output, match_code - 15);
+  }
+}
+}  // namespace
+
+void LzCompress(std::span<const uint8_t> input, std::vector<uint8_t>& output) {
+  const uint8_t* const begin = input.data();
+  const uint8_t* const end = begin + input.size();
+  const uint8_t* anchor = begin;
+  const uint8_t* ip = begin;
+
+  uint32_t table[1 << kHashBits] = {};
+
+  while (input.size() >= kMinMatch && ip <= end - kMinMatch) {
+    const uint32_t value = Read32(ip);
+    const uint32_t hash = Hash(value);
+    const uint8_t* ref = begin + table[hash];
+    table[hash] = ip - begin;
+
+    if (ref >= ip || ip - ref > kMaxOffset || Read32(ref) != value) {
+      // Step faster through data that does not compress
+      ip += 1 + ((ip - anchor) >> 6);
+      continue;
+    }
+
+    const uint8_t* match_end = ip + kMinMatch;
+    const uint8_t* ref_end = ref + kMinMatch;
+    while (match_end <= end - 8) {
+      uint64_t a, b;
+      std::memcpy(&a, match_end, 8);
+      std::memcpy(&b, ref_end, 8);
+      if (a != b)
+        break;
+      match_end += 8;
+      ref_end += 8;
+    }
+    while (match_end < end && *match_end == *ref_end) {
+      match_end++;
+      ref_end++;
+    }
+
+    WriteSequence(output, anchor, ip - anchor, ip - ref, match_end - ip);
+    ip = anchor = match_end;
+  }
+
+  WriteSequence(output, anchor, end - anchor, 0, 0);
+}
+
+bool LzDecompress(std::span<const uint8_t> input, std::span<uint8_t> output) {
+  const uint8_t* ip = input.data();
+  const uint8_t* const end = ip + input.size();
+  uint8_t* op = output.data();
+  uint8_t* const op_end = op + output.size();
+
+  while (ip != end) {
+    const uint8_t token = *ip++;
+
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 && !ReadLength(ip, end, literal_length))
+      return false;
+    if (static_cast<size_t>(end - ip) < literal_length ||
+        static_cast<size_t>(op_end - op) < literal_length)
+      return false;
+    std::memcpy(op, ip, literal_length);
+    ip += literal_length;
+    op += literal_length;
+
+    // The final sequence only carries literals
+    if (ip == end)
+      break;
+
+    if (end - ip < 2)
+      return false;
+    const size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+
+    size_t match_length = token & 0xf;
+    if (match_length == 15 && !ReadLength(ip, end, match_length))
+      return false;
+    match_length += kMinMatch;
+
+    if (offset == 0 || static_cast<size_t>(op - output.data()) < offset ||
+        static_cast<size_t>(op_end - op) < match_length)
+      return false;
+
+    // Matches may overlap their own output, in which case the pattern before them repeats.
+    // Copy it in chunks that double in size, so that long runs take few copies.
+    const uint8_t* ref = op - offset;
+    while (match_length) {
+      const size_t chunk = std::min<size_t>(op - ref, match_length);
+      std::memcpy(op, ref, chunk);
+      op += chunk;
+      match_length -= chunk;
+    }
+  }
+
+  return op == op_end;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Byte-oriented LZ77 codec tuned for speed over ratio, in the spirit of LZ4. Long runs of
+// repeated bytes, such as the zeros of an XOR delta between two similar states, are encoded
+// as overlapping matches and cost only a few bytes each.
+
+// Appends the compressed form of input to output
+void LzCompress(std::span<const uint8_t> input, std::vector<uint8_t>& output);
+
+// Decompresses input into output, which must be exactly the size of the original data.
+// Returns false if the input is malformed.
+bool LzDecompress(std::span<const uint8_t> input, std::span<uint8_t> output);
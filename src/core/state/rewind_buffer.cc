@@ -0,0 +1,87 @@
+#include "rewind_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "core/common.h"
+#include "lz.h"
+
+namespace {
+// Word-wise XOR, since byte-wise access through vectors defeats vectorization due to aliasing
+void XorInto(uint8_t* dest, const uint8_t* a, const uint8_t* b, size_t size) {
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t x, y;
+    std::memcpy(&x, a + i, 8);
+    std::memcpy(&y, b + i, 8);
+    x ^= y;
+    std::memcpy(dest + i, &x, 8);
+  }
+  for (; i < size; i++) {
+    dest[i] = a[i] ^ b[i];
+  }
+}
+}  // namespace
+
+RewindBuffer::RewindBuffer(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+void RewindBuffer::Push(std::span<const uint8_t> state) {
+  // States of different sizes belong to different machines and cannot be diffed
+  if (current_.size() != state.size()) {
+    Clear();
+    current_.assign(state.begin(), state.end());
+    return;
+  }
+
+  delta_.resize(state.size());
+  XorInto(delta_.data(), current_.data(), state.data(), state.size());
+
+  compressed_.clear();
+  LzCompress(delta_, compressed_);
+
+  used_bytes_ += compressed_.size();
+  entries_.emplace_back(compressed_.begin(), compressed_.end());
+  std::copy(state.begin(), state.end(), current_.begin());
+
+  Trim();
+}
+
+bool RewindBuffer::Pop() {
+  if (entries_.empty())
+    return false;
+
+  delta_.resize(current_.size());
+  if (!LzDecompress(entries_.back(), delta_))
+    die("Corrupt rewind buffer entry");
+
+  XorInto(current_.data(), current_.data(), delta_.data(), current_.size());
+
+  used_bytes_ -= entries_.back().size();
+  entries_.pop_back();
+  return true;
+}
+
+void RewindBuffer::Clear() {
+  entries_.clear();
+  current_.clear();
+  used_bytes_ = 0;
+}
+
+std::span<const uint8_t> RewindBuffer::GetCurrent() const {
+  return current_;
+}
+
+size_t RewindBuffer::GetFrameCount() const {
+  return entries_.size();
+}
+
+size_t RewindBuffer::GetMemoryUsage() const {
+  return used_bytes_ + current_.capacity() + delta_.capacity() + compressed_.capacity();
+}
+
+void RewindBuffer::Trim() {
+  while (!entries_.empty() && used_bytes_ > max_bytes_) {
+    used_bytes_ -= entries_.front().size();
+    entries_.pop_front();
+  }
+}
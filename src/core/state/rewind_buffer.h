@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <vector>
+
+// Ring of machine states for stepping backwards in time. Only the newest state is kept whole;
+// every older state is stored as the compressed XOR delta against its successor, so unchanged
+// regions cost next to nothing. The oldest deltas are dropped when the memory budget is hit.
+class RewindBuffer {
+public:
+  explicit RewindBuffer(size_t max_bytes);
+
+  // Records a new state following the current one
+  void Push(std::span<const uint8_t> state);
+
+  // Steps back to the state before the current one. Returns false if there is none.
+  bool Pop();
+
+  void Clear();
+
+  std::span<const uint8_t> GetCurrent() const;
+  size_t GetFrameCount() const;
+  size_t GetMemoryUsage() const;
+
+private:
+  void Trim();
+
+  const size_t max_bytes_;
+  size_t used_bytes_ = 0;
+
+  std::vector<uint8_t> current_;
+  std::vector<uint8_t> delta_;
+  std::vector<uint8_t> compressed_;
+  std::deque<std::vector<uint8_t>> entries_;
+};
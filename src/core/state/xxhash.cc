@@ -0,0 +1,125 @@
+#include "xxhash.h"
+
+#include <bit>
+#include <cstring>
+
+namespace {
+constexpr uint64_t kPrime1 = 0x9e3779b185ebca87;
+constexpr uint64_t kPrime2 = 0xc2b2ae3d27d4eb4f;
+constexpr uint64_t kPrime3 = 0x165667b19e3779f9;
+constexpr uint64_t kPrime4 = 0x85ebca77c2b2ae63;
+constexpr uint64_t kPrime5 = 0x27d4eb2f165667c5;
+
+inline uint64_t Read64(const uint8_t* p) {
+  uint64_t value;
+  std::memcpy(&value, p, sizeof value);
+  return std::endian::native == std::endian::little ? value : __builtin_bswap64(value);
+}
+
+inline uint32_t Read32(const uint8_t* p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof value);
+  return std::endian::native == std::endian::little ? value : __builtin_bswap32(value);
+}
+
+inline uint64_t Round(uint64_t acc, uint64_t input) {
+  return std::rotl(acc + input * kPrime2, 31) * kPrime1;
+}
+
+inline uint64_t MergeRound(uint64_t acc, uint64_t lane) {
+  return (acc ^ Round(0, lane)) * kPrime1 + kPrime4;
+}
+
+// The four lanes are independent, which lets the CPU overlap their multiplications
+inline void ProcessStripes(uint64_t lanes[4], const uint8_t* p, size_t stripes) {
+  uint64_t l0 = lanes[0], l1 = lanes[1], l2 = lanes[2], l3 = lanes[3];
+  for (size_t i = 0; i < stripes; i++, p += 32) {
+    l0 = Round(l0, Read64(p));
+    l1 = Round(l1, Read64(p + 8));
+    l2 = Round(l2, Read64(p + 16));
+    l3 = Round(l3, Read64(p + 24));
+  }
+  lanes[0] = l0;
+  lanes[1] = l1;
+  lanes[2] = l2;
+  lanes[3] = l3;
+}
+}  // namespace
+
+Xxh64::Xxh64(uint64_t seed) : seed_(seed) {
+  lanes_[0] = seed + kPrime1 + kPrime2;
+  lanes_[1] = seed + kPrime2;
+  lanes_[2] = seed;
+  lanes_[3] = seed - kPrime1;
+}
+
+void Xxh64::Update(const void* data, size_t size) {
+  auto p = static_cast<const uint8_t*>(data);
+  total_size_ += size;
+
+  if (buffer_size_ + size < 32) {
+    std::memcpy(buffer_ + buffer_size_, p, size);
+    buffer_size_ += size;
+    return;
+  }
+
+  if (buffer_size_) {
+    const size_t fill = 32 - buffer_size_;
+    std::memcpy(buffer_ + buffer_size_, p, fill);
+    ProcessStripes(lanes_, buffer_, 1);
+    p += fill;
+    size -= fill;
+    buffer_size_ = 0;
+  }
+
+  const size_t stripes = size / 32;
+  ProcessStripes(lanes_, p, stripes);
+  p += stripes * 32;
+  size -= stripes * 32;
+
+  std::memcpy(buffer_, p, size);
+  buffer_size_ = size;
+}
+
+uint64_t Xxh64::Digest() const {
+  uint64_t hash;
+  if (total_size_ >= 32) {
+    hash = std::rotl(lanes_[0], 1) + std::rotl(lanes_[1], 7) + std::rotl(lanes_[2], 12) +
+           std::rotl(lanes_[3], 18);
+    for (uint64_t lane : lanes_) {
+      hash = MergeRound(hash, lane);
+    }
+  } else {
+    hash = seed_ + kPrime5;
+  }
+  hash += total_size_;
+
+  const uint8_t* p = buffer_;
+  const uint8_t* const end = buffer_ + buffer_size_;
+  for (; p + 8 <= end; p += 8) {
+    hash ^= Round(0, Read64(p));
+    hash = std::rotl(hash, 27) * kPrime1 + kPrime4;
+  }
+  if (p + 4 <= end) {
+    hash ^= Read32(p) * kPrime1;
+    hash = std::rotl(hash, 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p < end; p++) {
+    hash ^= *p * kPrime5;
+    hash = std::rotl(hash, 11) * kPrime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+uint64_t Xxh64::Hash(std::span<const uint8_t> data, uint64_t seed) {
+  Xxh64 hasher(seed);
+  hasher.Update(data.data(), data.size());
+  return hasher.Digest();
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Streaming implementation of the XXH64 hash function. Output matches the reference
+// implementation for the same input and seed, regardless of how the input is split into updates.
+class Xxh64 {
+public:
+  explicit Xxh64(uint64_t seed = 0);
+
+  void Update(const void* data, size_t size);
+  uint64_t Digest() const;
+
+  static uint64_t Hash(std::span<const uint8_t> data, uint64_t seed = 0);
+
+private:
+  uint64_t lanes_[4];
+  uint64_t seed_;
+  uint64_t total_size_ = 0;
+  uint8_t buffer_[32];
+  size_t buffer_size_ = 0;
+};
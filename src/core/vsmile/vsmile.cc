@@ -1,5 +1,10 @@
 #include "vsmile.h"
 
+#include <cstring>
+
+#include "core/serializer.h"
+#include "core/state/xxhash.h"
+
 /* V.Smile system ROM region codes:
  * 0x0/0x1: no V.Smile screen (1.02+)
  * 0x2: Italian (1.03), UK English without subtitle (1.02)
@@ -24,24 +29,69 @@
  * With a cartridge it will display the US English intro.
  */
 
-VSmile::VSmile(std::unique_ptr<SysRomType> sys_rom, std::unique_ptr<CartRomType> cart_rom,
-               CartType cart_type, std::unique_ptr<ArtNvramType> initial_art_nvram,
-               unsigned region_code, bool vtech_logo, VideoTiming video_timing)
+static const uint32_t kStateMagic = 0x53535356;  // "VSSS"
+static const uint32_t kStateVersion = 3;
+
+struct StateHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;
+  uint8_t video_timing;
+  uint8_t cart_type;
+  uint16_t reserved;
+};
+
+VSmile::VSmile(std::shared_ptr<const SysRomType> sys_rom,
+               std::shared_ptr<const CartRomType> cart_rom, CartType cart_type,
+               std::unique_ptr<ArtNvramType> initial_art_nvram, unsigned region_code,
+               bool vtech_logo, VideoTiming video_timing)
     : io_(std::move(sys_rom), std::move(cart_rom), cart_type, std::move(initial_art_nvram),
           region_code, vtech_logo, *this),
       spg200_(video_timing, io_),
-      joy_send_(*this, 0) {}
+      joy_send_{{*this, 0}, {*this, 1}} {}
+
+std::unique_ptr<VSmile> VSmile::Clone() {
+  // NVRAM contents are part of the save state, so the clone only needs storage for it
+  std::unique_ptr<ArtNvramType> art_nvram;
+  if (io_.cart_type_ == CartType::ART_STUDIO)
+    art_nvram = std::make_unique<ArtNvramType>();
+
+  auto clone = std::make_unique<VSmile>(io_.sys_rom_, io_.cart_rom_, io_.cart_type_,
+                                        std::move(art_nvram), io_.region_code_, io_.vtech_logo_,
+                                        spg200_.GetVideoTiming());
+
+  // Reuse the state buffer between clones, since a fresh allocation of this size is returned to
+  // the OS on every free and faulted back in on every use
+  thread_local std::vector<uint8_t> state;
+  SaveState(state);
+  if (!clone->LoadState(state))
+    die("Failed to load state into clone");
+
+  clone->SetAudioEnabled(audio_enabled_);
+  clone->SetDeterministicRandom(deterministic_random_);
+  clone->SetPpuViewSettings(ppu_view_settings_);
+  clone->sys_rom_used_ = sys_rom_used_;
+  clone->intro_finished_ = intro_finished_;
+  return clone;
+}
 
 void VSmile::RunFrame() {
   spg200_.RunFrame();
+  UpdateIntroStatus();
 }
 
-void VSmile::Step() {
-  spg200_.Step();
+bool VSmile::Step() {
+  if (!spg200_.Step())
+    return false;
+  UpdateIntroStatus();
+  return true;
 }
 
 void VSmile::Reset() {
   spg200_.Reset();
+  io_.sys_rom_reads_ = 0;
+  sys_rom_used_ = false;
+  intro_finished_ = false;
 
   spg200_.SetExt1Irq(true);
   spg200_.SetExt2Irq(true);
@@ -49,13 +99,125 @@ void VSmile::Reset() {
   io_.rts_[0] = io_.rts_[1] = true;
   io_.cts_[0] = io_.cts_[1] = false;
 
-  io_.joy_.Reset();
+  io_.joy_[0].Reset();
+  io_.joy_[1].Reset();
 
   io_.on_button_pressed_ = false;
   io_.off_button_pressed_ = false;
   io_.restart_button_pressed_ = false;
 }
 
+void VSmile::SaveState(std::vector<uint8_t>& out) {
+  out.clear();
+  out.resize(sizeof(StateHeader));
+
+  Serializer s(out);
+  Serialize(s);
+
+  StateHeader header = {};
+  header.magic = kStateMagic;
+  header.version = kStateVersion;
+  header.size = out.size();
+  header.video_timing = static_cast<uint8_t>(spg200_.GetVideoTiming());
+  header.cart_type = static_cast<uint8_t>(io_.cart_type_);
+  std::memcpy(out.data(), &header, sizeof(header));
+}
+
+bool VSmile::LoadState(std::span<const uint8_t> data) {
+  StateHeader header;
+  if (data.size() < sizeof(header))
+    return false;
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  // The state layout is fixed for a given version and cartridge type, so checking the header
+  // and size up front ensures that loading cannot fail halfway through
+  if (header.magic != kStateMagic || header.version != kStateVersion ||
+      header.size != data.size() ||
+      header.video_timing != static_cast<uint8_t>(spg200_.GetVideoTiming()) ||
+      header.cart_type != static_cast<uint8_t>(io_.cart_type_))
+    return false;
+
+  Serializer s(data.subspan(sizeof(header)));
+  Serialize(s);
+  return !s.HasError();
+}
+
+VSmile::StateHashes VSmile::GetStateHashes() {
+  StateHashes hashes = spg200_.HashState();
+
+  // Controller and cartridge state is folded into the I/O hash
+  Xxh64 hasher(hashes.io);
+  Serializer s(hasher);
+  SerializeIo(s);
+  if (io_.cart_type_ == CartType::ART_STUDIO) {
+    const uint64_t nvram_hash =
+        io_.art_nvram_hash_.Update(io_.art_nvram_dirty_pages_, io_.art_nvram_->data());
+    hasher.Update(&nvram_hash, sizeof nvram_hash);
+  }
+  hashes.io = hasher.Digest();
+  return hashes;
+}
+
+uint64_t VSmile::GetStateHash() {
+  return GetStateHashes().GetCombined();
+}
+
+uint64_t VSmile::GetConfigHash() const {
+  Xxh64 hasher;
+  hasher.Update(io_.sys_rom_->data(), sizeof(SysRomType));
+  hasher.Update(io_.cart_rom_->data(), sizeof(CartRomType));
+  const uint8_t settings[] = {static_cast<uint8_t>(io_.cart_type_),
+                              static_cast<uint8_t>(io_.region_code_), io_.vtech_logo_,
+                              static_cast<uint8_t>(spg200_.GetVideoTiming())};
+  hasher.Update(settings, sizeof settings);
+  return hasher.Digest();
+}
+
+bool VSmile::HasFinishedIntro() const {
+  return intro_finished_;
+}
+
+VSmile::IntroStatus VSmile::GetIntroStatus() const {
+  return {io_.sys_rom_reads_, sys_rom_used_, intro_finished_};
+}
+
+void VSmile::SetIntroStatus(const IntroStatus& status) {
+  io_.sys_rom_reads_ = status.sys_rom_reads;
+  sys_rom_used_ = status.sys_rom_used;
+  intro_finished_ = status.intro_finished;
+}
+
+void VSmile::UpdateIntroStatus() {
+  if (io_.sys_rom_reads_ > 0) {
+    sys_rom_used_ = true;
+    io_.sys_rom_reads_ = 0;
+  } else if (sys_rom_used_) {
+    intro_finished_ = true;
+  }
+}
+
+void VSmile::Serialize(Serializer& s) {
+  spg200_.Serialize(s);
+  SerializeIo(s);
+
+  if (io_.cart_type_ == CartType::ART_STUDIO) {
+    s.Value(*io_.art_nvram_);
+    if (s.IsLoading())
+      io_.art_nvram_dirty_pages_.MarkAll();
+  }
+}
+
+void VSmile::SerializeIo(Serializer& s) {
+  s.Value(io_.rts_);
+  s.Value(io_.cts_);
+  s.Value(io_.on_button_pressed_);
+  s.Value(io_.off_button_pressed_);
+  s.Value(io_.restart_button_pressed_);
+  s.Value(io_.joy_connected_);
+  io_.joy_[0].Serialize(s);
+  io_.joy_[1].Serialize(s);
+}
+
 std::span<uint8_t> VSmile::GetPicture() const {
   return spg200_.GetPicture();
 }
@@ -64,10 +226,56 @@ std::span<uint16_t> VSmile::GetAudio() {
   return spg200_.GetAudio();
 }
 
+void VSmile::SetAudioEnabled(bool enabled) {
+  audio_enabled_ = enabled;
+  spg200_.SetAudioEnabled(enabled);
+}
+
+void VSmile::SetDeterministicRandom(bool deterministic) {
+  deterministic_random_ = deterministic;
+  spg200_.SetDeterministicRandom(deterministic);
+}
+
+void VSmile::SetProfilingEnabled(bool enabled) {
+  spg200_.SetProfilingEnabled(enabled);
+}
+
+const VSmile::ComponentTimes& VSmile::GetComponentTimes() const {
+  return spg200_.GetComponentTimes();
+}
+
+void VSmile::ResetComponentTimes() {
+  spg200_.ResetComponentTimes();
+}
+
+void VSmile::SetInstructionProfiler(InstructionProfiler* profiler) {
+  spg200_.SetInstructionProfiler(profiler);
+}
+
+void VSmile::SetCallGraphProfiler(CallGraphProfiler* profiler) {
+  spg200_.SetCallGraphProfiler(profiler);
+}
+
+void VSmile::SetMemoryAccessStats(MemoryAccessStats* stats) {
+  spg200_.SetMemoryAccessStats(stats);
+}
+
+MemoryAccessStats* VSmile::GetMemoryAccessStats() {
+  return spg200_.GetMemoryAccessStats();
+}
+
 const VSmile::ArtNvramType* VSmile::GetArtNvram() {
   return io_.art_nvram_.get();
 }
 
+Spg200::RamDirtyPages& VSmile::GetRamDirtyPages() {
+  return spg200_.GetRamDirtyPages();
+}
+
+VSmile::ArtNvramDirtyPages& VSmile::GetArtNvramDirtyPages() {
+  return io_.art_nvram_dirty_pages_;
+}
+
 Word VSmile::ReadFromMemory(Addr addr) {
   return spg200_.PeekWord(addr);
 }
@@ -77,15 +285,27 @@ void VSmile::WriteToMemory(Addr addr, Word value) {
 }
 
 void VSmile::SetPpuViewSettings(PpuViewSettings& ppu_view_settings) {
+  ppu_view_settings_ = ppu_view_settings;
   spg200_.SetPpuViewSettings(ppu_view_settings);
 }
 
-VSmile::JoyLedStatus VSmile::GetControllerLed() {
-  return io_.joy_.GetLeds();
+void VSmile::SetControllerConnected(int port, bool connected) {
+  if (io_.joy_connected_[port] == connected)
+    return;
+
+  // A controller starts up from scratch when plugged in, and leaves the RTS line idle when
+  // unplugged
+  io_.joy_connected_[port] = connected;
+  io_.joy_[port].Reset();
+  io_.rts_[port] = true;
+}
+
+VSmile::JoyLedStatus VSmile::GetControllerLed(int port) {
+  return io_.joy_[port].GetLeds();
 }
 
-void VSmile::UpdateJoystick(const JoyInput& joy_input) {
-  io_.joy_.UpdateJoystick(joy_input);
+void VSmile::UpdateJoystick(const JoyInput& joy_input, int port) {
+  io_.joy_[port].UpdateJoystick(joy_input);
 }
 
 void VSmile::UpdateOnButton(bool pressed) {
@@ -100,25 +320,30 @@ void VSmile::UpdateRestartButton(bool pressed) {
   io_.restart_button_pressed_ = pressed;
 }
 
-VSmile::Io::Io(std::unique_ptr<SysRomType> sys_rom, std::unique_ptr<CartRomType> cart_rom,
-               CartType cart_type, std::unique_ptr<ArtNvramType> initial_art_nvram,
-               unsigned region_code, bool vtech_logo, VSmile& vsmile)
+VSmile::Io::Io(std::shared_ptr<const SysRomType> sys_rom,
+               std::shared_ptr<const CartRomType> cart_rom, CartType cart_type,
+               std::unique_ptr<ArtNvramType> initial_art_nvram, unsigned region_code,
+               bool vtech_logo, VSmile& vsmile)
     : region_code_(region_code & 0xf),
       vtech_logo_(vtech_logo),
       sys_rom_(std::move(sys_rom)),
       cart_rom_(std::move(cart_rom)),
       cart_type_(cart_type),
-      joy_(vsmile.joy_send_) {
+      joy_{VSmileJoy(vsmile.joy_send_[0]), VSmileJoy(vsmile.joy_send_[1])} {
   if (cart_type_ == CartType::ART_STUDIO) {
     if (!initial_art_nvram) {
       die("Art Studio NVRAM enabled but no initial value sent");
     }
     art_nvram_ = std::move(initial_art_nvram);
   }
+  art_nvram_dirty_pages_.Clear(DirtyPageUser::NVRAM_SAVE);
 }
 
 void VSmile::Io::RunCycles(int cycles) {
-  joy_.RunCycles(cycles);
+  if (joy_connected_[0])
+    joy_[0].RunCycles(cycles);
+  if (joy_connected_[1])
+    joy_[1].RunCycles(cycles);
 }
 
 unsigned VSmile::Io::GetAdc0() {
@@ -158,10 +383,13 @@ void VSmile::Io::SetPortB(Word value, Word mask) {}
 void VSmile::Io::SetPortC(Word value, Word mask) {
   if (mask & 0x0100) {
     cts_[0] = (value & 0x0100);
-    joy_.SetCts(cts_[0]);
+    if (joy_connected_[0])
+      joy_[0].SetCts(cts_[0]);
   }
   if (mask & 0x0200) {
     cts_[1] = (value & 0x0200);
+    if (joy_connected_[1])
+      joy_[1].SetCts(cts_[1]);
   }
 }
 
@@ -192,22 +420,28 @@ Word VSmile::Io::ReadCsb2(Addr addr) {
 void VSmile::Io::WriteCsb2(Addr addr, Word value) {
   if (cart_type_ == CartType::ART_STUDIO) {
     (*art_nvram_)[addr & 0x1ffff] = value;
+    art_nvram_dirty_pages_.MarkWrite(addr & 0x1ffff);
   }
 }
 
 Word VSmile::Io::ReadCsb3(Addr addr) {
+  sys_rom_reads_++;
   return (*sys_rom_)[addr];
 }
 
 void VSmile::Io::WriteCsb3(Addr addr, Word value) {}
 
 void VSmile::Io::TxUart(uint8_t value) {
-  if (cts_[0])
-    joy_.Rx(value);
+  for (int port = 0; port < 2; port++) {
+    if (cts_[port] && joy_connected_[port])
+      joy_[port].Rx(value);
+  }
 }
 
 void VSmile::Io::RxUartDone() {
-  joy_.TxDone();
+  // Only a controller that is currently sending acts on this
+  joy_[0].TxDone();
+  joy_[1].TxDone();
 }
 
 VSmile::JoySend::JoySend(VSmile& vsmile, const int num) : vsmile_(vsmile), num_(num) {}
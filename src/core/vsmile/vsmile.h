@@ -2,6 +2,9 @@
 
 #include "core/common.h"
 
+#include <span>
+#include <vector>
+
 #include "core/spg200/settings.h"
 #include "core/spg200/spg200.h"
 #include "core/spg200/spg200_io.h"
@@ -10,12 +13,14 @@
 #include "vsmile_joy.h"
 
 class IoIrq;
+class Serializer;
 
 class VSmile {
 public:
   using CartRomType = std::array<Word, 4 * 1024 * 1024>;
   using SysRomType = std::array<Word, 1024 * 1024>;
   using ArtNvramType = std::array<Word, 128 * 1024>;
+  using ArtNvramDirtyPages = DirtyPageTracker<128 * 1024>;
 
   enum class CartType {
     STANDARD,
@@ -24,35 +29,94 @@ public:
 
   using JoyInput = VSmileJoy::JoyInput;
   using JoyLedStatus = VSmileJoy::JoyLedStatus;
+  using StateHashes = Spg200::StateHashes;
+  using ComponentTimes = Spg200::ComponentTimes;
 
-  VSmile(std::unique_ptr<SysRomType> sys_rom, std::unique_ptr<CartRomType> cart_rom,
+  // ROM images are never written to, so they may be shared between machines
+  VSmile(std::shared_ptr<const SysRomType> sys_rom, std::shared_ptr<const CartRomType> cart_rom,
          CartType cart_type, std::unique_ptr<ArtNvramType> initial_art_nvram, unsigned region_code,
          bool vtech_logo, VideoTiming video_timing);
 
+  // Creates an independent machine in the same state that shares ROM images with this one.
+  // Clones share no mutable state, so they can be run on different threads.
+  std::unique_ptr<VSmile> Clone();
+
   void RunFrame();
-  void Step();
+  // Runs a single instruction and returns whether it completed a frame
+  bool Step();
   void Reset();
 
+  // Save states contain all machine state except ROM contents and buffered audio. They can
+  // only be loaded into a machine with the same video timing and cartridge type.
+  void SaveState(std::vector<uint8_t>& out);
+  bool LoadState(std::span<const uint8_t> data);
+
+  // Hashes cover the same state as save states, without the cost of storing it
+  StateHashes GetStateHashes();
+  uint64_t GetStateHash();
+
+  // Hash of the ROM images and the settings that affect booting, identifying machines that
+  // go through the same system ROM intro
+  uint64_t GetConfigHash() const;
+  // Whether the cartridge code has taken over after the system ROM intro since the last reset.
+  // This is detected as the first frame without system ROM accesses after one with them.
+  bool HasFinishedIntro() const;
+
+  // Intro progress is not part of save states, so frames that are run and then undone by
+  // loading a state, like run-ahead frames, restore it from before them
+  struct IntroStatus {
+    uint32_t sys_rom_reads = 0;
+    bool sys_rom_used = false;
+    bool intro_finished = false;
+  };
+  IntroStatus GetIntroStatus() const;
+  void SetIntroStatus(const IntroStatus& status);
+
   std::span<uint8_t> GetPicture() const;
   std::span<uint16_t> GetAudio();
+  void SetAudioEnabled(bool enabled);
+  // Use the hardware LFSR instead of host randomness, required for reproducible runs
+  void SetDeterministicRandom(bool deterministic);
+  // Collects the host time spent in each component, slowing down emulation
+  void SetProfilingEnabled(bool enabled);
+  const ComponentTimes& GetComponentTimes() const;
+  void ResetComponentTimes();
+  // Counts instructions and cycles per address in the profiler, until set to null
+  void SetInstructionProfiler(InstructionProfiler* profiler);
+  // Attributes cycles to emulated functions in the profiler, until set to null
+  void SetCallGraphProfiler(CallGraphProfiler* profiler);
+  // Counts bus accesses per register and region in the collector, until set to null
+  void SetMemoryAccessStats(MemoryAccessStats* stats);
+  MemoryAccessStats* GetMemoryAccessStats();
   const ArtNvramType* GetArtNvram();
 
+  // Pages written since last cleared by each user. NVRAM pages start out clean for the
+  // NVRAM_SAVE user, as the initial contents are already saved.
+  Spg200::RamDirtyPages& GetRamDirtyPages();
+  ArtNvramDirtyPages& GetArtNvramDirtyPages();
+
   Word ReadFromMemory(Addr addr);
   void WriteToMemory(Addr addr, Word value);
 
   void SetPpuViewSettings(PpuViewSettings& ppu_view_settings);
 
-  void UpdateJoystick(const JoyInput& joy_input);
-  JoyLedStatus GetControllerLed();
+  // Controller port 0 is connected by default, port 1 is used by a second player
+  void SetControllerConnected(int port, bool connected);
+  void UpdateJoystick(const JoyInput& joy_input, int port = 0);
+  JoyLedStatus GetControllerLed(int port = 0);
 
   void UpdateOnButton(bool pressed);
   void UpdateOffButton(bool pressed);
   void UpdateRestartButton(bool pressed);
 
 private:
+  void Serialize(Serializer& s);
+  void SerializeIo(Serializer& s);
+  void UpdateIntroStatus();
+
   class Io : public Spg200Io {
   public:
-    Io(std::unique_ptr<SysRomType> sys_rom, std::unique_ptr<CartRomType> cart_rom,
+    Io(std::shared_ptr<const SysRomType> sys_rom, std::shared_ptr<const CartRomType> cart_rom,
        CartType cart_type, std::unique_ptr<ArtNvramType> initial_art_nvram, unsigned region_code,
        bool vtech_logo, VSmile& vsmile);
 
@@ -86,11 +150,14 @@ private:
     const unsigned region_code_;
     const bool vtech_logo_;
 
-    std::unique_ptr<SysRomType> sys_rom_;
-    std::unique_ptr<CartRomType> cart_rom_;
+    std::shared_ptr<const SysRomType> sys_rom_;
+    std::shared_ptr<const CartRomType> cart_rom_;
     CartType cart_type_ = CartType::STANDARD;
     std::unique_ptr<ArtNvramType> art_nvram_;
-    VSmileJoy joy_;
+    ArtNvramDirtyPages art_nvram_dirty_pages_;
+    PagedHash<128 * 1024> art_nvram_hash_;
+    VSmileJoy joy_[2];
+    bool joy_connected_[2] = {true, false};
 
     bool rts_[2] = {true};
     bool cts_[2] = {false};
@@ -98,6 +165,8 @@ private:
     bool on_button_pressed_ = false;
     bool off_button_pressed_ = false;
     bool restart_button_pressed_ = false;
+
+    uint32_t sys_rom_reads_ = 0;
   } io_;
 
   class JoySend : public VSmileJoySend {
@@ -113,5 +182,14 @@ private:
   };
 
   Spg200 spg200_;
-  JoySend joy_send_;
+  JoySend joy_send_[2];
+
+  // Host-side settings that are not part of the machine state, kept for cloning
+  bool audio_enabled_ = true;
+  bool deterministic_random_ = false;
+  PpuViewSettings ppu_view_settings_ = {};
+
+  // Boot progress tracked from system ROM accesses, also not part of the machine state
+  bool sys_rom_used_ = false;
+  bool intro_finished_ = false;
 };
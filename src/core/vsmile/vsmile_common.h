@@ -1,9 +1,18 @@
 #pragma once
 
+#include "core/spg200/types.h"
+
+inline double GetEmulatedFrameRate(VideoTiming video_timing) {
+  // 27 MHz clock divided by clocks per scanline and scanlines per frame
+  if (video_timing == VideoTiming::NTSC)
+    return 27000000.0 / (1716 * 262);
+  return 27000000.0 / (1728 * 312);
+}
+
 class VSmileJoySend {
 public:
   virtual ~VSmileJoySend() {};
 
   virtual void SetRts(bool value) = 0;
   virtual void Tx(uint8_t byte) = 0;
-};
\ No newline at end of file
+};
@@ -0,0 +1,131 @@
+#include "vsmile_frame_timings.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+
+#include "core/host_clock.h"
+
+namespace {
+constexpr const char* kPhaseNames[] = {
+    "CPU",          "PPU", "SPU",     "Timers & IO", "Rewind", "Run-ahead", "Netplay",
+    "Video upload", "GUI", "Present", "Audio sync",  "Other",  "Frame"};
+constexpr const char* kJsonNames[] = {
+    "cpu",          "ppu", "spu",     "timers_io",  "rewind", "run_ahead", "netplay",
+    "video_upload", "gui", "present", "audio_sync", "other",  "frame"};
+}  // namespace
+
+VSmileFrameTimings::VSmileFrameTimings(size_t window_frames)
+    : window_frames_(window_frames), last_lap_(HostClock::Now()) {}
+
+const char* VSmileFrameTimings::GetPhaseName(int phase) {
+  return kPhaseNames[phase];
+}
+
+void VSmileFrameTimings::Lap(Phase phase) {
+  const uint64_t now = HostClock::Now();
+  current_[phase] += now - last_lap_;
+  last_lap_ = now;
+}
+
+void VSmileFrameTimings::StartEmulation(VSmile& vsmile) {
+  Lap(PHASE_OTHER);
+  profiling_frame_ = emulation_count_++ % kProfileInterval == 0;
+  if (profiling_frame_) {
+    vsmile.ResetComponentTimes();
+    vsmile.SetProfilingEnabled(true);
+  }
+}
+
+void VSmileFrameTimings::EndEmulation(VSmile& vsmile) {
+  const uint64_t now = HostClock::Now();
+  const uint64_t elapsed = now - last_lap_;
+  last_lap_ = now;
+
+  if (profiling_frame_) {
+    vsmile.SetProfilingEnabled(false);
+    profiling_frame_ = false;
+
+    // Keeps the last split when no instruction was run
+    const auto& times = vsmile.GetComponentTimes();
+    if (times.instructions > 0) {
+      const auto shares = times.GetShares();
+      component_shares_ = {shares[0], shares[1], shares[2], shares[3] + shares[4]};
+    }
+  }
+
+  uint64_t remaining = elapsed;
+  for (int i = PHASE_CPU; i < PHASE_TIMERS_IO; i++) {
+    const uint64_t ticks = std::min<uint64_t>(remaining, elapsed * component_shares_[i]);
+    current_[i] += ticks;
+    remaining -= ticks;
+  }
+  current_[PHASE_TIMERS_IO] += remaining;
+}
+
+void VSmileFrameTimings::EndFrame() {
+  Lap(PHASE_OTHER);
+  current_[PHASE_COUNT] = 0;
+  for (int phase = 0; phase < PHASE_COUNT; phase++) {
+    current_[PHASE_COUNT] += current_[phase];
+  }
+  for (int phase = 0; phase <= PHASE_COUNT; phase++) {
+    totals_[phase] += current_[phase];
+  }
+
+  if (window_frames_ == 0 || frames_.size() < window_frames_) {
+    frames_.push_back(current_);
+  } else {
+    frames_[next_frame_] = current_;
+    next_frame_ = (next_frame_ + 1) % window_frames_;
+  }
+  frame_count_++;
+  current_ = {};
+}
+
+uint64_t VSmileFrameTimings::GetFrameCount() const {
+  return frame_count_;
+}
+
+size_t VSmileFrameTimings::GetWindowFrames() const {
+  return frames_.size();
+}
+
+double VSmileFrameTimings::GetMs(size_t frame, int phase) const {
+  const size_t index = (next_frame_ + frame) % frames_.size();
+  return frames_[index][phase] * 1000.0 / HostClock::GetTicksPerSecond();
+}
+
+double VSmileFrameTimings::GetPercentileMs(int phase, double percentile) const {
+  if (frames_.empty())
+    return 0;
+
+  std::vector<uint64_t> values;
+  values.reserve(frames_.size());
+  for (const auto& frame : frames_) {
+    values.push_back(frame[phase]);
+  }
+  // Nearest rank, so that p99 over a few hundred frames is one of the slowest ones
+  const size_t rank = std::ceil(percentile / 100 * values.size());
+  const auto nth = values.begin() + std::clamp<size_t>(rank, 1, values.size()) - 1;
+  std::nth_element(values.begin(), nth, values.end());
+  return *nth * 1000.0 / HostClock::GetTicksPerSecond();
+}
+
+void VSmileFrameTimings::WriteJson(std::FILE* out) const {
+  const double ms_per_tick = 1000.0 / HostClock::GetTicksPerSecond();
+  std::fprintf(out, "{\n  \"frames\": %" PRIu64 ",\n  \"phases\": [", frame_count_);
+  bool first = true;
+  for (int phase = 0; phase <= PHASE_COUNT; phase++) {
+    if (totals_[phase] == 0)
+      continue;
+    std::fprintf(out,
+                 "%s\n    {\"name\": \"%s\", \"total_ms\": %.3f, \"mean_ms\": %.4f, "
+                 "\"p50_ms\": %.4f, \"p99_ms\": %.4f}",
+                 first ? "" : ",", kJsonNames[phase], totals_[phase] * ms_per_tick,
+                 totals_[phase] * ms_per_tick / std::max<uint64_t>(frame_count_, 1),
+                 GetPercentileMs(phase, 50), GetPercentileMs(phase, 99));
+    first = false;
+  }
+  std::fprintf(out, "\n  ]\n}\n");
+}
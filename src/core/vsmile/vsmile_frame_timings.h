@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "vsmile.h"
+
+// Host time spent in each phase of a frame, kept for a window of recent frames to give the last
+// frames and percentiles over the window. Phases are timed as laps between consecutive points of
+// the frame loop. Running a frame is split between components in the proportions measured by
+// profiling one in every kProfileInterval frames run, as profiling every frame would slow it
+// down. Rewind, run-ahead and netplay run or restore frames of their own, so they are timed as
+// phases of their own rather than split.
+class VSmileFrameTimings {
+public:
+  enum Phase {
+    PHASE_CPU,
+    PHASE_PPU,
+    PHASE_SPU,
+    PHASE_TIMERS_IO,
+    PHASE_REWIND,
+    PHASE_RUN_AHEAD,
+    PHASE_NETPLAY,
+    PHASE_VIDEO_UPLOAD,
+    PHASE_GUI,
+    PHASE_PRESENT,
+    PHASE_AUDIO_SYNC,
+    PHASE_OTHER,
+    PHASE_COUNT
+  };
+
+  static constexpr uint64_t kProfileInterval = 128;
+
+  // Keeps all frames when the window is zero
+  explicit VSmileFrameTimings(size_t window_frames = 240);
+
+  static const char* GetPhaseName(int phase);
+
+  // Adds the time since the last lap to the phase
+  void Lap(Phase phase);
+  // Lap before running a frame, which enables profiling for frames sampled for the split
+  void StartEmulation(VSmile& vsmile);
+  // Splits the time since the last lap between the components, without the clock reads that
+  // profiling added
+  void EndEmulation(VSmile& vsmile);
+  void EndFrame();
+
+  uint64_t GetFrameCount() const;
+  // Frames kept in the window, the last one being the last ended frame
+  size_t GetWindowFrames() const;
+  // Milliseconds in the phase for a frame of the window, or the whole frame for PHASE_COUNT
+  double GetMs(size_t frame, int phase) const;
+  double GetPercentileMs(int phase, double percentile) const;
+
+  // Writes the total, mean and percentiles of each phase that took any time as JSON
+  void WriteJson(std::FILE* out) const;
+
+private:
+  using Ticks = std::array<uint64_t, PHASE_COUNT + 1>;
+
+  const size_t window_frames_;
+  std::vector<Ticks> frames_;
+  size_t next_frame_ = 0;
+  uint64_t frame_count_ = 0;
+  uint64_t emulation_count_ = 0;
+  Ticks current_ = {};
+  Ticks totals_ = {};
+  uint64_t last_lap_;
+
+  bool profiling_frame_ = false;
+  // Share of emulation time of the CPU, PPU, SPU, and timers and IO
+  std::array<double, 4> component_shares_ = {0, 0, 0, 1};
+};
@@ -0,0 +1,37 @@
+#include "vsmile_hash_log.h"
+
+#include <cinttypes>
+
+VSmileHashLog::VSmileHashLog(std::FILE* out, uint64_t step_interval)
+    : out_(out), step_interval_(step_interval) {}
+
+void VSmileHashLog::RunFrame(VSmile& vsmile) {
+  if (!step_interval_) {
+    vsmile.RunFrame();
+    Write(vsmile, true);
+    frame_++;
+    return;
+  }
+
+  bool frame_end;
+  do {
+    frame_end = vsmile.Step();
+    steps_++;
+    if (frame_end || steps_ % step_interval_ == 0)
+      Write(vsmile, frame_end);
+  } while (!frame_end);
+  frame_++;
+}
+
+void VSmileHashLog::Write(VSmile& vsmile, bool frame_end) {
+  const VSmile::StateHashes hashes = vsmile.GetStateHashes();
+  if (step_interval_)
+    std::fprintf(out_, "frame %" PRIu64 " step %" PRIu64 "%s ", frame_, steps_,
+                 frame_end ? " end" : "");
+  else
+    std::fprintf(out_, "frame %" PRIu64 " ", frame_);
+  std::fprintf(out_,
+               "%016" PRIx64 " cpu=%016" PRIx64 " ram=%016" PRIx64 " ppu=%016" PRIx64
+               " spu=%016" PRIx64 " io=%016" PRIx64 "\n",
+               hashes.GetCombined(), hashes.cpu, hashes.ram, hashes.ppu, hashes.spu, hashes.io);
+}
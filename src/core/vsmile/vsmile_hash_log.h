@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+#include "vsmile.h"
+
+// Writes machine state hashes to a text log, for finding the point where two runs diverge.
+// Hashes are logged at the end of every frame, and additionally every step_interval
+// instructions when the interval is non-zero.
+class VSmileHashLog {
+public:
+  VSmileHashLog(std::FILE* out, uint64_t step_interval = 0);
+
+  // Runs one frame of the machine while logging hashes
+  void RunFrame(VSmile& vsmile);
+
+private:
+  void Write(VSmile& vsmile, bool frame_end);
+
+  std::FILE* const out_;
+  const uint64_t step_interval_;
+  uint64_t frame_ = 0;
+  uint64_t steps_ = 0;
+};
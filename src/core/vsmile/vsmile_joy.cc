@@ -4,6 +4,7 @@
 #include <cassert>
 
 #include "vsmile_common.h"
+#include "core/serializer.h"
 
 VSmileJoy::VSmileJoy(VSmileJoySend& joy_send) : joy_send_(joy_send) {}
 
@@ -11,6 +12,8 @@ void VSmileJoy::Reset() {
   idle_timer_.Reset();
   rts_timeout_timer_.Reset();
   tx_start_timer_.Reset();
+  pending_cycles_ = 0;
+  next_event_cycles_ = 0;
   current_ = {};
   last_sent_ = {};
   cts_ = false;
@@ -29,7 +32,98 @@ void VSmileJoy::Reset() {
   led_status_.green = false;
 }
 
+// Bitfields are packed explicitly, since unused bits of their storage are indeterminate
+static void SerializeJoyInput(Serializer& s, VSmileJoy::JoyInput& input) {
+  s.Value(input.y);
+  s.Value(input.x);
+
+  uint8_t buttons = input.red | (input.yellow << 1) | (input.blue << 2) | (input.green << 3) |
+                    (input.enter << 4) | (input.back << 5) | (input.help << 6) |
+                    (input.abc << 7);
+  s.Value(buttons);
+  if (s.IsLoading()) {
+    input.red = buttons & 1;
+    input.yellow = (buttons >> 1) & 1;
+    input.blue = (buttons >> 2) & 1;
+    input.green = (buttons >> 3) & 1;
+    input.enter = (buttons >> 4) & 1;
+    input.back = (buttons >> 5) & 1;
+    input.help = (buttons >> 6) & 1;
+    input.abc = (buttons >> 7) & 1;
+  }
+}
+
+static void SerializeLedStatus(Serializer& s, VSmileJoy::JoyLedStatus& leds) {
+  uint8_t bits = leds.red | (leds.yellow << 1) | (leds.blue << 2) | (leds.green << 3);
+  s.Value(bits);
+  if (s.IsLoading()) {
+    leds.red = bits & 1;
+    leds.yellow = (bits >> 1) & 1;
+    leds.blue = (bits >> 2) & 1;
+    leds.green = (bits >> 3) & 1;
+  }
+}
+
+void VSmileJoy::Serialize(Serializer& s) {
+  SerializeJoyInput(s, current_);
+  SerializeJoyInput(s, last_sent_);
+  idle_timer_.Serialize(s);
+  rts_timeout_timer_.Serialize(s);
+  tx_start_timer_.Serialize(s);
+  s.Value(pending_cycles_);
+  s.Value(next_event_cycles_);
+  s.Value(tx_buffer_);
+  s.Value(tx_buffer_write_);
+  s.Value(tx_buffer_read_);
+  s.Value(probe_history_);
+  s.Value(cts_);
+  s.Value(rts_);
+  s.Value(tx_busy_);
+  s.Value(joy_active_);
+  s.Value(tx_starting_);
+  s.Value(current_updated_);
+  SerializeLedStatus(s, led_status_);
+}
+
 void VSmileJoy::RunCycles(int cycles) {
+  pending_cycles_ += cycles;
+  if (pending_cycles_ < next_event_cycles_)
+    return;
+
+  // Cycles from earlier calls did not expire any timer, apply them before running this call
+  pending_cycles_ -= cycles;
+  Sync();
+  RunEvents(cycles);
+  ScheduleNextEvent();
+}
+
+void VSmileJoy::Sync() {
+  if (!tx_busy_)
+    idle_timer_.Tick(pending_cycles_);
+  if (tx_starting_)
+    tx_start_timer_.Tick(pending_cycles_);
+  if (!rts_ && !cts_ && !tx_starting_ && !tx_busy_)
+    rts_timeout_timer_.Tick(pending_cycles_);
+  pending_cycles_ = 0;
+}
+
+void VSmileJoy::ScheduleNextEvent() {
+  next_event_cycles_ = INT64_MAX;
+  if (!tx_busy_)
+    next_event_cycles_ = std::min<int64_t>(next_event_cycles_, idle_timer_.GetRemainingCycles());
+  if (tx_starting_)
+    next_event_cycles_ =
+        std::min<int64_t>(next_event_cycles_, tx_start_timer_.GetRemainingCycles());
+  if (!rts_ && !cts_ && !tx_starting_ && !tx_busy_)
+    next_event_cycles_ =
+        std::min<int64_t>(next_event_cycles_, rts_timeout_timer_.GetRemainingCycles());
+
+  // Pending input changes are sent on the next call
+  if (joy_active_ && current_updated_)
+    next_event_cycles_ = 0;
+}
+
+void VSmileJoy::RunEvents(int cycles) {
   if (!tx_busy_) {
     if (idle_timer_.Tick(cycles)) {
       QueueTx(0x55);
@@ -75,8 +169,10 @@ void VSmileJoy::RunCycles(int cycles) {
 }
 
 void VSmileJoy::UpdateJoystick(const JoyInput& new_input) {
+  Sync();
   current_ = new_input;
   current_updated_ = true;
+  ScheduleNextEvent();
 }
 
 VSmileJoy::JoyLedStatus VSmileJoy::GetLeds() {
@@ -184,6 +280,7 @@ void VSmileJoy::QueueJoyUpdates() {
 }
 
 void VSmileJoy::Rx(uint8_t value) {
+  Sync();
   switch (value & 0xf0) {
     case 0x60:
       led_status_.green = (value & 0x01) != 0;
@@ -198,24 +295,29 @@ void VSmileJoy::Rx(uint8_t value) {
       QueueTx(0xb0 | (((-probe_history_[0] + -probe_history_[1]) ^ 0xa) & 0xf));
     } break;
   }
+  ScheduleNextEvent();
 }
 
 void VSmileJoy::SetCts(bool value) {
+  Sync();
   cts_ = value;
   if (cts_ && tx_buffer_read_ != tx_buffer_write_ && !tx_busy_ && !tx_starting_) {
     tx_starting_ = true;
     tx_start_timer_.Reset();
   }
+  ScheduleNextEvent();
 }
 
 void VSmileJoy::TxDone() {
   if (!tx_busy_)
     return;
 
+  Sync();
   joy_active_ = true;
   tx_busy_ = false;
 
   if (cts_ && tx_buffer_read_ != tx_buffer_write_) {
     StartTx();
   }
+  ScheduleNextEvent();
 }
@@ -4,6 +4,7 @@
 
 #include <array>
 
+class Serializer;
 class VSmileJoySend;
 
 class VSmileJoy {
@@ -33,6 +34,7 @@ public:
   explicit VSmileJoy(VSmileJoySend& joy_ctrl);
 
   void Reset();
+  void Serialize(Serializer& s);
   void RunCycles(int cycles);
   void Rx(uint8_t value);
   void SetCts(bool value);
@@ -46,6 +48,9 @@ private:
   uint8_t PopTx();
   void QueueJoyUpdates();
   void StartTx();
+  void RunEvents(int cycles);
+  void Sync();
+  void ScheduleNextEvent();
 
   VSmileJoySend& joy_send_;
   JoyInput current_;
@@ -53,6 +58,11 @@ private:
   SimpleClock<27000000> idle_timer_;         // 1 s
   SimpleClock<13500000> rts_timeout_timer_;  // 0.5 s
   SimpleClock<97200> tx_start_timer_;        // 3.6 ms
+
+  // Cycles run since the timers were last updated, and the cycle count at which the next
+  // timer expires. Nothing needs to be done in between.
+  int64_t pending_cycles_ = 0;
+  int64_t next_event_cycles_ = 0;
   std::array<uint8_t, 16> tx_buffer_;
   int tx_buffer_write_ = 0;
   int tx_buffer_read_ = 0;
@@ -0,0 +1,90 @@
+#include "vsmile_loader.h"
+
+#include <fstream>
+#include <vector>
+
+std::optional<std::string> CreateVSmile(const SystemConfig& config,
+                                        std::unique_ptr<VSmile>& vsmile) {
+  if (!config.cartrom_path.has_value()) {
+    return "No cartridge ROM defined";
+  }
+
+  auto cartrom = std::make_unique<VSmile::CartRomType>();
+  if (!ReadRomFile(*config.cartrom_path, *cartrom)) {
+    return "Could not open cartridge ROM file";
+  }
+
+  auto sysrom = std::make_unique<VSmile::SysRomType>();
+  if (!config.use_dummy_sysrom) {
+    if (!config.sysrom_path.has_value() || !ReadRomFile(*config.sysrom_path, *sysrom)) {
+      return "Could not open system ROM file";
+    }
+  } else {
+    MakeDummySysRom(*sysrom);
+  }
+
+  std::unique_ptr<VSmile::ArtNvramType> initial_art_nvram;
+  if (config.cart_type == VSmile::CartType::ART_STUDIO) {
+    initial_art_nvram = std::make_unique<VSmile::ArtNvramType>();
+    // A missing save file leaves the NVRAM empty, as it is created when the NVRAM is saved
+    if (config.csb2_nvram_save_path.has_value())
+      ReadRomFile(*config.csb2_nvram_save_path, *initial_art_nvram);
+  }
+
+  vsmile = std::make_unique<VSmile>(std::move(sysrom), std::move(cartrom), config.cart_type,
+                                    std::move(initial_art_nvram), config.region_code,
+                                    config.vtech_logo, config.video_timing);
+  return {};
+}
+
+std::optional<std::string> SaveArtNvram(VSmile& vsmile, const std::string& path) {
+  const auto* art_nvram = vsmile.GetArtNvram();
+  if (!art_nvram)
+    return "No NVRAM to save";
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file.good())
+    return "Failed to open NVRAM save file for writing";
+
+  std::vector<uint8_t> bytes(sizeof(VSmile::ArtNvramType));
+  for (size_t i = 0; i < art_nvram->size(); i++) {
+    bytes[i * 2] = (*art_nvram)[i] & 0xff;
+    bytes[i * 2 + 1] = (*art_nvram)[i] >> 8;
+  }
+  file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  if (file.fail())
+    return "Failed to write to NVRAM save file";
+  return {};
+}
+
+bool ReadRomFile(const std::string& path, std::span<Word> rom) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.good())
+    return false;
+
+  std::vector<uint8_t> bytes(rom.size_bytes());
+  file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+  const size_t words = file.gcount() / 2;
+  for (size_t i = 0; i < words; i++) {
+    rom[i] = bytes[i * 2] | (bytes[i * 2 + 1] << 8);
+  }
+  return true;
+}
+
+bool WriteRomFile(const std::string& path, std::span<const Word> rom) {
+  std::vector<uint8_t> bytes(rom.size_bytes());
+  for (size_t i = 0; i < rom.size(); i++) {
+    bytes[i * 2] = rom[i] & 0xff;
+    bytes[i * 2 + 1] = rom[i] >> 8;
+  }
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  return file.good();
+}
+
+void MakeDummySysRom(VSmile::SysRomType& sysrom) {
+  sysrom.fill(0);
+  for (int i = 0xfffc0; i < 0xfffdc; i += 2) {
+    sysrom[i + 1] = 0x31;
+  }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+
+#include "vsmile.h"
+
+struct SystemConfig {
+  std::optional<std::string> sysrom_path;
+  std::optional<std::string> cartrom_path;
+  std::optional<std::string> csb2_nvram_save_path;
+  VSmile::CartType cart_type = VSmile::CartType::STANDARD;
+  VideoTiming video_timing = VideoTiming::PAL;
+  bool use_dummy_sysrom = true;
+  unsigned region_code = 0xe;
+  bool vtech_logo = true;
+};
+
+// Reads the ROM images and initial Art Studio NVRAM given by the config and creates a machine
+// from them, which still needs to be reset
+std::optional<std::string> CreateVSmile(const SystemConfig& config,
+                                        std::unique_ptr<VSmile>& vsmile);
+
+// Writes Art Studio NVRAM contents in the same format as they are read by CreateVSmile
+std::optional<std::string> SaveArtNvram(VSmile& vsmile, const std::string& path);
+
+// Reads an image of little-endian words. The rest of the ROM is left unchanged if the file is
+// shorter than the ROM.
+bool ReadRomFile(const std::string& path, std::span<Word> rom);
+// Writes an image of little-endian words that ReadRomFile reads back
+bool WriteRomFile(const std::string& path, std::span<const Word> rom);
+
+// Game-compatible replacement used when no system ROM is provided
+void MakeDummySysRom(VSmile::SysRomType& sysrom);
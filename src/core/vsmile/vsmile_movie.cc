@@ -0,0 +1,185 @@
+#include "vsmile_movie.h"
+
+#include <algorithm>
+
+namespace {
+constexpr uint32_t kMovieMagic = 0x564d5356;  // "VSMV"
+constexpr uint16_t kMovieVersion = 1;
+constexpr size_t kHeaderSize = 16;
+// Over 12 days at 60 fps, which keeps a crafted frame count from allocating gigabytes of frames
+constexpr size_t kMaxFrames = 1 << 26;
+
+// Buttons in bits 0-10, joystick axes offset to 0-10 in bits 11-14 and 15-18
+uint32_t PackInput(const VSmileMovie::FrameInput& input) {
+  uint32_t packed = input.joy.red | (input.joy.yellow << 1) | (input.joy.blue << 2) |
+                    (input.joy.green << 3) | (input.joy.enter << 4) | (input.joy.back << 5) |
+                    (input.joy.help << 6) | (input.joy.abc << 7) | (input.on_button << 8) |
+                    (input.off_button << 9) | (input.restart_button << 10);
+  packed |= (std::clamp(input.joy.x, -5, 5) + 5) << 11;
+  packed |= (std::clamp(input.joy.y, -5, 5) + 5) << 15;
+  return packed;
+}
+
+bool UnpackInput(uint32_t packed, VSmileMovie::FrameInput& input) {
+  const int x = ((packed >> 11) & 0xf) - 5;
+  const int y = ((packed >> 15) & 0xf) - 5;
+  if (x > 5 || y > 5 || packed >> 19)
+    return false;
+
+  input.joy.red = packed & 1;
+  input.joy.yellow = (packed >> 1) & 1;
+  input.joy.blue = (packed >> 2) & 1;
+  input.joy.green = (packed >> 3) & 1;
+  input.joy.enter = (packed >> 4) & 1;
+  input.joy.back = (packed >> 5) & 1;
+  input.joy.help = (packed >> 6) & 1;
+  input.joy.abc = (packed >> 7) & 1;
+  input.on_button = (packed >> 8) & 1;
+  input.off_button = (packed >> 9) & 1;
+  input.restart_button = (packed >> 10) & 1;
+  input.joy.x = x;
+  input.joy.y = y;
+  return true;
+}
+
+void WriteLe(std::vector<uint8_t>& out, uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    out.push_back(value >> (i * 8));
+  }
+}
+
+uint32_t ReadLe(const uint8_t* p, int bytes) {
+  uint32_t value = 0;
+  for (int i = 0; i < bytes; i++) {
+    value |= p[i] << (i * 8);
+  }
+  return value;
+}
+
+// Reads the run of repeated frames at pos, with the run length as a variable length integer
+bool ReadRun(std::span<const uint8_t> data, size_t& pos, size_t& run,
+             VSmileMovie::FrameInput& input) {
+  run = 0;
+  for (int shift = 0;; shift += 7) {
+    if (pos == data.size() || shift > 28)
+      return false;
+    const uint8_t byte = data[pos++];
+    run |= static_cast<size_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      break;
+  }
+
+  if (data.size() - pos < 3 || run == 0 || !UnpackInput(ReadLe(&data[pos], 3), input))
+    return false;
+  pos += 3;
+  return true;
+}
+}  // namespace
+
+VSmileMovie::VSmileMovie(const Settings& settings) : settings_(settings) {}
+
+void VSmileMovie::ApplyInput(VSmile& vsmile, const FrameInput& input) {
+  vsmile.UpdateJoystick(input.joy);
+  vsmile.UpdateOnButton(input.on_button);
+  vsmile.UpdateOffButton(input.off_button);
+  vsmile.UpdateRestartButton(input.restart_button);
+}
+
+void VSmileMovie::AddFrame(const FrameInput& input) {
+  frames_.push_back(input);
+}
+
+void VSmileMovie::Truncate(size_t frame_count) {
+  if (frame_count < frames_.size())
+    frames_.resize(frame_count);
+}
+
+const VSmileMovie::Settings& VSmileMovie::GetSettings() const {
+  return settings_;
+}
+
+size_t VSmileMovie::GetFrameCount() const {
+  return frames_.size();
+}
+
+const VSmileMovie::FrameInput& VSmileMovie::GetFrame(size_t frame) const {
+  return frames_[frame];
+}
+
+void VSmileMovie::Save(std::vector<uint8_t>& out) const {
+  out.clear();
+  WriteLe(out, kMovieMagic, 4);
+  WriteLe(out, kMovieVersion, 2);
+  WriteLe(out, static_cast<uint8_t>(settings_.video_timing), 1);
+  WriteLe(out, static_cast<uint8_t>(settings_.cart_type), 1);
+  WriteLe(out, settings_.region_code, 1);
+  WriteLe(out, settings_.vtech_logo, 1);
+  WriteLe(out, 0, 2);
+  WriteLe(out, frames_.size(), 4);
+
+  size_t pos = 0;
+  while (pos < frames_.size()) {
+    const uint32_t packed = PackInput(frames_[pos]);
+    size_t run = 1;
+    while (pos + run < frames_.size() && PackInput(frames_[pos + run]) == packed) {
+      run++;
+    }
+
+    // Run length as variable length integer with 7 bits per byte
+    size_t length = run;
+    while (length >= 0x80) {
+      out.push_back((length & 0x7f) | 0x80);
+      length >>= 7;
+    }
+    out.push_back(length);
+    WriteLe(out, packed, 3);
+
+    pos += run;
+  }
+}
+
+bool VSmileMovie::Load(std::span<const uint8_t> data) {
+  if (data.size() < kHeaderSize || ReadLe(&data[0], 4) != kMovieMagic ||
+      ReadLe(&data[4], 2) != kMovieVersion)
+    return false;
+
+  Settings settings;
+  settings.video_timing = static_cast<VideoTiming>(data[6]);
+  settings.cart_type = static_cast<VSmile::CartType>(data[7]);
+  settings.region_code = data[8];
+  settings.vtech_logo = data[9];
+  if ((settings.video_timing != VideoTiming::PAL && settings.video_timing != VideoTiming::NTSC) ||
+      (settings.cart_type != VSmile::CartType::STANDARD &&
+       settings.cart_type != VSmile::CartType::ART_STUDIO) ||
+      settings.region_code > 0xf || data[9] > 1)
+    return false;
+
+  // The frame count in the header is checked against the runs in the rest of the data before
+  // allocating any frames
+  const size_t frame_count = ReadLe(&data[12], 4);
+  if (frame_count > kMaxFrames)
+    return false;
+  size_t run_frames = 0;
+  for (size_t pos = kHeaderSize; pos < data.size();) {
+    size_t run;
+    FrameInput input;
+    if (!ReadRun(data, pos, run, input) || run > frame_count - run_frames)
+      return false;
+    run_frames += run;
+  }
+  if (run_frames != frame_count)
+    return false;
+
+  std::vector<FrameInput> frames;
+  frames.reserve(frame_count);
+  for (size_t pos = kHeaderSize; pos < data.size();) {
+    size_t run;
+    FrameInput input;
+    ReadRun(data, pos, run, input);
+    frames.insert(frames.end(), run, input);
+  }
+
+  settings_ = settings;
+  frames_ = std::move(frames);
+  return true;
+}
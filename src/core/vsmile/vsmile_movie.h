@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "vsmile.h"
+
+// Per-frame record of controller and console button input. A movie always starts from a hard
+// reset of a machine using the deterministic random number generator, so replaying its input
+// reproduces the recorded run exactly.
+class VSmileMovie {
+public:
+  struct Settings {
+    VideoTiming video_timing = VideoTiming::PAL;
+    VSmile::CartType cart_type = VSmile::CartType::STANDARD;
+    unsigned region_code = 0xe;
+    bool vtech_logo = true;
+  };
+
+  struct FrameInput {
+    VSmile::JoyInput joy;
+    bool on_button = false;
+    bool off_button = false;
+    bool restart_button = false;
+  };
+
+  VSmileMovie() = default;
+  explicit VSmileMovie(const Settings& settings);
+
+  // Apply input of a frame to the machine before running that frame
+  static void ApplyInput(VSmile& vsmile, const FrameInput& input);
+
+  void AddFrame(const FrameInput& input);
+  void Truncate(size_t frame_count);
+
+  const Settings& GetSettings() const;
+  size_t GetFrameCount() const;
+  const FrameInput& GetFrame(size_t frame) const;
+
+  // Movie files use a fixed little-endian layout with repeated frames run-length encoded
+  void Save(std::vector<uint8_t>& out) const;
+  bool Load(std::span<const uint8_t> data);
+
+private:
+  Settings settings_;
+  std::vector<FrameInput> frames_;
+};
@@ -0,0 +1,155 @@
+#include "batch_runner.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string_view>
+
+#include "headless_args.h"
+#include "thread_pool.h"
+
+namespace {
+// Splits at whitespace, except inside double quotes
+std::optional<std::vector<std::string>> SplitLine(std::string_view line) {
+  std::vector<std::string> tokens;
+  std::optional<std::string> token;
+  bool quoted = false;
+  for (char c : line) {
+    if (c == '"') {
+      quoted = !quoted;
+      if (!token)
+        token.emplace();
+    } else if (!quoted && (c == ' ' || c == '\t' || c == '\r')) {
+      if (token)
+        tokens.push_back(std::move(*token));
+      token.reset();
+    } else {
+      if (!token)
+        token.emplace();
+      token->push_back(c);
+    }
+  }
+  if (quoted)
+    return std::nullopt;
+  if (token)
+    tokens.push_back(std::move(*token));
+  return tokens;
+}
+
+void ResolveOutputPath(const std::filesystem::path& job_dir, std::string& path) {
+  if (std::filesystem::path(path).is_relative())
+    path = (job_dir / path).lexically_normal().string();
+}
+
+void ResolveOutputPath(const std::filesystem::path& job_dir, std::optional<std::string>& path) {
+  if (path.has_value())
+    ResolveOutputPath(job_dir, *path);
+}
+}  // namespace
+
+std::optional<std::string> LoadBatchManifest(const std::string& path,
+                                             const std::string& output_dir,
+                                             std::vector<BatchJob>& jobs) {
+  std::ifstream manifest(path);
+  if (!manifest.good())
+    return "Could not open batch manifest";
+
+  std::set<std::string> names;
+  std::string line;
+  for (int line_number = 1; std::getline(manifest, line); line_number++) {
+    const std::string location = "Line " + std::to_string(line_number) + ": ";
+    auto tokens = SplitLine(line);
+    if (!tokens.has_value())
+      return location + "Unterminated quote";
+    if (tokens->empty() || (*tokens)[0][0] == '#')
+      continue;
+
+    BatchJob job;
+    job.name = "line" + std::to_string(line_number);
+    std::vector<std::string_view> args;
+    for (size_t i = 0; i < tokens->size(); i++) {
+      if ((*tokens)[i] == "-name" && i + 1 < tokens->size()) {
+        job.name = (*tokens)[++i];
+      } else {
+        args.push_back((*tokens)[i]);
+      }
+    }
+    if (!names.insert(job.name).second)
+      return location + "Duplicate job name " + job.name;
+
+    auto error = ParseHeadlessArgs(args, job.options);
+    if (error.has_value())
+      return location + *error;
+
+    const auto job_dir = std::filesystem::path(output_dir) / job.name;
+    ResolveOutputPath(job_dir, job.options.output_dir);
+    ResolveOutputPath(job_dir, job.options.frame_hash_path);
+    ResolveOutputPath(job_dir, job.options.state_hash_path);
+    ResolveOutputPath(job_dir, job.options.audio_path);
+    ResolveOutputPath(job_dir, job.options.profile_path);
+    ResolveOutputPath(job_dir, job.options.profile_collapsed_path);
+    ResolveOutputPath(job_dir, job.options.call_graph_path);
+    ResolveOutputPath(job_dir, job.options.call_graph_report_path);
+    ResolveOutputPath(job_dir, job.options.timing_path);
+    ResolveOutputPath(job_dir, job.options.access_stats_path);
+    jobs.push_back(std::move(job));
+  }
+  return {};
+}
+
+std::vector<BatchJobResult> RunBatch(
+    const std::vector<BatchJob>& jobs, unsigned threads,
+    const std::function<void(const BatchJob&, const BatchJobResult&)>& on_done) {
+  std::vector<BatchJobResult> results(jobs.size());
+  std::mutex callback_mutex;
+
+  ThreadPool pool(threads);
+  for (size_t i = 0; i < jobs.size(); i++) {
+    pool.Submit([&, i] {
+      const auto& options = jobs[i].options;
+      std::error_code error;
+      std::filesystem::create_directories(options.output_dir, error);
+      if (error) {
+        results[i].error = "Could not create output directory";
+      } else {
+        results[i].error = RunHeadless(options, results[i].result);
+      }
+
+      std::lock_guard lock(callback_mutex);
+      on_done(jobs[i], results[i]);
+    });
+  }
+  pool.Wait();
+  return results;
+}
+
+bool WriteBatchResults(const std::string& path, const std::vector<BatchJob>& jobs,
+                       const std::vector<BatchJobResult>& results) {
+  std::FILE* file = std::fopen(path.c_str(), "w");
+  if (!file)
+    return false;
+
+  std::fprintf(file, "name\tstatus\tframes\tseconds\tfps\tstate_hash\terror\n");
+  for (size_t i = 0; i < jobs.size(); i++) {
+    const auto& job = jobs[i];
+    const auto& result = results[i];
+    const char* status = "ok";
+    std::string message = result.error.value_or("");
+    if (result.error.has_value()) {
+      status = "error";
+    } else if (result.result.golden_mismatch.has_value()) {
+      status = "golden_mismatch";
+      message = *result.result.golden_mismatch;
+    } else if (job.options.until_memory.has_value() && !result.result.until_memory_reached) {
+      status = "condition_not_reached";
+    }
+    std::fprintf(file, "%s\t%s\t%" PRIu64 "\t%.3f\t%.1f\t%016" PRIx64 "\t%s\n", job.name.c_str(),
+                 status, result.result.frames, result.result.seconds,
+                 result.result.seconds > 0 ? result.result.frames / result.result.seconds : 0.0,
+                 result.result.state_hash, message.c_str());
+  }
+  return std::fclose(file) == 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "headless_runner.h"
+
+struct BatchJob {
+  std::string name;
+  HeadlessOptions options;
+};
+
+struct BatchJobResult {
+  std::optional<std::string> error;
+  HeadlessResult result;
+};
+
+// Reads a manifest with one job per line, given by the same options as a single headless run
+// plus an optional "-name NAME". Empty lines and lines starting with # are skipped. Relative
+// output paths of each job are placed in a directory named after the job in output_dir.
+std::optional<std::string> LoadBatchManifest(const std::string& path,
+                                             const std::string& output_dir,
+                                             std::vector<BatchJob>& jobs);
+
+// Runs all jobs on a thread pool and returns their results in job order. The callback is
+// called from the worker threads as each job finishes, but never concurrently.
+std::vector<BatchJobResult> RunBatch(
+    const std::vector<BatchJob>& jobs, unsigned threads,
+    const std::function<void(const BatchJob&, const BatchJobResult&)>& on_done);
+
+// Writes results as tab-separated values with a header line
+bool WriteBatchResults(const std::string& path, const std::vector<BatchJob>& jobs,
+                       const std::vector<BatchJobResult>& results);
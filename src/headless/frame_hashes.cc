@@ -0,0 +1,111 @@
+#include "frame_hashes.h"
+
+#include <charconv>
+#include <cinttypes>
+#include <fstream>
+#include <sstream>
+
+#include "core/state/xxhash.h"
+
+namespace {
+template <typename T>
+bool ParseHex(std::string_view str, T& value) {
+  auto [ptr, error] = std::from_chars(str.data(), str.data() + str.size(), value, 16);
+  return ptr == str.data() + str.size() && error == std::errc();
+}
+
+bool ParseLineHashes(std::string_view str, std::vector<uint16_t>& lines) {
+  if (str.size() % 4 != 0)
+    return false;
+  lines.resize(str.size() / 4);
+  for (size_t i = 0; i < lines.size(); i++) {
+    if (!ParseHex(str.substr(i * 4, 4), lines[i]))
+      return false;
+  }
+  return true;
+}
+}  // namespace
+
+FrameHashes HashFrame(std::span<const uint8_t> picture, int height,
+                      std::span<const uint16_t> audio) {
+  FrameHashes hashes;
+  hashes.picture = Xxh64::Hash(picture);
+  hashes.audio = Xxh64::Hash(
+      std::span(reinterpret_cast<const uint8_t*>(audio.data()), audio.size_bytes()));
+
+  const size_t line_size = picture.size() / height;
+  hashes.lines.resize(height);
+  for (int line = 0; line < height; line++) {
+    hashes.lines[line] = Xxh64::Hash(picture.subspan(line * line_size, line_size)) & 0xffff;
+  }
+  return hashes;
+}
+
+void FrameHashWriter::Write(uint64_t frame, const FrameHashes& hashes) {
+  std::fprintf(file_, "%" PRIu64 " %016" PRIx64 " %016" PRIx64, frame, hashes.picture,
+               hashes.audio);
+  if (last_picture_ != hashes.picture) {
+    std::fputc(' ', file_);
+    for (uint16_t line : hashes.lines) {
+      std::fprintf(file_, "%04x", line);
+    }
+  }
+  std::fputc('\n', file_);
+  last_picture_ = hashes.picture;
+}
+
+std::optional<std::string> GoldenFrameHashes::Load(const std::string& path) {
+  std::ifstream file(path);
+  if (!file.good())
+    return "Could not open golden hash file";
+
+  frames_.clear();
+  std::string line;
+  for (int line_number = 1; std::getline(file, line); line_number++) {
+    std::istringstream fields(line);
+    std::string frame, picture, audio, lines;
+    fields >> frame >> picture >> audio >> lines;
+
+    FrameHashes hashes;
+    uint64_t frame_number;
+    if (!ParseHex(picture, hashes.picture) || !ParseHex(audio, hashes.audio) ||
+        !ParseLineHashes(lines, hashes.lines) ||
+        std::from_chars(frame.data(), frame.data() + frame.size(), frame_number).ec !=
+            std::errc() ||
+        frame_number != frames_.size()) {
+      return "Invalid golden hash file at line " + std::to_string(line_number);
+    }
+
+    // Scanline hashes are left out when the picture is the same as in the last frame
+    if (lines.empty() && !frames_.empty() && frames_.back().picture == hashes.picture)
+      hashes.lines = frames_.back().lines;
+    frames_.push_back(std::move(hashes));
+  }
+  return {};
+}
+
+std::optional<std::string> GoldenFrameHashes::Compare(uint64_t frame,
+                                                      const FrameHashes& hashes) const {
+  const std::string location = "Frame " + std::to_string(frame) + ": ";
+  if (frame >= frames_.size())
+    return location + "No golden hashes for frame";
+
+  const FrameHashes& golden = frames_[frame];
+  if (golden.picture != hashes.picture) {
+    std::string message = location + "Picture differs";
+    if (golden.lines.size() == hashes.lines.size()) {
+      for (size_t line = 0; line < hashes.lines.size(); line++) {
+        if (golden.lines[line] != hashes.lines[line]) {
+          message += " from scanline " + std::to_string(line);
+          break;
+        }
+      }
+    }
+    if (golden.audio != hashes.audio)
+      message += ", audio differs";
+    return message;
+  }
+  if (golden.audio != hashes.audio)
+    return location + "Audio differs";
+  return {};
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// Hashes of the picture and audio of one frame. The 16-bit hash of each scanline locates where
+// a picture first differs.
+struct FrameHashes {
+  uint64_t picture = 0;
+  uint64_t audio = 0;
+  std::vector<uint16_t> lines;
+};
+
+FrameHashes HashFrame(std::span<const uint8_t> picture, int height,
+                      std::span<const uint16_t> audio);
+
+// Writes one line per frame with the frame number and the picture and audio hashes in hex. The
+// scanline hashes follow as a single hex string when the picture changed since the last frame.
+class FrameHashWriter {
+public:
+  explicit FrameHashWriter(std::FILE* file) : file_(file) {}
+
+  void Write(uint64_t frame, const FrameHashes& hashes);
+
+private:
+  std::FILE* file_;
+  std::optional<uint64_t> last_picture_;
+};
+
+// Golden hashes as written by FrameHashWriter, to compare a run against
+class GoldenFrameHashes {
+public:
+  std::optional<std::string> Load(const std::string& path);
+
+  uint64_t GetFrameCount() const {
+    return frames_.size();
+  }
+
+  // Describes the first difference of the frame from the golden one, if any
+  std::optional<std::string> Compare(uint64_t frame, const FrameHashes& hashes) const;
+
+private:
+  std::vector<FrameHashes> frames_;
+};
@@ -0,0 +1,124 @@
+#include "headless_args.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace {
+template <typename T>
+bool ParseNumber(std::string_view str, T& value, int base = 10) {
+  auto [ptr, error] = std::from_chars(str.data(), str.data() + str.size(), value, base);
+  return ptr == str.data() + str.size() && error == std::errc();
+}
+
+bool ParseFrameList(std::string_view str, std::set<uint64_t>& frames) {
+  while (!str.empty()) {
+    const size_t comma = std::min(str.find(','), str.size());
+    uint64_t frame;
+    if (!ParseNumber(str.substr(0, comma), frame))
+      return false;
+    frames.insert(frame);
+    str.remove_prefix(std::min(comma + 1, str.size()));
+  }
+  return !frames.empty();
+}
+}  // namespace
+
+std::optional<std::string> ParseHeadlessArgs(std::span<const std::string_view> args,
+                                             HeadlessOptions& options) {
+  auto& system_config = options.system_config;
+  bool read_flags = true;
+
+  size_t argpos = 0;
+  while (argpos < args.size()) {
+    const auto& arg = args[argpos];
+    if (read_flags && !arg.empty() && arg[0] == '-') {
+      const bool takes_value = arg != "-pal" && arg != "-ntsc" && arg != "-art" &&
+                               arg != "-novtech" && arg != "-raw" && arg != "--";
+      if (takes_value && argpos + 1 >= args.size())
+        return "Expected value for " + std::string(arg);
+
+      bool valid = true;
+      if (arg == "-sysrom") {
+        system_config.sysrom_path = args[++argpos];
+        system_config.use_dummy_sysrom = false;
+      } else if (arg == "-art-nvram") {
+        system_config.cart_type = VSmile::CartType::ART_STUDIO;
+        system_config.csb2_nvram_save_path = args[++argpos];
+      } else if (arg == "-ntsc") {
+        system_config.video_timing = VideoTiming::NTSC;
+      } else if (arg == "-pal") {
+        system_config.video_timing = VideoTiming::PAL;
+      } else if (arg == "-art") {
+        system_config.cart_type = VSmile::CartType::ART_STUDIO;
+      } else if (arg == "-region") {
+        valid = ParseNumber(args[++argpos], system_config.region_code, 16) &&
+                system_config.region_code <= 0xf;
+      } else if (arg == "-novtech") {
+        system_config.vtech_logo = false;
+      } else if (arg == "-frames") {
+        valid = ParseNumber(args[++argpos], options.frames);
+      } else if (arg == "-play-movie") {
+        options.movie_path = args[++argpos];
+      } else if (arg == "-until") {
+        const auto& condition = args[++argpos];
+        const size_t equals = condition.find('=');
+        Addr addr;
+        Word value;
+        valid = equals != std::string_view::npos &&
+                ParseNumber(condition.substr(0, equals), addr, 16) && addr < (1 << 22) &&
+                ParseNumber(condition.substr(equals + 1), value, 16);
+        if (valid)
+          options.until_memory = {addr, value};
+      } else if (arg == "-frame-hashes") {
+        options.frame_hash_path = args[++argpos];
+      } else if (arg == "-golden") {
+        options.golden_path = args[++argpos];
+      } else if (arg == "-state-hash-log") {
+        options.state_hash_path = args[++argpos];
+      } else if (arg == "-dump-audio") {
+        options.audio_path = args[++argpos];
+      } else if (arg == "-profile") {
+        options.profile_path = args[++argpos];
+      } else if (arg == "-profile-collapsed") {
+        options.profile_collapsed_path = args[++argpos];
+      } else if (arg == "-profile-sample") {
+        valid = ParseNumber(args[++argpos], options.profile_sample_interval) &&
+                options.profile_sample_interval > 0;
+      } else if (arg == "-call-graph") {
+        options.call_graph_path = args[++argpos];
+      } else if (arg == "-call-graph-report") {
+        options.call_graph_report_path = args[++argpos];
+      } else if (arg == "-symbols") {
+        options.symbols_path = args[++argpos];
+      } else if (arg == "-timing") {
+        options.timing_path = args[++argpos];
+      } else if (arg == "-access-stats") {
+        options.access_stats_path = args[++argpos];
+      } else if (arg == "-dump-picture") {
+        valid = ParseFrameList(args[++argpos], options.picture_frames);
+      } else if (arg == "-dump-ram") {
+        valid = ParseFrameList(args[++argpos], options.ram_frames);
+      } else if (arg == "-raw") {
+        options.raw_pictures = true;
+      } else if (arg == "-out") {
+        options.output_dir = args[++argpos];
+      } else if (arg == "--") {
+        read_flags = false;
+      } else {
+        return "Unknown flag " + std::string(arg);
+      }
+
+      if (!valid)
+        return "Invalid value for " + std::string(arg);
+    } else {
+      if (system_config.cartrom_path.has_value())
+        return "too many ROM arguments sent";
+      system_config.cartrom_path = arg;
+    }
+    argpos++;
+  }
+
+  if (!options.frames && !options.movie_path.has_value() && !options.golden_path.has_value())
+    return "Either -frames, -play-movie or -golden is required";
+  return {};
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "headless_runner.h"
+
+// Parses the options of a single run, as given on the command line or in a batch manifest
+std::optional<std::string> ParseHeadlessArgs(std::span<const std::string_view> args,
+                                             HeadlessOptions& options);
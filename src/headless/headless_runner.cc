@@ -0,0 +1,269 @@
+#include "headless_runner.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "core/spg200/call_graph_profiler.h"
+#include "core/spg200/instruction_profiler.h"
+#include "core/spg200/memory_access_stats.h"
+#include "core/spg200/spu.h"
+#include "core/vsmile/vsmile_frame_timings.h"
+#include "core/vsmile/vsmile_hash_log.h"
+#include "core/vsmile/vsmile_movie.h"
+#include "frame_hashes.h"
+#include "output_files.h"
+
+namespace {
+constexpr int kPictureWidth = 320;
+constexpr int kPictureHeight = 240;
+constexpr Addr kRamWords = 0x2800;
+
+std::string GetOutputPath(const HeadlessOptions& options, uint64_t frame, const char* extension) {
+  char name[32];
+  std::snprintf(name, sizeof name, "frame_%06" PRIu64 ".%s", frame, extension);
+  return (std::filesystem::path(options.output_dir) / name).string();
+}
+
+bool WriteRam(const std::string& path, VSmile& vsmile) {
+  std::vector<uint8_t> bytes;
+  bytes.reserve(kRamWords * 2);
+  for (Addr addr = 0; addr < kRamWords; addr++) {
+    const Word value = vsmile.ReadFromMemory(addr);
+    bytes.push_back(value & 0xff);
+    bytes.push_back(value >> 8);
+  }
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  return file.good();
+}
+
+// Closes the file when going out of scope
+struct FileCloser {
+  void operator()(std::FILE* file) const {
+    std::fclose(file);
+  }
+};
+using FilePtr = std::unique_ptr<std::FILE, FileCloser>;
+
+std::optional<std::string> Run(const HeadlessOptions& options, HeadlessResult& result) {
+  SystemConfig config = options.system_config;
+  VSmileMovie movie;
+  if (options.movie_path.has_value()) {
+    std::ifstream movie_file(*options.movie_path, std::ios::binary);
+    if (!movie_file.good())
+      return "Could not open movie file";
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(movie_file)),
+                              std::istreambuf_iterator<char>());
+    if (!movie.Load(data))
+      return "Invalid movie file";
+
+    const auto& settings = movie.GetSettings();
+    config.video_timing = settings.video_timing;
+    config.cart_type = settings.cart_type;
+    config.region_code = settings.region_code;
+    config.vtech_logo = settings.vtech_logo;
+  }
+
+  std::optional<GoldenFrameHashes> golden;
+  if (options.golden_path.has_value()) {
+    golden.emplace();
+    auto error = golden->Load(*options.golden_path);
+    if (error.has_value())
+      return error;
+  }
+
+  uint64_t frames = options.frames ? options.frames : movie.GetFrameCount();
+  if (!frames && golden)
+    frames = golden->GetFrameCount();
+  if (frames == 0)
+    return "No number of frames to run given";
+
+  std::unique_ptr<VSmile> vsmile;
+  auto error = CreateVSmile(config, vsmile);
+  if (error.has_value())
+    return error;
+  vsmile->SetDeterministicRandom(true);
+  vsmile->Reset();
+
+  if (!options.picture_frames.empty() || !options.ram_frames.empty()) {
+    std::error_code fs_error;
+    std::filesystem::create_directories(options.output_dir, fs_error);
+  }
+
+  FilePtr frame_hash_file;
+  std::optional<FrameHashWriter> frame_hash_writer;
+  if (options.frame_hash_path.has_value()) {
+    frame_hash_file.reset(std::fopen(options.frame_hash_path->c_str(), "w"));
+    if (!frame_hash_file)
+      return "Could not open frame hash file";
+    frame_hash_writer.emplace(frame_hash_file.get());
+  }
+
+  FilePtr state_hash_file;
+  std::optional<VSmileHashLog> state_hash_log;
+  if (options.state_hash_path.has_value()) {
+    state_hash_file.reset(std::fopen(options.state_hash_path->c_str(), "w"));
+    if (!state_hash_file)
+      return "Could not open state hash log file";
+    state_hash_log.emplace(state_hash_file.get());
+  }
+
+  std::optional<InstructionProfiler> profiler;
+  if (options.profile_path.has_value() || options.profile_collapsed_path.has_value()) {
+    profiler.emplace(options.profile_sample_interval);
+    vsmile->SetInstructionProfiler(&*profiler);
+  }
+
+  SymbolMap symbols;
+  if (options.symbols_path.has_value()) {
+    auto error = symbols.Load(*options.symbols_path);
+    if (error.has_value())
+      return error;
+  }
+  std::optional<CallGraphProfiler> call_graph;
+  if (options.call_graph_path.has_value() || options.call_graph_report_path.has_value()) {
+    call_graph.emplace();
+    vsmile->SetCallGraphProfiler(&*call_graph);
+  }
+  std::optional<MemoryAccessStats> access_stats;
+  if (options.access_stats_path.has_value()) {
+    access_stats.emplace();
+    vsmile->SetMemoryAccessStats(&*access_stats);
+  }
+
+  // Times every frame of the run, rather than a window of recent ones
+  std::optional<VSmileFrameTimings> timings;
+  if (options.timing_path.has_value())
+    timings.emplace(0);
+
+  WavWriter wav_writer;
+  if (options.audio_path.has_value() && !wav_writer.Open(*options.audio_path, Spu::SampleRate))
+    return "Could not open audio file";
+
+  const auto start = std::chrono::steady_clock::now();
+  uint64_t frame = 0;
+  while (frame < frames) {
+    if (frame < movie.GetFrameCount())
+      VSmileMovie::ApplyInput(*vsmile, movie.GetFrame(frame));
+    if (timings)
+      timings->StartEmulation(*vsmile);
+    if (state_hash_log) {
+      state_hash_log->RunFrame(*vsmile);
+    } else {
+      vsmile->RunFrame();
+    }
+    if (timings)
+      timings->EndEmulation(*vsmile);
+
+    const auto picture = vsmile->GetPicture();
+    const auto audio = vsmile->GetAudio();
+    if (frame_hash_writer || golden) {
+      const FrameHashes hashes = HashFrame(picture, kPictureHeight, audio);
+      if (frame_hash_writer)
+        frame_hash_writer->Write(frame, hashes);
+      if (golden)
+        result.golden_mismatch = golden->Compare(frame, hashes);
+    }
+    wav_writer.Write(audio);
+
+    if (options.picture_frames.contains(frame)) {
+      const bool written =
+          options.raw_pictures
+              ? std::ofstream(GetOutputPath(options, frame, "raw"), std::ios::binary)
+                    .write(reinterpret_cast<const char*>(picture.data()), picture.size())
+                    .good()
+              : WritePng(GetOutputPath(options, frame, "png"), picture, kPictureWidth,
+                         kPictureHeight);
+      if (!written)
+        return "Could not write picture file";
+    }
+    if (options.ram_frames.contains(frame) &&
+        !WriteRam(GetOutputPath(options, frame, "ram"), *vsmile))
+      return "Could not write RAM file";
+
+    if (timings)
+      timings->EndFrame();
+    frame++;
+    if (result.golden_mismatch.has_value())
+      break;
+    if (options.until_memory.has_value() &&
+        vsmile->ReadFromMemory(options.until_memory->first) == options.until_memory->second) {
+      result.until_memory_reached = true;
+      break;
+    }
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  if (!wav_writer.Close())
+    return "Could not write audio file";
+
+  if (timings) {
+    FilePtr file(std::fopen(options.timing_path->c_str(), "w"));
+    if (!file)
+      return "Could not open timing file";
+    timings->WriteJson(file.get());
+  }
+
+  if (profiler) {
+    vsmile->SetInstructionProfiler(nullptr);
+    if (options.profile_path.has_value()) {
+      FilePtr file(std::fopen(options.profile_path->c_str(), "w"));
+      if (!file)
+        return "Could not open profile file";
+      profiler->WriteReport(file.get());
+    }
+    if (options.profile_collapsed_path.has_value()) {
+      FilePtr file(std::fopen(options.profile_collapsed_path->c_str(), "w"));
+      if (!file)
+        return "Could not open collapsed profile file";
+      profiler->WriteCollapsed(file.get());
+    }
+  }
+
+  if (call_graph) {
+    vsmile->SetCallGraphProfiler(nullptr);
+    if (options.call_graph_path.has_value()) {
+      FilePtr file(std::fopen(options.call_graph_path->c_str(), "w"));
+      if (!file)
+        return "Could not open call graph file";
+      call_graph->WriteCollapsed(file.get(), symbols);
+    }
+    if (options.call_graph_report_path.has_value()) {
+      FilePtr file(std::fopen(options.call_graph_report_path->c_str(), "w"));
+      if (!file)
+        return "Could not open call graph report file";
+      call_graph->WriteReport(file.get(), symbols);
+    }
+  }
+
+  if (access_stats) {
+    vsmile->SetMemoryAccessStats(nullptr);
+    FilePtr file(std::fopen(options.access_stats_path->c_str(), "w"));
+    if (!file)
+      return "Could not open access statistics file";
+    access_stats->WriteCsv(file.get());
+  }
+
+  result.frames = frame;
+  result.seconds = std::chrono::duration<double>(end - start).count();
+  result.emulated_frame_rate = GetEmulatedFrameRate(config.video_timing);
+  result.state_hash = vsmile->GetStateHash();
+  return {};
+}
+}  // namespace
+
+std::optional<std::string> RunHeadless(const HeadlessOptions& options, HeadlessResult& result) {
+  try {
+    return Run(options, result);
+  } catch (const EmulationError& error) {
+    return std::string("Emulation error: ") + error.what();
+  } catch (const std::exception& error) {
+    // Such as running out of memory for a malformed input, which should only fail this run
+    return std::string("Error: ") + error.what();
+  }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "core/spg200/types.h"
+#include "core/vsmile/vsmile_loader.h"
+
+struct HeadlessOptions {
+  SystemConfig system_config;
+  // Input to replay, whose machine settings override those of the system config
+  std::optional<std::string> movie_path;
+  // Frames to run, or all frames of the movie or golden hashes when zero
+  uint64_t frames = 0;
+  // Stops early after the frame where the memory word at the address has the value
+  std::optional<std::pair<Addr, Word>> until_memory;
+
+  // Text log of picture and audio hashes of every frame
+  std::optional<std::string> frame_hash_path;
+  // Hash log of an earlier run to compare against, stopping at the first differing frame
+  std::optional<std::string> golden_path;
+  std::optional<std::string> state_hash_path;
+  std::optional<std::string> audio_path;
+  // Instruction profile as a text report and in collapsed stack format, recording one in every
+  // profile_sample_interval instructions
+  std::optional<std::string> profile_path;
+  std::optional<std::string> profile_collapsed_path;
+  uint32_t profile_sample_interval = 1;
+  // Cycles per emulated call stack in collapsed stack format, and per function as a report,
+  // with function names from the symbol file
+  std::optional<std::string> call_graph_path;
+  std::optional<std::string> call_graph_report_path;
+  std::optional<std::string> symbols_path;
+  // Host time per frame spent in emulation components and output, as JSON
+  std::optional<std::string> timing_path;
+  // Bus accesses per register and memory region by each requester, as CSV
+  std::optional<std::string> access_stats_path;
+  // Frames after which the picture and RAM are written to the output directory
+  std::set<uint64_t> picture_frames;
+  std::set<uint64_t> ram_frames;
+  bool raw_pictures = false;
+  std::string output_dir = ".";
+};
+
+struct HeadlessResult {
+  uint64_t frames = 0;
+  double seconds = 0;
+  double emulated_frame_rate = 0;
+  bool until_memory_reached = false;
+  // First difference from the golden hashes
+  std::optional<std::string> golden_mismatch;
+  uint64_t state_hash = 0;
+};
+
+// Runs a machine without any frontend, starting from a hard reset with deterministic random
+// numbers so that repeated runs give the same output. Emulation errors are returned like other
+// errors, so runs on other threads are unaffected.
+std::optional<std::string> RunHeadless(const HeadlessOptions& options, HeadlessResult& result);
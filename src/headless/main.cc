@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "batch_runner.h"
+#include "headless_args.h"
+#include "headless_runner.h"
+#include "version.h"
+
+namespace {
+void PrintUsage(std::string exec_name) {
+  std::cout
+      << "veesem (V.Smile emulator) headless runner version " << VEESEM_VERSION << std::endl
+      << std::endl
+      << "Usage: " << exec_name << " [OPTIONS] CARTROM" << std::endl
+      << "       " << exec_name << " -batch FILE [-jobs N] [-out DIR]" << std::endl
+      << std::endl
+      << "Options:" << std::endl
+      << "  -sysrom ROM       Provide system ROM" << std::endl
+      << "  -pal              Use PAL video timing (default)" << std::endl
+      << "  -ntsc             Use NTSC video timing" << std::endl
+      << "  -art              Emulate CSB2 cartridge NVRAM (used by V.Smile Art Studio)"
+      << std::endl
+      << "  -art-nvram FILE   Emulate CSB2 cartridge NVRAM with initial contents from FILE"
+      << std::endl
+      << "  -region NUM       Set jumpers configuring system ROM region as hex number in range "
+         "0-f"
+      << std::endl
+      << "  -novtech          Set jumpers disabling VTech logo in system ROM intro" << std::endl
+      << std::endl
+      << "  -frames N         Run N frames (default is the length of the movie or golden file)"
+      << std::endl
+      << "  -play-movie FILE  Replay input from movie FILE" << std::endl
+      << "  -until ADDR=VAL   Stop after the frame where memory word ADDR is VAL (both hex)"
+      << std::endl
+      << std::endl
+      << "  -frame-hashes FILE    Write picture and audio hashes of every frame to FILE"
+      << std::endl
+      << "  -golden FILE          Compare hashes of every frame with FILE from -frame-hashes,"
+      << std::endl
+      << "                        stopping at the first difference" << std::endl
+      << "  -state-hash-log FILE  Write machine state hashes of every frame to FILE" << std::endl
+      << "  -dump-audio FILE      Write all audio to FILE as WAV" << std::endl
+      << "  -profile FILE         Write instructions and cycles per CPU address to FILE"
+      << std::endl
+      << "  -profile-collapsed FILE" << std::endl
+      << "                        Write cycles per CPU address to FILE for flame graph tools"
+      << std::endl
+      << "  -profile-sample N     Profile only one in every N instructions (default 1)"
+      << std::endl
+      << "  -call-graph FILE      Write cycles per emulated call stack to FILE for flame graph "
+         "tools"
+      << std::endl
+      << "  -call-graph-report FILE" << std::endl
+      << "                        Write cycles per emulated function to FILE, with and without"
+      << std::endl
+      << "                        callees" << std::endl
+      << "  -symbols FILE         Name functions in call graphs after symbols in FILE, as"
+      << std::endl
+      << "                        written by veesem_assembler -symbols" << std::endl
+      << "  -timing FILE          Write host time per frame spent in each component to FILE "
+         "as JSON"
+      << std::endl
+      << "  -access-stats FILE    Write bus accesses per register and memory region to FILE as "
+         "CSV"
+      << std::endl
+      << "  -dump-picture LIST    Write picture after the comma-separated frames in LIST"
+      << std::endl
+      << "  -dump-ram LIST        Write RAM after the comma-separated frames in LIST" << std::endl
+      << "  -raw                  Write pictures as raw 16-bit RGB555 instead of PNG"
+      << std::endl
+      << "  -out DIR              Write pictures and RAM to DIR (default current directory)"
+      << std::endl
+      << std::endl
+      << "Batch mode:" << std::endl
+      << "  -batch FILE       Run the jobs listed in manifest FILE in parallel. Each line holds"
+      << std::endl
+      << "                    the options of one run as above, and optionally -name NAME."
+      << std::endl
+      << "  -jobs N           Run N jobs at a time (default number of CPU threads)" << std::endl
+      << "  -out DIR          Write output of each job to a directory named after it in DIR,"
+      << std::endl
+      << "                    and a summary to DIR/results.tsv (default batch_output)"
+      << std::endl
+      << std::endl
+      << "  -help             Print this help text" << std::endl;
+}
+
+template <typename T>
+bool ParseNumber(std::string_view str, T& value) {
+  auto [ptr, error] = std::from_chars(str.data(), str.data() + str.size(), value);
+  return ptr == str.data() + str.size() && error == std::errc();
+}
+
+void PrintResult(const HeadlessResult& result) {
+  const double fps = result.frames / result.seconds;
+  std::cout << std::fixed << std::setprecision(1) << "Ran " << result.frames << " frames in "
+            << result.seconds << " s, " << fps << " FPS ("
+            << fps / result.emulated_frame_rate * 100 << "% of real time)" << std::endl
+            << "State hash: " << std::hex << std::setw(16) << std::setfill('0')
+            << result.state_hash << std::dec << std::setfill(' ') << std::endl;
+}
+
+int RunBatchMode(const std::string& manifest_path, const std::string& output_dir,
+                 unsigned threads) {
+  std::vector<BatchJob> jobs;
+  auto error = LoadBatchManifest(manifest_path, output_dir, jobs);
+  if (error.has_value()) {
+    std::cerr << "Batch error: " << *error << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  size_t done = 0;
+  size_t failed = 0;
+  const auto start = std::chrono::steady_clock::now();
+  const auto results =
+      RunBatch(jobs, threads, [&](const BatchJob& job, const BatchJobResult& result) {
+        done++;
+        std::cout << "[" << done << "/" << jobs.size() << "] " << job.name << ": ";
+        if (result.error.has_value()) {
+          failed++;
+          std::cout << *result.error << std::endl;
+        } else if (result.result.golden_mismatch.has_value()) {
+          failed++;
+          std::cout << *result.result.golden_mismatch << std::endl;
+        } else {
+          std::cout << result.result.frames << " frames, " << std::fixed << std::setprecision(1)
+                    << result.result.frames / result.result.seconds << " FPS" << std::endl;
+        }
+      });
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  uint64_t total_frames = 0;
+  for (const auto& result : results) {
+    total_frames += result.result.frames;
+  }
+  std::cout << std::fixed << std::setprecision(1) << "Ran " << jobs.size() << " jobs on "
+            << threads << " threads in " << seconds << " s, " << total_frames / seconds
+            << " FPS in total, " << failed << " failed" << std::endl;
+
+  const std::string results_path = (std::filesystem::path(output_dir) / "results.tsv").string();
+  std::error_code fs_error;
+  std::filesystem::create_directories(output_dir, fs_error);
+  if (!WriteBatchResults(results_path, jobs, results)) {
+    std::cerr << "Batch error: Could not write " << results_path << std::endl;
+    return EXIT_FAILURE;
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::vector<std::string_view> args(argv + 1, argv + argc);
+
+  std::optional<std::string> batch_path;
+  std::string batch_output_dir = "batch_output";
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  for (size_t i = 0; i < args.size(); i++) {
+    if (args[i] == "-help" || args[i] == "--help") {
+      PrintUsage(argv[0]);
+      return EXIT_SUCCESS;
+    }
+    if (args[i] == "-batch" && i + 1 < args.size())
+      batch_path = args[i + 1];
+  }
+
+  if (batch_path.has_value()) {
+    for (size_t i = 0; i < args.size(); i += 2) {
+      const bool valid = i + 1 < args.size() &&
+                         (args[i] == "-batch" || args[i] == "-out" ||
+                          (args[i] == "-jobs" && ParseNumber(args[i + 1], threads) && threads));
+      if (!valid) {
+        std::cerr << "Argument error: Only -out and -jobs can be used with -batch" << std::endl;
+        return EXIT_FAILURE;
+      }
+      if (args[i] == "-out")
+        batch_output_dir = args[i + 1];
+    }
+    return RunBatchMode(*batch_path, batch_output_dir, threads);
+  }
+
+  HeadlessOptions options;
+  auto error = ParseHeadlessArgs(args, options);
+  if (error.has_value()) {
+    std::cerr << "Argument error: " << *error << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  HeadlessResult result;
+  error = RunHeadless(options, result);
+  if (error.has_value()) {
+    std::cerr << "Error: " << *error << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  PrintResult(result);
+  if (result.golden_mismatch.has_value()) {
+    std::cerr << "Golden mismatch: " << *result.golden_mismatch << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (options.golden_path.has_value())
+    std::cout << "All frames match golden hashes" << std::endl;
+  if (options.until_memory.has_value() && !result.until_memory_reached) {
+    std::cerr << "Memory condition not reached" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,159 @@
+#include "output_files.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+namespace {
+void WriteBe32(std::vector<uint8_t>& out, uint32_t value) {
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    out.push_back(value >> shift);
+  }
+}
+
+void WriteLe(std::vector<uint8_t>& out, uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    out.push_back(value >> (i * 8));
+  }
+}
+
+uint32_t Crc32(std::span<const uint8_t> data) {
+  static const auto table = [] {
+    std::array<uint32_t, 256> table;
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+      }
+      table[i] = c;
+    }
+    return table;
+  }();
+
+  uint32_t crc = 0xffffffff;
+  for (uint8_t byte : data) {
+    crc = table[(crc ^ byte) & 0xff] ^ (crc >> 8);
+  }
+  return crc ^ 0xffffffff;
+}
+
+uint32_t Adler32(std::span<const uint8_t> data) {
+  uint32_t a = 1;
+  uint32_t b = 0;
+  for (uint8_t byte : data) {
+    a = (a + byte) % 65521;
+    b = (b + a) % 65521;
+  }
+  return (b << 16) | a;
+}
+
+void WriteChunk(std::vector<uint8_t>& out, const char* type, std::span<const uint8_t> data) {
+  WriteBe32(out, data.size());
+  const size_t start = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data.begin(), data.end());
+  WriteBe32(out, Crc32(std::span(out).subspan(start)));
+}
+}  // namespace
+
+bool WritePng(const std::string& path, std::span<const uint8_t> picture, int width, int height) {
+  // Each row starts with the filter type, which is always none
+  std::vector<uint8_t> raw;
+  raw.reserve(height * (width * 3 + 1));
+  for (int y = 0; y < height; y++) {
+    raw.push_back(0);
+    for (int x = 0; x < width; x++) {
+      const size_t offset = (y * width + x) * 2;
+      uint16_t color;
+      std::memcpy(&color, &picture[offset], sizeof color);
+      for (int shift : {10, 5, 0}) {
+        const uint8_t c = (color >> shift) & 0x1f;
+        raw.push_back((c << 3) | (c >> 2));
+      }
+    }
+  }
+
+  // zlib stream of stored deflate blocks
+  std::vector<uint8_t> idat = {0x78, 0x01};
+  for (size_t pos = 0; pos < raw.size(); pos += 0xffff) {
+    const size_t size = std::min<size_t>(raw.size() - pos, 0xffff);
+    idat.push_back(pos + size == raw.size());
+    WriteLe(idat, size, 2);
+    WriteLe(idat, ~size & 0xffff, 2);
+    idat.insert(idat.end(), raw.begin() + pos, raw.begin() + pos + size);
+  }
+  WriteBe32(idat, Adler32(raw));
+
+  std::vector<uint8_t> header;
+  WriteBe32(header, width);
+  WriteBe32(header, height);
+  header.insert(header.end(), {8, 2, 0, 0, 0});  // 8-bit RGB, no interlacing
+
+  std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  WriteChunk(png, "IHDR", header);
+  WriteChunk(png, "IDAT", idat);
+  WriteChunk(png, "IEND", {});
+
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  if (!file)
+    return false;
+  const bool ok = std::fwrite(png.data(), 1, png.size(), file) == png.size();
+  return std::fclose(file) == 0 && ok;
+}
+
+WavWriter::~WavWriter() {
+  Close();
+}
+
+bool WavWriter::Open(const std::string& path, int sample_rate) {
+  Close();
+  file_ = std::fopen(path.c_str(), "wb");
+  if (!file_)
+    return false;
+  data_size_ = 0;
+  error_ = false;
+
+  std::vector<uint8_t> header;
+  header.insert(header.end(), {'R', 'I', 'F', 'F'});
+  WriteLe(header, 0, 4);  // Filled in when closed
+  header.insert(header.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+  WriteLe(header, 16, 4);
+  WriteLe(header, 1, 2);  // PCM
+  WriteLe(header, 2, 2);
+  WriteLe(header, sample_rate, 4);
+  WriteLe(header, sample_rate * 4, 4);
+  WriteLe(header, 4, 2);
+  WriteLe(header, 16, 2);
+  header.insert(header.end(), {'d', 'a', 't', 'a'});
+  WriteLe(header, 0, 4);  // Filled in when closed
+  error_ |= std::fwrite(header.data(), 1, header.size(), file_) != header.size();
+  return !error_;
+}
+
+void WavWriter::Write(std::span<const uint16_t> samples) {
+  if (!file_)
+    return;
+  std::vector<uint8_t> data;
+  data.reserve(samples.size() * 2);
+  for (uint16_t sample : samples) {
+    WriteLe(data, sample ^ 0x8000, 2);
+  }
+  error_ |= std::fwrite(data.data(), 1, data.size(), file_) != data.size();
+  data_size_ += data.size();
+}
+
+bool WavWriter::Close() {
+  if (!file_)
+    return !error_;
+
+  std::vector<uint8_t> size;
+  WriteLe(size, data_size_ + 36, 4);
+  error_ |= std::fseek(file_, 4, SEEK_SET) != 0 || std::fwrite(size.data(), 1, 4, file_) != 4;
+  size.clear();
+  WriteLe(size, data_size_, 4);
+  error_ |= std::fseek(file_, 40, SEEK_SET) != 0 || std::fwrite(size.data(), 1, 4, file_) != 4;
+  error_ |= std::fclose(file_) != 0;
+  file_ = nullptr;
+  return !error_;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <string>
+
+// Writes a picture in the framebuffer format of the PPU as 24-bit PNG image. The image data is
+// stored uncompressed, so that no compression library is needed.
+bool WritePng(const std::string& path, std::span<const uint8_t> picture, int width, int height);
+
+// Writes 16-bit stereo WAV files from unsigned samples as returned by VSmile::GetAudio
+class WavWriter {
+public:
+  WavWriter() = default;
+  WavWriter(const WavWriter&) = delete;
+  WavWriter& operator=(const WavWriter&) = delete;
+  ~WavWriter();
+
+  bool Open(const std::string& path, int sample_rate);
+  void Write(std::span<const uint16_t> samples);
+  // Fills in the data size in the header, returns false if any write failed
+  bool Close();
+
+private:
+  std::FILE* file_ = nullptr;
+  uint32_t data_size_ = 0;
+  bool error_ = false;
+};
@@ -0,0 +1,109 @@
+#include "thread_pool.h"
+
+#include <utility>
+
+ThreadPool::ThreadPool(unsigned threads) {
+  if (threads == 0)
+    threads = 1;
+  for (unsigned i = 0; i < threads; i++) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (unsigned i = 0; i < threads; i++) {
+    threads_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  task_available_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  unsigned index;
+  {
+    std::lock_guard lock(mutex_);
+    index = next_queue_;
+    next_queue_ = (next_queue_ + 1) % queues_.size();
+  }
+  {
+    auto& queue = *queues_[index];
+    std::lock_guard queue_lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard lock(mutex_);
+    queued_++;
+    unfinished_++;
+  }
+  task_available_.notify_one();
+}
+
+void ThreadPool::Wait() {
+  std::unique_lock lock(mutex_);
+  all_done_.wait(lock, [this] { return unfinished_ == 0; });
+  if (exception_)
+    std::rethrow_exception(std::exchange(exception_, nullptr));
+}
+
+unsigned ThreadPool::GetThreadCount() const {
+  return threads_.size();
+}
+
+void ThreadPool::WorkerLoop(unsigned index) {
+  while (true) {
+    {
+      std::unique_lock lock(mutex_);
+      task_available_.wait(lock, [this] { return queued_ > 0 || stopping_; });
+      if (queued_ == 0)
+        return;
+      // Claim one task, which one of the queues is then guaranteed to hold
+      queued_--;
+    }
+
+    std::function<void()> task;
+    while (!PopTask(index, task)) {
+      std::this_thread::yield();
+    }
+    std::exception_ptr exception;
+    try {
+      task();
+    } catch (...) {
+      exception = std::current_exception();
+    }
+
+    std::lock_guard lock(mutex_);
+    if (exception && !exception_)
+      exception_ = exception;
+    if (--unfinished_ == 0)
+      all_done_.notify_all();
+  }
+}
+
+bool ThreadPool::PopTask(unsigned index, std::function<void()>& task) {
+  // Newest task of the own queue first, then steal the oldest from the others
+  {
+    auto& queue = *queues_[index];
+    std::lock_guard lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+      return true;
+    }
+  }
+  for (size_t i = 1; i < queues_.size(); i++) {
+    auto& queue = *queues_[(index + i) % queues_.size()];
+    std::lock_guard lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
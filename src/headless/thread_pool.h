@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs tasks on a fixed number of threads. Each thread has its own queue, and threads that run
+// out of tasks take them from the other end of the queues of other threads, so that long and
+// short tasks even out without a single contended queue.
+class ThreadPool {
+public:
+  explicit ThreadPool(unsigned threads);
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ~ThreadPool();
+
+  void Submit(std::function<void()> task);
+  // Waits until all submitted tasks have finished, then rethrows the first exception thrown by
+  // any of them
+  void Wait();
+
+  unsigned GetThreadCount() const;
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void WorkerLoop(unsigned index);
+  bool PopTask(unsigned index, std::function<void()>& task);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  unsigned next_queue_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable task_available_;
+  std::condition_variable all_done_;
+  size_t queued_ = 0;
+  size_t unfinished_ = 0;
+  bool stopping_ = false;
+  std::exception_ptr exception_;
+};
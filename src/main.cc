@@ -7,7 +7,7 @@
 
 #include "core/spg200/types.h"
 #include "ui/ui.h"
-#include "ui/version.h"
+#include "version.h"
 
 void PrintUsage(std::string exec_name) {
   std::cout
@@ -34,6 +34,29 @@ void PrintUsage(std::string exec_name) {
       << std::endl
       << "  -allow-bg-input   Allow gamepad input when window is backgrounded" << std::endl
       << std::endl
+      << "  -audio-rate HZ    Set audio output sample rate (default 48000)" << std::endl
+      << "  -audio-quality Q  Set audio resampling quality: linear, medium or high (default)"
+      << std::endl
+      << "  -rewind MB        Set rewind buffer size in megabytes, 0 to disable (default 64)"
+      << std::endl
+      << "  -runahead N       Emulate N frames ahead to reduce input latency (0-4, default 0)"
+      << std::endl
+      << std::endl
+      << "  -record-movie FILE  Record input from power-on to movie FILE" << std::endl
+      << "  -play-movie FILE    Replay input from movie FILE" << std::endl
+      << std::endl
+      << "  -state-hash-log FILE    Write machine state hashes of every frame to FILE" << std::endl
+      << "  -state-hash-interval N  Also write state hashes every N instructions" << std::endl
+      << std::endl
+      << "  -netplay HOST:PORT  Play with a second player on the peer at HOST:PORT" << std::endl
+      << "  -netplay-port PORT  Set local netplay UDP port (default 7845)" << std::endl
+      << "  -netplay-player N   Set controller played locally, 1 or 2 (default 1)" << std::endl
+      << "  -netplay-delay N    Set frames of netplay input delay (0-8, default 1)" << std::endl
+      << std::endl
+      << "  -boot-cache DIR     Store states for skipping the system ROM intro in DIR" << std::endl
+      << "  -no-boot-cache      Always run the system ROM intro" << std::endl
+      << "  -refresh-boot-cache Run the system ROM intro and save its state again" << std::endl
+      << std::endl
       << "  -help             Print this help text" << std::endl;
 }
 
@@ -49,6 +72,16 @@ int main(int argc, char** argv) {
   ui_config.show_leds = false;
   ui_config.show_fps = false;
   ui_config.allow_background_input = false;
+  ui_config.audio_sample_rate = 48000;
+  ui_config.audio_quality = Resampler::Quality::HIGH;
+  ui_config.rewind_buffer_size = 64 * 1024 * 1024;
+  ui_config.run_ahead_frames = 0;
+  ui_config.state_hash_interval = 0;
+  ui_config.netplay_port = 7845;
+  ui_config.netplay_player = 1;
+  ui_config.netplay_input_delay = 1;
+  ui_config.use_boot_cache = true;
+  ui_config.refresh_boot_cache = false;
 
   bool read_flags = true;
   const std::vector<std::string_view> args(argv + 1, argv + argc);
@@ -109,6 +142,159 @@ int main(int argc, char** argv) {
         ui_config.show_fps = true;
       } else if (arg == "-allow-bg-input") {
         ui_config.allow_background_input = true;
+      } else if (arg == "-audio-rate") {
+        if (argpos + 1 >= args.size()) {
+          std::cerr << "Argument error: Expected audio sample rate" << std::endl;
+          return EXIT_FAILURE;
+        }
+        const auto& num_str = args[++argpos];
+
+        auto [ptr, error] = std::from_chars(num_str.data(), num_str.data() + num_str.size(),
+                                            ui_config.audio_sample_rate);
+
+        if (ptr != (num_str.data() + num_str.size()) || error != std::errc() ||
+            ui_config.audio_sample_rate < 8000 || ui_config.audio_sample_rate > 192000) {
+          std::cerr << "Argument error: Audio sample rate should be in range 8000-192000"
+                    << std::endl;
+          return EXIT_FAILURE;
+        }
+      } else if (arg == "-audio-quality") {
+        if (argpos + 1 >= args.size()) {
+          std::cerr << "Argument error: Expected audio quality" << std::endl;
+          return EXIT_FAILURE;
+        }
+        const auto& quality = args[++argpos];
+        if (quality == "linear") {
+          ui_config.audio_quality = Resampler::Quality::LINEAR;
+        } else if (quality == "medium") {
+          ui_config.audio_quality = Resampler::Quality::MEDIUM;
+        } else if (quality == "high") {
+          ui_config.audio_quality = Resampler::Quality::HIGH;
+        } else {
+          std::cerr << "Argument error: Unknown audio quality " << quality << std::endl;
+          return EXIT_FAILURE;
+        }
+      } else if (arg == "-rewind") {
+        if (argpos + 1 >= args.size()) {
+          std::cerr << "Argument error: Expected rewind buffer size" << std::endl;
+          return EXIT_FAILURE;
+        }
+        const auto& num_str = args[++argpos];
+
+        unsigned size_mb;
+        auto [ptr, error] =
+            std::from_chars(num_str.data(), num_str.data() + num_str.size(), size_mb);
+
+        if (ptr != (num_str.data() + num_str.size()) || error != std::errc() || size_mb > 4096) {
+          std::cerr << "Argument error: Rewind buffer size should be in range 0-4096" << std::endl;
+          return EXIT_FAILURE;
+        }
+        ui_config.rewind_buffer_size = static_cast<size_t>(size_mb) * 1024 * 1024;
+      } else if (arg == "-runahead") {
+        if (argpos + 1 >= args.size()) {
+          std::cerr << "Argument error: Expected number of run-ahead frames" << std::endl;
+          return EXIT_FAILURE;
+        }
+        const auto& num_str = args[++argpos];
+
+        auto [ptr, error] = std::from_chars(num_str.data(), num_str.data() + num_str.size(),
+                                            ui_config.run_ahead_frames);
+
+        if (ptr != (num_str.data() + num_str.size()) || error != std::errc() ||
+            ui_config.run_ahead_frames < 0 || ui_config.run_ahead_frames > 4) {
+          std::cerr << "Argument error: Run-ahead frames should be in range 0-4" << std::endl;
+          return EXIT_FAILURE;
+        }
+      } else if (arg == "-record-movie" || arg == "-play-movie") {
+        if (argpos + 1 >= args.size()) {
+          std::cerr << "Argument error: Expected movie path" << std::endl;
+          return EXIT_FAILURE;
+        }
+        if (arg == "-record-movie") {
+          ui_config.record_movie_path = args[++argpos];
+        } else {
+          ui_config.play_movie_path = args[++argpos];
+        }
+      } else if (arg == "-state-hash-log") {
+        if (argpos + 1 >= args.size()) {
+          std::cerr << "Argument error: Expected state hash log path" << std::endl;
+          return EXIT_FAILURE;
+        }
+        ui_config.state_hash_log_path = args[++argpos];
+      } else if (arg == "-state-hash-interval") {
+        if (argpos + 1 >= args.size()) {
+          std::cerr << "Argument error: Expected state hash interval" << std::endl;
+          return EXIT_FAILURE;
+        }
+        const auto& num_str = args[++argpos];
+
+        auto [ptr, error] = std::from_chars(num_str.data(), num_str.data() + num_str.size(),
+                                            ui_config.state_hash_interval);
+
+        if (ptr != (num_str.data() + num_str.size()) || error != std::errc()) {
+          std::cerr << "Argument error: Invalid state hash interval" << std::endl;
+          return EXIT_FAILURE;
+        }
+      } else if (arg == "-netplay") {
+        if (argpos + 1 >= args.size()) {
+          std::cerr << "Argument error: Expected netplay peer address" << std::endl;
+          return EXIT_FAILURE;
+        }
+        ui_config.netplay_peer = args[++argpos];
+      } else if (arg == "-netplay-port") {
+        if (argpos + 1 >= args.size()) {
+          std::cerr << "Argument error: Expected netplay port" << std::endl;
+          return EXIT_FAILURE;
+        }
+        const auto& num_str = args[++argpos];
+
+        auto [ptr, error] = std::from_chars(num_str.data(), num_str.data() + num_str.size(),
+                                            ui_config.netplay_port);
+
+        if (ptr != (num_str.data() + num_str.size()) || error != std::errc()) {
+          std::cerr << "Argument error: Netplay port should be in range 0-65535" << std::endl;
+          return EXIT_FAILURE;
+        }
+      } else if (arg == "-netplay-player") {
+        if (argpos + 1 >= args.size()) {
+          std::cerr << "Argument error: Expected netplay player" << std::endl;
+          return EXIT_FAILURE;
+        }
+        const auto& num_str = args[++argpos];
+
+        auto [ptr, error] = std::from_chars(num_str.data(), num_str.data() + num_str.size(),
+                                            ui_config.netplay_player);
+
+        if (ptr != (num_str.data() + num_str.size()) || error != std::errc() ||
+            ui_config.netplay_player < 1 || ui_config.netplay_player > 2) {
+          std::cerr << "Argument error: Netplay player should be 1 or 2" << std::endl;
+          return EXIT_FAILURE;
+        }
+      } else if (arg == "-netplay-delay") {
+        if (argpos + 1 >= args.size()) {
+          std::cerr << "Argument error: Expected netplay input delay" << std::endl;
+          return EXIT_FAILURE;
+        }
+        const auto& num_str = args[++argpos];
+
+        auto [ptr, error] = std::from_chars(num_str.data(), num_str.data() + num_str.size(),
+                                            ui_config.netplay_input_delay);
+
+        if (ptr != (num_str.data() + num_str.size()) || error != std::errc() ||
+            ui_config.netplay_input_delay < 0 || ui_config.netplay_input_delay > 8) {
+          std::cerr << "Argument error: Netplay input delay should be in range 0-8" << std::endl;
+          return EXIT_FAILURE;
+        }
+      } else if (arg == "-boot-cache") {
+        if (argpos + 1 >= args.size()) {
+          std::cerr << "Argument error: Expected boot cache directory" << std::endl;
+          return EXIT_FAILURE;
+        }
+        ui_config.boot_cache_dir = args[++argpos];
+      } else if (arg == "-no-boot-cache") {
+        ui_config.use_boot_cache = false;
+      } else if (arg == "-refresh-boot-cache") {
+        ui_config.refresh_boot_cache = true;
       } else if (arg == "--") {
         read_flags = false;
       } else {
@@ -127,5 +313,22 @@ int main(int argc, char** argv) {
     argpos++;
   }
 
-  return RunEmulation(system_config, ui_config);
+  if (ui_config.record_movie_path.has_value() && ui_config.play_movie_path.has_value()) {
+    std::cerr << "Argument error: Cannot record and play a movie at the same time" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (ui_config.netplay_peer.has_value() &&
+      (ui_config.record_movie_path.has_value() || ui_config.play_movie_path.has_value() ||
+       ui_config.state_hash_log_path.has_value())) {
+    std::cerr << "Argument error: Movies and state hash logs cannot be used with netplay"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try {
+    return RunEmulation(system_config, ui_config);
+  } catch (const EmulationError& error) {
+    std::cerr << "Emulation error: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+  }
 }
@@ -0,0 +1,38 @@
+#include "impaired_transport.h"
+
+#include <algorithm>
+
+ImpairedTransport::ImpairedTransport(NetplayTransport& transport, const Settings& settings)
+    : transport_(transport), settings_(settings), rng_(settings.seed) {}
+
+void ImpairedTransport::Send(std::span<const uint8_t> packet) {
+  Flush();
+  if (std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < settings_.loss)
+    return;
+
+  int delay_ms = settings_.latency_ms;
+  if (settings_.jitter_ms > 0)
+    delay_ms += std::uniform_int_distribution<int>(0, settings_.jitter_ms)(rng_);
+
+  // Kept sorted by send time, so that jittered packets can overtake earlier ones
+  DelayedPacket delayed = {Clock::now() + std::chrono::milliseconds(delay_ms),
+                           std::vector<uint8_t>(packet.begin(), packet.end())};
+  auto pos = std::upper_bound(
+      delayed_.begin(), delayed_.end(), delayed.send_time,
+      [](Clock::time_point time, const DelayedPacket& p) { return time < p.send_time; });
+  delayed_.insert(pos, std::move(delayed));
+  Flush();
+}
+
+bool ImpairedTransport::Receive(std::vector<uint8_t>& packet) {
+  Flush();
+  return transport_.Receive(packet);
+}
+
+void ImpairedTransport::Flush() {
+  const auto now = Clock::now();
+  while (!delayed_.empty() && delayed_.front().send_time <= now) {
+    transport_.Send(delayed_.front().data);
+    delayed_.pop_front();
+  }
+}
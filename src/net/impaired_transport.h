@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "core/netplay/netplay_transport.h"
+
+// Wraps a transport to simulate a bad network connection, delaying sent packets by a latency
+// with random jitter and dropping a fraction of them. Jitter can reorder packets.
+class ImpairedTransport : public NetplayTransport {
+public:
+  struct Settings {
+    int latency_ms = 0;
+    int jitter_ms = 0;
+    double loss = 0.0;
+    uint32_t seed = 1;
+  };
+
+  ImpairedTransport(NetplayTransport& transport, const Settings& settings);
+
+  void Send(std::span<const uint8_t> packet) override;
+  bool Receive(std::vector<uint8_t>& packet) override;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct DelayedPacket {
+    Clock::time_point send_time;
+    std::vector<uint8_t> data;
+  };
+
+  void Flush();
+
+  NetplayTransport& transport_;
+  const Settings settings_;
+  std::mt19937 rng_;
+  std::deque<DelayedPacket> delayed_;
+};
@@ -0,0 +1,152 @@
+#include "udp_transport.h"
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+void CloseSocket(SOCKET socket) {
+  closesocket(socket);
+}
+
+bool SetNonBlocking(SOCKET socket) {
+  u_long mode = 1;
+  return ioctlsocket(socket, FIONBIO, &mode) == 0;
+}
+#else
+void CloseSocket(int socket) {
+  close(socket);
+}
+
+bool SetNonBlocking(int socket) {
+  const int flags = fcntl(socket, F_GETFL, 0);
+  return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+#endif
+
+bool SameAddress(const sockaddr_storage& a, const sockaddr_storage& b) {
+  if (a.ss_family != b.ss_family)
+    return false;
+  if (a.ss_family == AF_INET) {
+    auto& a4 = reinterpret_cast<const sockaddr_in&>(a);
+    auto& b4 = reinterpret_cast<const sockaddr_in&>(b);
+    return a4.sin_port == b4.sin_port && a4.sin_addr.s_addr == b4.sin_addr.s_addr;
+  }
+  if (a.ss_family == AF_INET6) {
+    auto& a6 = reinterpret_cast<const sockaddr_in6&>(a);
+    auto& b6 = reinterpret_cast<const sockaddr_in6&>(b);
+    return a6.sin6_port == b6.sin6_port &&
+           std::memcmp(&a6.sin6_addr, &b6.sin6_addr, sizeof a6.sin6_addr) == 0;
+  }
+  return false;
+}
+}  // namespace
+
+UdpTransport::UdpTransport() {
+#ifdef _WIN32
+  WSADATA wsa_data;
+  WSAStartup(MAKEWORD(2, 2), &wsa_data);
+#endif
+}
+
+UdpTransport::~UdpTransport() {
+  Close();
+#ifdef _WIN32
+  WSACleanup();
+#endif
+}
+
+std::optional<std::string> UdpTransport::Open(uint16_t local_port, const std::string& peer) {
+  Close();
+
+  // Split at the last colon, so that IPv6 addresses in brackets can be used
+  const size_t colon = peer.rfind(':');
+  if (colon == std::string::npos || colon == 0 || colon == peer.size() - 1)
+    return "Peer address should be given as host:port";
+  std::string host = peer.substr(0, colon);
+  const std::string port = peer.substr(colon + 1);
+  if (host.size() > 2 && host.front() == '[' && host.back() == ']')
+    host = host.substr(1, host.size() - 2);
+
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+  addrinfo* result = nullptr;
+  if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0 || !result)
+    return "Could not resolve peer address";
+  std::memcpy(&peer_addr_, result->ai_addr, result->ai_addrlen);
+  peer_addr_len_ = result->ai_addrlen;
+  freeaddrinfo(result);
+
+  socket_ = socket(peer_addr_.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+  if (socket_ == InvalidSocket)
+    return "Could not create socket";
+
+  sockaddr_storage local_addr = {};
+  socklen_t local_addr_len;
+  if (peer_addr_.ss_family == AF_INET6) {
+    auto& addr = reinterpret_cast<sockaddr_in6&>(local_addr);
+    addr.sin6_family = AF_INET6;
+    addr.sin6_addr = in6addr_any;
+    addr.sin6_port = htons(local_port);
+    local_addr_len = sizeof addr;
+  } else {
+    auto& addr = reinterpret_cast<sockaddr_in&>(local_addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(local_port);
+    local_addr_len = sizeof addr;
+  }
+
+  if (bind(socket_, reinterpret_cast<sockaddr*>(&local_addr), local_addr_len) != 0) {
+    Close();
+    return "Could not bind to local port";
+  }
+  if (!SetNonBlocking(socket_)) {
+    Close();
+    return "Could not make socket non-blocking";
+  }
+  return std::nullopt;
+}
+
+void UdpTransport::Close() {
+  if (socket_ == InvalidSocket)
+    return;
+  CloseSocket(socket_);
+  socket_ = InvalidSocket;
+}
+
+void UdpTransport::Send(std::span<const uint8_t> packet) {
+  if (socket_ == InvalidSocket)
+    return;
+  // Failures are treated like packet loss
+  sendto(socket_, reinterpret_cast<const char*>(packet.data()), packet.size(), 0,
+         reinterpret_cast<const sockaddr*>(&peer_addr_), peer_addr_len_);
+}
+
+bool UdpTransport::Receive(std::vector<uint8_t>& packet) {
+  if (socket_ == InvalidSocket)
+    return false;
+
+  while (true) {
+    packet.resize(1500);
+    sockaddr_storage from = {};
+    socklen_t from_len = sizeof from;
+    const auto size = recvfrom(socket_, reinterpret_cast<char*>(packet.data()), packet.size(), 0,
+                               reinterpret_cast<sockaddr*>(&from), &from_len);
+    // Errors are also returned for ICMP unreachable messages while the peer is not yet
+    // listening, and are treated the same as no packet
+    if (size < 0)
+      return false;
+    if (!SameAddress(from, peer_addr_))
+      continue;
+    packet.resize(size);
+    return true;
+  }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#endif
+
+#include "core/netplay/netplay_transport.h"
+
+// Non-blocking UDP socket exchanging packets with a single peer. Packets from other addresses
+// are dropped.
+class UdpTransport : public NetplayTransport {
+public:
+  UdpTransport();
+  UdpTransport(const UdpTransport&) = delete;
+  UdpTransport& operator=(const UdpTransport&) = delete;
+  ~UdpTransport() override;
+
+  // Binds to the local port and resolves the peer, which is given as host:port
+  std::optional<std::string> Open(uint16_t local_port, const std::string& peer);
+  void Close();
+
+  void Send(std::span<const uint8_t> packet) override;
+  bool Receive(std::vector<uint8_t>& packet) override;
+
+private:
+#ifdef _WIN32
+  using Socket = SOCKET;
+  static constexpr Socket InvalidSocket = INVALID_SOCKET;
+#else
+  using Socket = int;
+  static constexpr Socket InvalidSocket = -1;
+#endif
+
+  Socket socket_ = InvalidSocket;
+  sockaddr_storage peer_addr_ = {};
+  socklen_t peer_addr_len_ = 0;
+};
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "asm/unsp_assembler.h"
+#include "core/vsmile/vsmile.h"
+
+// Assembles a source file into a cartridge ROM image that can be loaded like a dumped cartridge,
+// with the reset vector at 0xfff7 pointing to the entry point given by the source
+
+namespace {
+
+void PrintUsage(std::string exec_name) {
+  std::cerr << "Usage: " << exec_name << " [options] SOURCE" << std::endl
+            << std::endl
+            << "  -o FILE         Write cartridge ROM image to FILE (default out.bin)" << std::endl
+            << "  -symbols FILE   Write address and name of every symbol to FILE" << std::endl;
+}
+
+std::optional<std::string> WriteImage(const std::string& path, const VSmile::CartRomType& rom) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file.good())
+    return "Failed to open output file for writing";
+
+  std::vector<uint8_t> bytes(sizeof(VSmile::CartRomType));
+  for (size_t i = 0; i < rom.size(); i++) {
+    bytes[i * 2] = rom[i] & 0xff;
+    bytes[i * 2 + 1] = rom[i] >> 8;
+  }
+  file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  if (file.fail())
+    return "Failed to write to output file";
+  return {};
+}
+
+// One symbol per line as a hex value and name, sorted by value
+std::optional<std::string> WriteSymbols(const std::string& path,
+                                        const std::map<std::string, int64_t>& symbols) {
+  std::ofstream file(path, std::ios::trunc);
+  if (!file.good())
+    return "Failed to open symbol file for writing";
+
+  std::vector<std::pair<int64_t, std::string>> sorted;
+  for (const auto& [name, value] : symbols) {
+    sorted.emplace_back(value, name);
+  }
+  std::sort(sorted.begin(), sorted.end());
+
+  for (const auto& [value, name] : sorted) {
+    file << std::hex << std::setw(6) << std::setfill('0') << value << " " << name << "\n";
+  }
+  if (file.fail())
+    return "Failed to write to symbol file";
+  return {};
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::optional<std::string> source_path;
+  std::string output_path = "out.bin";
+  std::optional<std::string> symbols_path;
+
+  const std::vector<std::string_view> args(argv + 1, argv + argc);
+  for (size_t i = 0; i < args.size(); i++) {
+    const auto& arg = args[i];
+    const bool has_value = i + 1 < args.size();
+    if (arg == "-o" && has_value) {
+      output_path = args[++i];
+    } else if (arg == "-symbols" && has_value) {
+      symbols_path = args[++i];
+    } else if (arg[0] != '-' && !source_path.has_value()) {
+      source_path = arg;
+    } else {
+      PrintUsage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (!source_path.has_value()) {
+    PrintUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::ifstream file(*source_path);
+  if (!file.good()) {
+    std::cerr << "Could not open source file" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::stringstream source;
+  source << file.rdbuf();
+
+  auto rom = std::make_unique<VSmile::CartRomType>();
+  UnspAssembler assembler;
+  if (auto error = assembler.Assemble(source.str(), *rom); error.has_value()) {
+    std::cerr << *source_path << ": " << *error << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (auto error = WriteImage(output_path, *rom); error.has_value()) {
+    std::cerr << *error << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (symbols_path.has_value()) {
+    if (auto error = WriteSymbols(*symbols_path, assembler.GetSymbols()); error.has_value()) {
+      std::cerr << *error << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
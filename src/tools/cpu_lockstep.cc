@@ -0,0 +1,374 @@
+#include <algorithm>
+#include <bitset>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "asm/unsp_assembler.h"
+#include "asm/unsp_disassembler.h"
+#include "core/serializer.h"
+#include "core/spg200/bus_interface.h"
+#include "core/spg200/cpu.h"
+#include "core/vsmile/vsmile_loader.h"
+
+// Runs the reference CPU and a candidate implementation in lockstep on separate copies of the
+// same flat memory, and compares registers, internal state, cycles and memory writes after every
+// instruction. Either random instruction streams or a cartridge ROM are run, with interrupt
+// lines toggled at random. An optimized CPU is verified by making it the candidate below.
+
+namespace {
+
+using ReferenceCpu = Cpu;
+using CandidateCpu = Cpu;
+
+constexpr Addr kMemoryWords = 0x400000;
+constexpr Addr kFuzzStart = 0x8000;
+constexpr size_t kHistoryLength = 8;
+
+struct Options {
+  std::optional<std::string> cartrom_path;
+  uint32_t seed = 1;
+  uint32_t seeds = 1000;
+  uint64_t steps = 0;
+};
+
+// Plain memory covering the whole address space, which logs the writes of each step. Banks of
+// 64K words are only cleared if they were written to, as most streams touch few of them.
+class RecordingBus : public BusInterface {
+public:
+  RecordingBus() : memory_(kMemoryWords) {}
+
+  Word ReadWord(Addr addr) override {
+    return memory_[addr & (kMemoryWords - 1)];
+  }
+
+  void WriteWord(Addr addr, Word value) override {
+    addr &= kMemoryWords - 1;
+    memory_[addr] = value;
+    dirty_banks_.set(addr >> 16);
+    writes_.emplace_back(addr, value);
+  }
+
+  // Clears all memory and copies the image to the start
+  void Load(std::span<const Word> image) {
+    for (size_t bank = 0; bank < dirty_banks_.size(); bank++) {
+      if (dirty_banks_[bank])
+        std::fill_n(memory_.begin() + (bank << 16), 0x10000, 0);
+    }
+    std::ranges::copy(image, memory_.begin());
+    dirty_banks_.reset();
+    for (size_t bank = 0; (bank << 16) < image.size(); bank++) {
+      dirty_banks_.set(bank);
+    }
+  }
+
+  const std::vector<std::pair<Addr, Word>>& GetWrites() const {
+    return writes_;
+  }
+
+  void ClearWrites() {
+    writes_.clear();
+  }
+
+private:
+  std::vector<Word> memory_;
+  std::bitset<kMemoryWords / 0x10000> dirty_banks_;
+  std::vector<std::pair<Addr, Word>> writes_;
+};
+
+template <typename CpuType>
+struct Lane {
+  RecordingBus bus;
+  CpuType cpu{bus};
+  int cycles = 0;
+  std::optional<std::string> error;
+
+  void Step() {
+    bus.ClearWrites();
+    try {
+      cycles = cpu.Step();
+      error.reset();
+    } catch (const EmulationError& e) {
+      cycles = 0;
+      error = e.what();
+    }
+  }
+
+  std::vector<uint8_t> GetState() {
+    std::vector<uint8_t> state;
+    Serializer s(state);
+    cpu.Serialize(s);
+    return state;
+  }
+};
+
+std::string Format(const char* format, auto... args) {
+  char text[128];
+  std::snprintf(text, sizeof text, format, args...);
+  return text;
+}
+
+// Emulation error without the source location that die() starts it with, which differs between
+// CPU implementations
+std::optional<std::string_view> GetErrorMessage(const std::optional<std::string>& error) {
+  if (!error.has_value())
+    return std::nullopt;
+  const std::string_view message = *error;
+  const size_t location_end = message.find("): ");
+  return location_end == std::string_view::npos ? message : message.substr(location_end + 3);
+}
+
+std::string DescribeInstruction(Addr address, Word word0, Word word1) {
+  const auto instruction = DisassembleInstruction(address, word0, word1);
+  const std::string words = instruction.words == 2 ? Format("%04x %04x", word0, word1)
+                                                   : Format("%04x     ", word0);
+  return Format("%06x  ", address) + words + "  " + instruction.text;
+}
+
+template <typename CpuType>
+std::string DescribeLane(Lane<CpuType>& lane) {
+  const auto& regs = lane.cpu.GetRegisters();
+  std::string text =
+      Format("SP %04x R1 %04x R2 %04x R3 %04x R4 %04x BP %04x SR %04x PC %04x, ", regs[0],
+             regs[1], regs[2], regs[3], regs[4], regs[5], regs[6], regs[7]);
+  if (lane.error.has_value())
+    return text + "error: " + *lane.error;
+
+  text += Format("%d cycles, writes:", lane.cycles);
+  for (const auto& [addr, value] : lane.bus.GetWrites()) {
+    text += Format(" [%06x]=%04x", addr, value);
+  }
+  if (lane.bus.GetWrites().empty())
+    text += " none";
+  return text;
+}
+
+class Lockstep {
+public:
+  // Gives both lanes the same memory, starting with the image, and resets them
+  void Load(std::span<const Word> image) {
+    reference_.bus.Load(image);
+    candidate_.bus.Load(image);
+    reference_.cpu.Reset();
+    candidate_.cpu.Reset();
+    history_.clear();
+  }
+
+  // Runs until the step count, a difference, or the same emulation error in both lanes. Returns
+  // a report of the first difference.
+  std::optional<std::string> Run(uint64_t steps, std::mt19937& rng) {
+    stopped_by_error_ = false;
+    for (steps_run_ = 0; steps_run_ < steps; steps_run_++) {
+      ToggleInterrupts(rng);
+
+      const Addr pc = reference_.cpu.GetCsPc();
+      history_.push_back({pc, reference_.bus.ReadWord(pc), reference_.bus.ReadWord(pc + 1)});
+      if (history_.size() > kHistoryLength)
+        history_.pop_front();
+
+      reference_.Step();
+      candidate_.Step();
+      if (!Matches())
+        return Report();
+      if (reference_.error.has_value()) {
+        stopped_by_error_ = true;
+        steps_run_++;
+        break;
+      }
+    }
+    return {};
+  }
+
+  uint64_t GetStepsRun() const {
+    return steps_run_;
+  }
+
+  // Whether the last run ended with the same emulation error in both lanes
+  bool StoppedByError() const {
+    return stopped_by_error_;
+  }
+
+  const std::optional<std::string>& GetError() const {
+    return reference_.error;
+  }
+
+private:
+  void ToggleInterrupts(std::mt19937& rng) {
+    if (rng() % 256 != 0)
+      return;
+    const int line = rng() % 9;
+    const bool value = rng() % 2;
+    if (line == 8) {
+      reference_.cpu.SetFiq(value);
+      candidate_.cpu.SetFiq(value);
+    } else {
+      reference_.cpu.SetIrq(line, value);
+      candidate_.cpu.SetIrq(line, value);
+    }
+  }
+
+  bool Matches() {
+    return GetErrorMessage(reference_.error) == GetErrorMessage(candidate_.error) &&
+           reference_.cycles == candidate_.cycles &&
+           reference_.bus.GetWrites() == candidate_.bus.GetWrites() &&
+           reference_.GetState() == candidate_.GetState();
+  }
+
+  // The last line of the history is the instruction that gave different results, unless an
+  // interrupt was taken instead of it
+  std::string Report() {
+    std::string report = "Mismatch at step " + std::to_string(steps_run_) + " after:\n";
+    for (const auto& [address, word0, word1] : history_) {
+      report += "  " + DescribeInstruction(address, word0, word1) + "\n";
+    }
+    report += "reference: " + DescribeLane(reference_) + "\n";
+    report += "candidate: " + DescribeLane(candidate_) + "\n";
+    if (reference_.cpu.GetRegisters() == candidate_.cpu.GetRegisters() &&
+        reference_.GetState() != candidate_.GetState())
+      report += "Registers match, but other CPU state differs\n";
+    return report;
+  }
+
+  Lane<ReferenceCpu> reference_;
+  Lane<CandidateCpu> candidate_;
+  // Address and words of the last instructions, disassembled only for a report
+  std::deque<std::tuple<Addr, Word, Word>> history_;
+  uint64_t steps_run_ = 0;
+  bool stopped_by_error_ = false;
+};
+
+// First words of all instructions the CPU executes
+std::vector<Word> GetValidWords() {
+  std::vector<Word> words;
+  for (uint32_t word = 0; word < 0x10000; word++) {
+    if (DisassembleInstruction(0, word, 0).decoded)
+      words.push_back(word);
+  }
+  return words;
+}
+
+// Random instructions filling the first 64K words, with a prologue at the reset address loading
+// random values into all registers before falling through into them. Words that the CPU does not
+// execute are left out, so that streams run longer before hitting an emulation error.
+std::optional<std::string> MakeFuzzImage(std::vector<Word>& image, std::mt19937& rng) {
+  static const std::vector<Word> valid_words = GetValidWords();
+  image.resize(0x10000);
+  for (Word& word : image) {
+    word = valid_words[rng() % valid_words.size()];
+  }
+
+  std::string prologue = Format(".org 0xfff7\n.dw 0x%x\n.org 0x%x\n", kFuzzStart, kFuzzStart);
+  for (const char* reg : {"sp", "r1", "r2", "r3", "r4", "bp"}) {
+    prologue += Format("%s = 0x%04x\n", reg, rng() & 0xffff);
+  }
+  // Keeps the code segment at 0, so that execution continues after the prologue
+  prologue += Format("sr = 0x%04x\n", rng() & 0xffc0);
+  return UnspAssembler().Assemble(prologue, image);
+}
+
+void PrintUsage(std::string exec_name) {
+  std::cerr << "Usage: " << exec_name << " [options] [cartrom]" << std::endl
+            << std::endl
+            << "Without a cartridge ROM, random instruction streams are run from a number of "
+               "seeds. A cartridge ROM is run on flat memory, without any I/O registers."
+            << std::endl
+            << std::endl
+            << "  -seed N     First random seed (default 1)" << std::endl
+            << "  -seeds N    Number of random instruction streams (default 1000)" << std::endl
+            << "  -steps N    Instructions per stream (default 1000), or for the cartridge ROM "
+               "(default 10000000)"
+            << std::endl;
+}
+
+template <typename T>
+bool ParseNumber(std::string_view str, T& value) {
+  auto [ptr, error] = std::from_chars(str.data(), str.data() + str.size(), value);
+  return ptr == str.data() + str.size() && error == std::errc();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+
+  const std::vector<std::string_view> args(argv + 1, argv + argc);
+  for (size_t i = 0; i < args.size(); i++) {
+    const auto& arg = args[i];
+    const bool has_value = i + 1 < args.size();
+    bool valid = true;
+    if (arg == "-seed" && has_value) {
+      valid = ParseNumber(args[++i], options.seed);
+    } else if (arg == "-seeds" && has_value) {
+      valid = ParseNumber(args[++i], options.seeds) && options.seeds > 0;
+    } else if (arg == "-steps" && has_value) {
+      valid = ParseNumber(args[++i], options.steps) && options.steps > 0;
+    } else if (!arg.starts_with("-") && !options.cartrom_path.has_value()) {
+      options.cartrom_path = std::string(arg);
+    } else {
+      PrintUsage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    if (!valid) {
+      std::cerr << "Argument error: Invalid value for " << arg << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  auto lockstep = std::make_unique<Lockstep>();
+
+  if (options.cartrom_path.has_value()) {
+    std::vector<Word> image(kMemoryWords);
+    if (!ReadRomFile(*options.cartrom_path, image)) {
+      std::cerr << "Could not open cartridge ROM file" << std::endl;
+      return EXIT_FAILURE;
+    }
+    lockstep->Load(image);
+
+    std::mt19937 rng(options.seed);
+    auto report = lockstep->Run(options.steps ? options.steps : 10000000, rng);
+    if (report.has_value()) {
+      std::cout << *report;
+      return EXIT_FAILURE;
+    }
+    std::cout << "Matched " << lockstep->GetStepsRun() << " steps";
+    if (lockstep->StoppedByError())
+      std::cout << ", stopped by emulation error: " << *lockstep->GetError();
+    std::cout << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  uint64_t total_steps = 0;
+  uint32_t errors = 0;
+  std::vector<Word> image;
+  for (uint32_t seed = options.seed; seed < options.seed + options.seeds; seed++) {
+    std::mt19937 rng(seed);
+    if (auto error = MakeFuzzImage(image, rng); error.has_value()) {
+      std::cerr << "Could not assemble prologue: " << *error << std::endl;
+      return EXIT_FAILURE;
+    }
+    lockstep->Load(image);
+
+    auto report = lockstep->Run(options.steps ? options.steps : 1000, rng);
+    if (report.has_value()) {
+      std::cout << "Seed " << seed << ": " << *report;
+      return EXIT_FAILURE;
+    }
+    total_steps += lockstep->GetStepsRun();
+    errors += lockstep->StoppedByError();
+  }
+
+  std::cout << "Matched " << total_steps << " steps from " << options.seeds << " seeds, "
+            << errors << " ended by the same emulation error" << std::endl;
+  return EXIT_SUCCESS;
+}
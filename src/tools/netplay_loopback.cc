@@ -0,0 +1,303 @@
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "core/netplay/rollback_session.h"
+#include "core/vsmile/vsmile.h"
+#include "core/vsmile/vsmile_loader.h"
+#include "net/impaired_transport.h"
+#include "net/udp_transport.h"
+
+// Plays a two-player rollback netplay session between two threads over UDP on 127.0.0.1, with
+// simulated latency, jitter and packet loss on both directions. Passes if both peers end up in
+// the same state as a local run with the same input, without a detected desync.
+
+namespace {
+
+struct Options {
+  std::optional<std::string> cartrom_path;
+  std::optional<std::string> sysrom_path;
+  uint32_t frames = 1500;
+  int input_delay = 1;
+  int max_rollback = 8;
+  uint16_t port = 7845;
+  bool realtime = true;
+  ImpairedTransport::Settings impairment = {40, 10, 0.05, 1};
+};
+
+struct PeerResult {
+  bool ok = false;
+  uint64_t state_hash = 0;
+  std::optional<uint32_t> desync_frame;
+  RollbackSession::Stats stats;
+  double max_frame_ms = 0;
+  double total_frame_ms = 0;
+  uint32_t frames_run = 0;
+};
+
+constexpr double kFrameRate = 27000000.0 / (1728 * 312);
+constexpr auto kFrameTime = std::chrono::duration<double>(1.0 / kFrameRate);
+constexpr auto kTimeout = std::chrono::seconds(10);
+
+void PrintUsage(std::string exec_name) {
+  std::cerr
+      << "Usage: " << exec_name << " [options] [cartrom]" << std::endl
+      << std::endl
+      << "Without a cartridge ROM, an idle loop is run, which still exercises controller state."
+      << std::endl
+      << std::endl
+      << "  -sysrom FILE    Use system ROM FILE instead of dummy system ROM" << std::endl
+      << "  -frames N       Number of frames to play (default 1500)" << std::endl
+      << "  -latency MS     One-way latency in milliseconds (default 40)" << std::endl
+      << "  -jitter MS      Maximum random extra latency in milliseconds (default 10)" << std::endl
+      << "  -loss PERCENT   Packet loss in percent (default 5)" << std::endl
+      << "  -delay N        Local input delay in frames (default 1)" << std::endl
+      << "  -rollback N     Maximum rollback in frames (default 8)" << std::endl
+      << "  -port PORT      First of two local UDP ports to use (default 7845)" << std::endl
+      << "  -fast           Run as fast as possible instead of at the emulated frame rate"
+      << std::endl;
+}
+
+template <typename T>
+bool ParseNumber(std::string_view str, T& value) {
+  auto [ptr, error] = std::from_chars(str.data(), str.data() + str.size(), value);
+  return ptr == str.data() + str.size() && error == std::errc();
+}
+
+// Scripted input of each player, changing every few frames
+VSmile::JoyInput GenerateInput(int player, uint32_t frame) {
+  uint32_t x = (frame / 8) * 0x9e3779b1 ^ (player + 1) * 0x85ebca77;
+  x ^= x >> 15;
+  x *= 0x2c1b3c6d;
+  x ^= x >> 12;
+
+  VSmile::JoyInput input;
+  input.x = static_cast<int>(x % 11) - 5;
+  input.y = static_cast<int>((x >> 4) % 11) - 5;
+  input.red = ((x >> 8) & 7) == 0;
+  input.yellow = ((x >> 11) & 7) == 0;
+  input.blue = ((x >> 14) & 7) == 0;
+  input.green = ((x >> 17) & 7) == 0;
+  input.enter = ((x >> 20) & 7) == 0;
+  return input;
+}
+
+// Local input is used input_delay frames after it is given
+VSmile::JoyInput GetPlayedInput(int player, uint32_t frame, int input_delay) {
+  if (frame < static_cast<uint32_t>(input_delay))
+    return {};
+  return GenerateInput(player, frame - input_delay);
+}
+
+std::unique_ptr<VSmile> CreateVSmile(std::shared_ptr<const VSmile::SysRomType> sysrom,
+                                     std::shared_ptr<const VSmile::CartRomType> cartrom) {
+  auto vsmile = std::make_unique<VSmile>(std::move(sysrom), std::move(cartrom),
+                                         VSmile::CartType::STANDARD, nullptr, 0xe, true,
+                                         VideoTiming::PAL);
+  vsmile->SetDeterministicRandom(true);
+  vsmile->Reset();
+  return vsmile;
+}
+
+void RunPeer(int player, const Options& options,
+             std::shared_ptr<const VSmile::SysRomType> sysrom,
+             std::shared_ptr<const VSmile::CartRomType> cartrom, std::atomic<int>& peers_done,
+             PeerResult& result) {
+  using Clock = std::chrono::steady_clock;
+
+  auto vsmile = CreateVSmile(std::move(sysrom), std::move(cartrom));
+
+  UdpTransport udp;
+  const std::string peer = "127.0.0.1:" + std::to_string(options.port + 1 - player);
+  auto error = udp.Open(options.port + player, peer);
+  if (error.has_value()) {
+    std::cerr << "Player " << player + 1 << ": " << *error << std::endl;
+    peers_done++;
+    return;
+  }
+
+  ImpairedTransport::Settings impairment = options.impairment;
+  impairment.seed += player;
+  ImpairedTransport transport(udp, impairment);
+
+  RollbackSession::Settings settings;
+  settings.local_player = player;
+  settings.input_delay = options.input_delay;
+  settings.max_rollback = options.max_rollback;
+  RollbackSession session(*vsmile, transport, settings);
+
+  auto next_frame = Clock::now();
+  auto last_progress = next_frame;
+  while (session.GetFrame() < options.frames) {
+    if (options.realtime) {
+      std::this_thread::sleep_until(next_frame);
+      next_frame += std::chrono::duration_cast<Clock::duration>(kFrameTime);
+    }
+
+    const auto start = Clock::now();
+    const bool ran = session.AdvanceFrame(GenerateInput(player, session.GetFrame()));
+    const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    vsmile->GetAudio();
+
+    if (ran) {
+      result.max_frame_ms = std::max(result.max_frame_ms, ms);
+      result.total_frame_ms += ms;
+      result.frames_run++;
+      last_progress = Clock::now();
+    } else if (Clock::now() - last_progress > kTimeout) {
+      std::cerr << "Player " << player + 1 << ": Timed out waiting for peer" << std::endl;
+      peers_done++;
+      return;
+    } else if (!options.realtime) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  // Keep exchanging input until every frame is confirmed and the peer is done as well
+  peers_done++;
+  const auto finish = Clock::now();
+  while (session.GetConfirmedFrame() < options.frames || peers_done < 2) {
+    if (Clock::now() - finish > kTimeout) {
+      std::cerr << "Player " << player + 1 << ": Timed out confirming input" << std::endl;
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    session.Idle();
+  }
+  // Give the peer time to receive the final acknowledgements
+  for (int i = 0; i < 50; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    session.Idle();
+  }
+
+  result.ok = true;
+  result.state_hash = vsmile->GetStateHash();
+  result.desync_frame = session.GetDesyncFrame();
+  result.stats = session.GetStats();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  double loss_percent = 5;
+
+  const std::vector<std::string_view> args(argv + 1, argv + argc);
+  for (size_t i = 0; i < args.size(); i++) {
+    const auto& arg = args[i];
+    const bool has_value = i + 1 < args.size();
+    bool valid = true;
+    if (arg == "-sysrom" && has_value) {
+      options.sysrom_path = args[++i];
+    } else if (arg == "-frames" && has_value) {
+      valid = ParseNumber(args[++i], options.frames);
+    } else if (arg == "-latency" && has_value) {
+      valid = ParseNumber(args[++i], options.impairment.latency_ms);
+    } else if (arg == "-jitter" && has_value) {
+      valid = ParseNumber(args[++i], options.impairment.jitter_ms);
+    } else if (arg == "-loss" && has_value) {
+      valid = ParseNumber(args[++i], loss_percent) && loss_percent >= 0 && loss_percent < 100;
+    } else if (arg == "-delay" && has_value) {
+      valid = ParseNumber(args[++i], options.input_delay) && options.input_delay >= 0;
+    } else if (arg == "-rollback" && has_value) {
+      valid = ParseNumber(args[++i], options.max_rollback) && options.max_rollback > 0;
+    } else if (arg == "-port" && has_value) {
+      valid = ParseNumber(args[++i], options.port) && options.port < 0xffff;
+    } else if (arg == "-fast") {
+      options.realtime = false;
+    } else if (arg[0] != '-' && !options.cartrom_path.has_value()) {
+      options.cartrom_path = arg;
+    } else {
+      PrintUsage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    if (!valid) {
+      std::cerr << "Argument error: Invalid value for " << arg << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  options.impairment.loss = loss_percent / 100;
+
+  auto cartrom = std::make_shared<VSmile::CartRomType>();
+  if (options.cartrom_path.has_value()) {
+    if (!ReadRomFile(*options.cartrom_path, *cartrom)) {
+      std::cerr << "Could not open cartridge ROM file" << std::endl;
+      return EXIT_FAILURE;
+    }
+  } else {
+    // Reset vector pointing to a jump to itself
+    (*cartrom)[0xfff7] = 0x8000;
+    (*cartrom)[0x8000] = 0xee41;
+  }
+
+  auto sysrom = std::make_shared<VSmile::SysRomType>();
+  if (options.sysrom_path.has_value()) {
+    if (!ReadRomFile(*options.sysrom_path, *sysrom)) {
+      std::cerr << "Could not open system ROM file" << std::endl;
+      return EXIT_FAILURE;
+    }
+  } else {
+    MakeDummySysRom(*sysrom);
+  }
+
+  std::cout << "Playing " << options.frames << " frames with " << options.impairment.latency_ms
+            << " ms latency, " << options.impairment.jitter_ms << " ms jitter and "
+            << loss_percent << "% packet loss" << std::endl;
+
+  PeerResult results[2];
+  std::atomic<int> peers_done = 0;
+  std::thread peers[2];
+  for (int player = 0; player < 2; player++) {
+    peers[player] = std::thread(RunPeer, player, std::cref(options), sysrom, cartrom,
+                                std::ref(peers_done), std::ref(results[player]));
+  }
+  for (auto& peer : peers) {
+    peer.join();
+  }
+  if (!results[0].ok || !results[1].ok)
+    return EXIT_FAILURE;
+
+  // Local run with the input both players actually played
+  auto reference = CreateVSmile(sysrom, cartrom);
+  reference->SetControllerConnected(1, true);
+  for (uint32_t frame = 0; frame < options.frames; frame++) {
+    for (int player = 0; player < 2; player++) {
+      reference->UpdateJoystick(GetPlayedInput(player, frame, options.input_delay), player);
+    }
+    reference->RunFrame();
+  }
+  const uint64_t reference_hash = reference->GetStateHash();
+
+  bool pass = true;
+  std::cout << std::fixed << std::setprecision(2);
+  for (int player = 0; player < 2; player++) {
+    const auto& result = results[player];
+    const auto& stats = result.stats;
+    const bool match = result.state_hash == reference_hash && !result.desync_frame.has_value();
+    pass &= match;
+
+    std::cout << "Player " << player + 1 << ": " << (match ? "OK" : "MISMATCH") << std::endl
+              << "  rollbacks: " << stats.rollbacks
+              << ", resimulated frames: " << stats.resimulated_frames
+              << " (max " << stats.max_resimulated_frames << ")" << std::endl
+              << "  input stalls: " << stats.input_stalls
+              << ", sync stalls: " << stats.sync_stalls << std::endl
+              << "  packets sent: " << stats.packets_sent
+              << ", received: " << stats.packets_received << std::endl
+              << "  frame time: " << result.total_frame_ms / result.frames_run
+              << " ms average, " << result.max_frame_ms << " ms max" << std::endl;
+    if (result.desync_frame.has_value())
+      std::cout << "  desync detected at frame " << *result.desync_frame << std::endl;
+  }
+
+  return pass ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,99 @@
+#include "audio_state.h"
+
+#include <algorithm>
+
+#include "core/spg200/spu.h"
+
+// Maximum deviation from nominal resampling ratio used to steer buffer fill toward target
+static constexpr double kMaxRateAdjust = 0.005;
+
+// Smoothing factor for fill level measurements, which jitter with callback timing
+static constexpr double kFillSmoothing = 0.05;
+
+void AudioState::Init(int sample_rate, Resampler::Quality quality) {
+  SDL_AudioSpec want = {};
+  want.freq = sample_rate;
+  want.format = AUDIO_S16;
+  want.channels = 2;
+  want.samples = 512;
+  want.callback = AudioCallback;
+  want.userdata = this;
+
+  SDL_AudioSpec have;
+  device_ = SDL_OpenAudioDevice(nullptr, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+  sample_rate_ = device_ ? have.freq : sample_rate;
+
+  // Keep about two device buffers queued when new samples arrive, so that a callback never
+  // runs dry while the next frame is emulated
+  target_frames_ = (device_ ? have.samples : want.samples) * 2;
+  fill_frames_ = target_frames_;
+
+  resampler_ = std::make_unique<Resampler>(Spu::SampleRate, sample_rate_, quality);
+  if (device_)
+    SDL_PauseAudioDevice(device_, 0);
+}
+
+void AudioState::Quit() {
+  if (device_) {
+    SDL_CloseAudioDevice(device_);
+    device_ = 0;
+  }
+}
+
+void AudioState::PushSamples(std::span<const uint16_t> samples) {
+  if (!device_)
+    return;
+
+  resampled_.clear();
+  resampler_->Process(samples, resampled_);
+
+  SDL_LockAudioDevice(device_);
+  const size_t queued_frames = queue_.size() / 2;
+  queue_.insert(queue_.end(), resampled_.begin(), resampled_.end());
+  SDL_UnlockAudioDevice(device_);
+
+  // Consume input slightly faster when the buffer is too full and slower when it is too empty
+  fill_frames_ += (queued_frames - fill_frames_) * kFillSmoothing;
+  const double error = (fill_frames_ - target_frames_) / target_frames_;
+  resampler_->SetRateAdjust(1.0 + kMaxRateAdjust * std::clamp(error, -1.0, 1.0));
+}
+
+void AudioState::Clear() {
+  SDL_LockAudioDevice(device_);
+  queue_.clear();
+  SDL_UnlockAudioDevice(device_);
+}
+
+size_t AudioState::GetQueuedFrames() {
+  SDL_LockAudioDevice(device_);
+  size_t frames = queue_.size() / 2;
+  SDL_UnlockAudioDevice(device_);
+  return frames;
+}
+
+size_t AudioState::GetTargetFrames() const {
+  return target_frames_;
+}
+
+int AudioState::GetSampleRate() const {
+  return sample_rate_;
+}
+
+double AudioState::GetFillMs() const {
+  return fill_frames_ * 1000.0 / sample_rate_;
+}
+
+double AudioState::GetRateAdjust() const {
+  return resampler_->GetRateAdjust();
+}
+
+void AudioState::AudioCallback(void* userdata, uint8_t* output, int len) {
+  auto& state = *static_cast<AudioState*>(userdata);
+  auto out = reinterpret_cast<int16_t*>(output);
+  const size_t count = len / sizeof(int16_t);
+
+  const size_t available = std::min(count, state.queue_.size());
+  std::copy_n(state.queue_.begin(), available, out);
+  state.queue_.erase(state.queue_.begin(), state.queue_.begin() + available);
+  std::fill(out + available, out + count, 0);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <SDL.h>
+
+#include <deque>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "core/audio/resampler.h"
+
+class AudioState {
+public:
+  void Init(int sample_rate, Resampler::Quality quality);
+  void Quit();
+  void PushSamples(std::span<const uint16_t> samples);
+  void Clear();
+  size_t GetQueuedFrames();
+  size_t GetTargetFrames() const;
+  int GetSampleRate() const;
+
+  double GetFillMs() const;
+  double GetRateAdjust() const;
+
+private:
+  static void AudioCallback(void* userdata, uint8_t* output, int len);
+
+  SDL_AudioDeviceID device_ = 0;
+  int sample_rate_ = 0;
+  size_t target_frames_ = 0;
+  double fill_frames_ = 0;
+  std::unique_ptr<Resampler> resampler_;
+  std::vector<int16_t> resampled_;
+  std::deque<int16_t> queue_;
+};
@@ -10,6 +10,7 @@ void GraphicsState::Init(int width, int height) {
                              height, SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
   gl_context_ = SDL_GL_CreateContext(window_);
   SDL_GL_MakeCurrent(window_, gl_context_);
+  SDL_GL_SetSwapInterval(0);
 
   // GL settings
   glDisable(GL_DEPTH_TEST);
@@ -90,4 +91,20 @@ SDL_GLContext GraphicsState::GetGlContext() {
 
 void GraphicsState::SetFullscreen(bool fullscreen) {
   SDL_SetWindowFullscreen(window_, fullscreen ? SDL_WINDOW_FULLSCREEN_DESKTOP : 0);
-}
\ No newline at end of file
+}
+
+void GraphicsState::SetVsync(bool vsync) {
+  if (vsync == vsync_)
+    return;
+
+  // Not all drivers support changing swap interval, keep old state if it fails
+  if (SDL_GL_SetSwapInterval(vsync ? 1 : 0) == 0)
+    vsync_ = vsync;
+}
+
+double GraphicsState::GetRefreshRate() {
+  SDL_DisplayMode mode;
+  if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window_), &mode) != 0)
+    return 0;
+  return mode.refresh_rate;
+}
@@ -14,6 +14,8 @@ public:
   SDL_Window* GetWindow();
   SDL_GLContext GetGlContext();
   void SetFullscreen(bool fullscreen);
+  void SetVsync(bool vsync);
+  double GetRefreshRate();
 
 private:
   GLuint texture_id_ = 0;
@@ -23,4 +25,5 @@ private:
   int window_height_ = 0;
   int margin_width_ = 0;
   int margin_height_ = 0;
+  bool vsync_ = false;
 };
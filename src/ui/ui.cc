@@ -1,7 +1,13 @@
 #include "ui.h"
 
 #include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <string>
 #include <vector>
 
 #include <SDL.h>
@@ -16,8 +22,17 @@
 #include "nfd.hpp"
 #include "nfd_sdl2.h"
 
+#include "audio_state.h"
+#include "core/netplay/rollback_session.h"
+#include "core/spg200/memory_access_stats.h"
+#include "core/spg200/spu.h"
+#include "core/state/rewind_buffer.h"
 #include "core/vsmile/vsmile.h"
+#include "core/vsmile/vsmile_frame_timings.h"
+#include "core/vsmile/vsmile_hash_log.h"
+#include "core/vsmile/vsmile_movie.h"
 #include "graphics_state.h"
+#include "net/udp_transport.h"
 #include "version.h"
 
 static struct UiSettings {
@@ -36,7 +51,10 @@ static struct UiSettings {
   bool show_spu_output_window = false;
   bool show_load_window = false;
   bool show_memory_editor = false;
+  bool show_memory_access_window = false;
   bool show_about_window = false;
+  int run_ahead_frames = 0;
+  int controller_port = 0;
 
   std::array<float, 281250 / 4> audio_samples_left;
   std::array<float, 281250 / 4> audio_samples_right;
@@ -47,15 +65,36 @@ static struct UiSettings {
 
 static std::unique_ptr<VSmile> vsmile = nullptr;
 static GraphicsState graphics_state;
+static AudioState audio_state;
+static std::unique_ptr<RewindBuffer> rewind_buffer;
+static std::vector<uint8_t> frame_state;
+static std::vector<uint8_t> run_ahead_picture;
+static std::FILE* hash_log_file = nullptr;
+static std::unique_ptr<VSmileHashLog> hash_log;
+static std::unique_ptr<UdpTransport> netplay_transport;
+static std::unique_ptr<RollbackSession> netplay_session;
+static VSmileFrameTimings frame_timings;
+static MemoryAccessStats memory_access_stats;
+
+static struct MovieState {
+  enum class Mode { NONE, RECORDING, PLAYING };
+
+  Mode mode = Mode::NONE;
+  VSmileMovie movie;
+  size_t position = 0;
+  std::string path;
+} movie_state;
+
+static struct BootCacheState {
+  // Unset when the boot cache is not used
+  std::optional<std::filesystem::path> dir;
+  bool refresh = false;
+  // Whether the state should be saved once the current machine finishes the intro
+  bool pending = false;
+} boot_cache;
 
 static SystemConfig cur_system_config;
 
-static void SdlAudioCallback(void* audio_stream, unsigned char* output, int len) {
-  int written = SDL_AudioStreamGet(static_cast<SDL_AudioStream*>(audio_stream), output, len);
-  if (written < len)
-    SDL_memset(output + written, 0, len - written);
-}
-
 static VSmile::JoyInput ReadController(SDL_GameController* pad) {
   VSmile::JoyInput input;
   input.red = SDL_GameControllerGetButton(pad, SDL_CONTROLLER_BUTTON_X);
@@ -128,6 +167,71 @@ static bool ImguiInit() {
   return true;
 }
 
+// Whether the display refresh is close enough to the emulated frame rate for the audio rate
+// control to absorb the difference. SDL only reports whole Hz, and some platforms truncate
+// 1000/1001 rates such as 59.94 Hz down, so that rate above the reported one is checked too.
+static bool IsRefreshRateClose(double refresh_rate, VideoTiming video_timing) {
+  const double frame_rate = GetEmulatedFrameRate(video_timing);
+  for (double rate : {refresh_rate, (refresh_rate + 1) * 1000 / 1001}) {
+    if (std::abs(rate / frame_rate - 1.0) < 0.005)
+      return true;
+  }
+  return false;
+}
+
+// Draws host time per frame as one stacked column per frame of the window, scaled to twice the
+// emulated frame time, followed by percentiles of each phase
+static void DrawFrameTimings() {
+  static constexpr ImU32 kPhaseColors[] = {
+      IM_COL32(230, 90, 80, 255),    // CPU
+      IM_COL32(90, 180, 90, 255),    // PPU
+      IM_COL32(80, 140, 230, 255),   // SPU
+      IM_COL32(200, 160, 60, 255),   // Timers and IO
+      IM_COL32(120, 200, 150, 255),  // Rewind
+      IM_COL32(210, 210, 110, 255),  // Run-ahead
+      IM_COL32(110, 150, 190, 255),  // Netplay
+      IM_COL32(170, 100, 210, 255),  // Video upload
+      IM_COL32(80, 200, 200, 255),   // GUI
+      IM_COL32(150, 150, 150, 255),  // Present
+      IM_COL32(230, 140, 190, 255),  // Audio sync
+      IM_COL32(100, 100, 110, 255),  // Other
+  };
+  constexpr float kHeight = 48;
+  const size_t frames = frame_timings.GetWindowFrames();
+  if (!frames)
+    return;
+
+  const double frame_ms = 1000.0 / GetEmulatedFrameRate(cur_system_config.video_timing);
+  const float scale = kHeight / (2 * frame_ms);
+  ImDrawList* draw_list = ImGui::GetWindowDrawList();
+  const ImVec2 origin = ImGui::GetCursorScreenPos();
+  ImGui::Dummy(ImVec2(frames, kHeight));
+
+  for (size_t frame = 0; frame < frames; frame++) {
+    const float x = origin.x + frame;
+    float y = origin.y + kHeight;
+    for (int phase = 0; phase < VSmileFrameTimings::PHASE_COUNT && y > origin.y; phase++) {
+      const float top =
+          std::max<float>(y - frame_timings.GetMs(frame, phase) * scale, origin.y);
+      draw_list->AddRectFilled(ImVec2(x, top), ImVec2(x + 1, y), kPhaseColors[phase]);
+      y = top;
+    }
+  }
+  const float budget_y = origin.y + kHeight - frame_ms * scale;
+  draw_list->AddLine(ImVec2(origin.x, budget_y), ImVec2(origin.x + frames, budget_y),
+                     IM_COL32(255, 255, 255, 160));
+
+  ImGui::Text("%-12s %6s %6s", "ms", "p50", "p99");
+  for (int phase = 0; phase <= VSmileFrameTimings::PHASE_COUNT; phase++) {
+    const ImU32 color =
+        phase < VSmileFrameTimings::PHASE_COUNT ? kPhaseColors[phase] : IM_COL32_WHITE;
+    ImGui::TextColored(ImGui::ColorConvertU32ToFloat4(color), "%-12s %6.2f %6.2f",
+                       VSmileFrameTimings::GetPhaseName(phase),
+                       frame_timings.GetPercentileMs(phase, 50),
+                       frame_timings.GetPercentileMs(phase, 99));
+  }
+}
+
 static void DrawFps(bool show_number) {
   ImGuiIO& io = ImGui::GetIO();
 
@@ -142,93 +246,242 @@ static void DrawFps(bool show_number) {
   } else {
     ImGui::Text("FPS: -");
   }
+  ImGui::Text("Audio: %.1f ms", audio_state.GetFillMs());
+  ImGui::Text("Rate: %+.3f%%", (audio_state.GetRateAdjust() - 1.0) * 100);
+  DrawFrameTimings();
+  if (rewind_buffer) {
+    ImGui::Text("Rewind: %zu frames, %.1f MB", rewind_buffer->GetFrameCount(),
+                rewind_buffer->GetMemoryUsage() / (1024.0 * 1024.0));
+  }
+  if (netplay_session) {
+    const auto& stats = netplay_session->GetStats();
+    ImGui::Text("Netplay: frame %u, %u unconfirmed", netplay_session->GetFrame(),
+                netplay_session->GetFrame() - netplay_session->GetConfirmedFrame());
+    ImGui::Text("Rollbacks: %llu, max %d frames", static_cast<unsigned long long>(stats.rollbacks),
+                stats.max_resimulated_frames);
+    ImGui::Text("Stalls: %llu input, %llu sync",
+                static_cast<unsigned long long>(stats.input_stalls),
+                static_cast<unsigned long long>(stats.sync_stalls));
+    if (netplay_session->GetFramesSinceReceive() > 60)
+      ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.0f, 1.0f), "Waiting for peer");
+    if (auto desync_frame = netplay_session->GetDesyncFrame())
+      ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Desync at frame %u", *desync_frame);
+  }
   ImGui::End();
   ImGui::PopStyleVar();
 }
 
-static void UnloadVSmile() {
-  if (!vsmile)
-    return;
+// Emulates frames past the current one with the latest input and keeps the picture of the last
+// one, then restores the state saved after the current frame. This hides the same number of
+// frames of input latency that games add on top of the host.
+static void RunAhead(int frames) {
+  // Frames run ahead are run again once they are reached, and only counted then
+  MemoryAccessStats* access_stats = vsmile->GetMemoryAccessStats();
+  vsmile->SetMemoryAccessStats(nullptr);
+  const auto intro_status = vsmile->GetIntroStatus();
+  vsmile->SetAudioEnabled(false);
+  for (int i = 0; i < frames; i++) {
+    vsmile->RunFrame();
+  }
+  auto fb = vsmile->GetPicture();
+  run_ahead_picture.assign(fb.begin(), fb.end());
 
-  // Flush Art Studio cartridge RAM to file if save path is defined
-  if (cur_system_config.cart_type == VSmile::CartType::ART_STUDIO &&
-      cur_system_config.csb2_nvram_save_path.has_value()) {
-    std::ofstream csb2_nvram_save(*cur_system_config.csb2_nvram_save_path,
-                                  std::ios::binary | std::ios::trunc);
-    if (!csb2_nvram_save.good()) {
-      std::cerr << "Failed to open NVRAM save file for writing" << std::endl;
-    } else {
-      auto final_csb2_nvram = *vsmile->GetArtNvram();
-      std::transform(final_csb2_nvram.begin(), final_csb2_nvram.end(), final_csb2_nvram.begin(),
-                     [](uint16_t x) -> uint16_t { return SDL_SwapLE16(x); });
-      csb2_nvram_save.write(reinterpret_cast<char*>(final_csb2_nvram.data()),
-                            sizeof(VSmile::ArtNvramType));
-      if (csb2_nvram_save.fail()) {
-        std::cerr << "Failed to write to NVRAM save file" << std::endl;
-      }
+  vsmile->LoadState(frame_state);
+  vsmile->SetIntroStatus(intro_status);
+  vsmile->SetAudioEnabled(true);
+  vsmile->SetMemoryAccessStats(access_stats);
+}
+
+// Outputs the audio of the frame just run
+static void PushFrameAudio() {
+  auto ab = vsmile->GetAudio();
+  audio_state.PushSamples(ab);
+
+  if (ui.show_spu_output_window) {
+    for (size_t i = 0; i < ab.size(); i += 2) {
+      ui.audio_samples_left[ui.audio_samples_offset] = (ab[i] - 32768);
+      ui.audio_samples_right[ui.audio_samples_offset] = (ab[i + 1] - 32768);
+      ui.audio_samples_offset++;
+
+      if (ui.audio_samples_offset == std::size(ui.audio_samples_left))
+        ui.audio_samples_offset = 0;
     }
   }
-
-  vsmile.reset();
 }
 
-static std::optional<std::string> LoadVSmile(const SystemConfig& config) {
-  if (!config.cartrom_path.has_value()) {
-    return "No cartridge ROM defined";
+static std::optional<std::string> StartMoviePlayback(const std::string& path) {
+  std::ifstream movie_file(path, std::ios::binary);
+  if (!movie_file.good()) {
+    return "Could not open movie file";
+  }
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(movie_file)),
+                            std::istreambuf_iterator<char>());
+  if (!movie_state.movie.Load(data)) {
+    return "Invalid movie file";
+  }
+  if (movie_state.movie.GetFrameCount() == 0) {
+    return "Movie contains no frames";
   }
 
-  auto cartrom = std::make_unique<VSmile::CartRomType>();
-  std::ifstream cartrom_file(*config.cartrom_path, std::ios::binary);
-  if (!cartrom_file.good()) {
-    return "Could not open cartridge ROM file";
+  movie_state.mode = MovieState::Mode::PLAYING;
+  movie_state.position = 0;
+  movie_state.path = path;
+  return {};
+}
+
+static void StartMovieRecording(const std::string& path) {
+  VSmileMovie::Settings settings;
+  settings.video_timing = cur_system_config.video_timing;
+  settings.cart_type = cur_system_config.cart_type;
+  settings.region_code = cur_system_config.region_code;
+  settings.vtech_logo = cur_system_config.vtech_logo;
+
+  movie_state.mode = MovieState::Mode::RECORDING;
+  movie_state.movie = VSmileMovie(settings);
+  movie_state.position = 0;
+  movie_state.path = path;
+}
+
+static void StopMovie() {
+  if (movie_state.mode == MovieState::Mode::RECORDING) {
+    std::vector<uint8_t> data;
+    movie_state.movie.Save(data);
+
+    std::ofstream movie_file(movie_state.path, std::ios::binary | std::ios::trunc);
+    movie_file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if (!movie_file.good()) {
+      std::cerr << "Failed to write movie file" << std::endl;
+    } else {
+      std::cout << "Recorded " << movie_state.movie.GetFrameCount() << " frames to "
+                << movie_state.path << std::endl;
+    }
   }
-  cartrom_file.read(reinterpret_cast<char*>(cartrom.get()), sizeof *cartrom);
-  std::transform(cartrom->begin(), cartrom->end(), cartrom->begin(),
-                 [](uint16_t x) -> uint16_t { return SDL_SwapLE16(x); });
+  movie_state.mode = MovieState::Mode::NONE;
+}
 
-  auto sysrom = std::make_unique<VSmile::SysRomType>();
-  if (!config.use_dummy_sysrom) {
-    std::ifstream sysrom_file(*config.sysrom_path, std::ios::binary);
-    if (!sysrom_file.good()) {
-      return "Could not open system ROM file";
+// Reads input for the next frame from the movie being played back, or from the host
+// otherwise, in which case it is appended to the movie being recorded
+static VSmileMovie::FrameInput GetFrameInput(SDL_GameController* pad) {
+  if (movie_state.mode == MovieState::Mode::PLAYING) {
+    auto input = movie_state.movie.GetFrame(movie_state.position++);
+    if (movie_state.position == movie_state.movie.GetFrameCount()) {
+      std::cout << "Movie playback finished" << std::endl;
+      movie_state.mode = MovieState::Mode::NONE;
     }
-    sysrom_file.read(reinterpret_cast<char*>(sysrom.get()), sizeof *sysrom);
-    std::transform(sysrom->begin(), sysrom->end(), sysrom->begin(),
-                   [](uint16_t x) -> uint16_t { return SDL_SwapLE16(x); });
-  } else {
-    // Provide game-compatible dummy system ROM if no one provided by user
-    sysrom->fill(0);
-    for (int i = 0xfffc0; i < 0xfffdc; i += 2) {
-      (*sysrom)[i + 1] = 0x31;
-    }
-  }
-
-  std::unique_ptr<VSmile::ArtNvramType> initial_art_nvram;
-  if (config.cart_type == VSmile::CartType::ART_STUDIO) {
-    if (config.csb2_nvram_save_path.has_value()) {
-      std::ifstream csb2_nvram_save_file(*config.csb2_nvram_save_path, std::ios::binary);
-      initial_art_nvram = std::make_unique<VSmile::ArtNvramType>();
-      if (csb2_nvram_save_file.good()) {
-        csb2_nvram_save_file.read(reinterpret_cast<char*>(initial_art_nvram.get()),
-                                  sizeof *initial_art_nvram);
-        std::transform(initial_art_nvram->begin(), initial_art_nvram->end(),
-                       initial_art_nvram->begin(),
-                       [](uint16_t x) -> uint16_t { return SDL_SwapLE16(x); });
+    return input;
+  }
+
+  VSmileMovie::FrameInput input;
+  input.joy = pad ? ReadController(pad) : ReadControllerFromKeyboard();
+  input.on_button = ui.on_button || ImGui::IsKeyDown(ImGuiKey_F1);
+  input.off_button = ui.off_button || ImGui::IsKeyDown(ImGuiKey_F2);
+  input.restart_button = ui.restart_button || ImGui::IsKeyDown(ImGuiKey_F3);
+  ui.on_button = false;
+  ui.off_button = false;
+  ui.restart_button = false;
+
+  if (movie_state.mode == MovieState::Mode::RECORDING) {
+    movie_state.movie.AddFrame(input);
+    movie_state.position++;
+  }
+  return input;
+}
+
+static std::filesystem::path GetBootCachePath() {
+  char name[32];
+  std::snprintf(name, sizeof name, "%016" PRIx64 ".state", vsmile->GetConfigHash());
+  return *boot_cache.dir / name;
+}
+
+// Resumes a machine that was just reset from the state saved when the cartridge last took over
+// after the system ROM intro. Without one, the state is saved when that happens this time.
+static void StartBootCache(const SystemConfig& config) {
+  boot_cache.pending = false;
+  // The dummy system ROM has no intro, and Art Studio NVRAM would be overwritten by the state
+  if (!boot_cache.dir.has_value() || config.use_dummy_sysrom ||
+      config.cart_type != VSmile::CartType::STANDARD)
+    return;
+
+  if (!boot_cache.refresh) {
+    std::ifstream cache_file(GetBootCachePath(), std::ios::binary);
+    if (cache_file.good()) {
+      std::vector<uint8_t> data((std::istreambuf_iterator<char>(cache_file)),
+                                std::istreambuf_iterator<char>());
+      // States from other versions fail to load and are replaced
+      if (vsmile->LoadState(data)) {
+        std::cout << "Skipped intro using boot cache" << std::endl;
+        return;
       }
-    } else {
-      initial_art_nvram = std::make_unique<VSmile::ArtNvramType>();
     }
   }
+  boot_cache.pending = true;
+}
+
+static void SaveBootCache() {
+  boot_cache.pending = false;
+
+  std::vector<uint8_t> data;
+  vsmile->SaveState(data);
+
+  // Written to a temporary file first, so that a cache file is never left partially written
+  const auto path = GetBootCachePath();
+  auto temp_path = path;
+  temp_path += ".tmp";
+  std::error_code error;
+  std::filesystem::create_directories(*boot_cache.dir, error);
+  {
+    std::ofstream cache_file(temp_path, std::ios::binary | std::ios::trunc);
+    cache_file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if (!cache_file.good()) {
+      std::cerr << "Failed to write boot cache file" << std::endl;
+      return;
+    }
+  }
+  std::filesystem::rename(temp_path, path, error);
+  if (error) {
+    std::cerr << "Failed to write boot cache file" << std::endl;
+    return;
+  }
+  std::cout << "Saved boot cache to " << path.string() << std::endl;
+}
+
+static void UnloadVSmile() {
+  if (!vsmile)
+    return;
+
+  // Flush Art Studio cartridge RAM to file if save path is defined and it has been written to
+  if (cur_system_config.cart_type == VSmile::CartType::ART_STUDIO &&
+      cur_system_config.csb2_nvram_save_path.has_value() &&
+      vsmile->GetArtNvramDirtyPages().IsAnyDirty(DirtyPageUser::NVRAM_SAVE)) {
+    auto save_error = SaveArtNvram(*vsmile, *cur_system_config.csb2_nvram_save_path);
+    if (save_error.has_value()) {
+      std::cerr << *save_error << std::endl;
+    }
+  }
+
+  vsmile.reset();
+}
+
+static std::optional<std::string> LoadVSmile(const SystemConfig& config) {
+  std::unique_ptr<VSmile> new_vsmile;
+  auto error = CreateVSmile(config, new_vsmile);
+  if (error.has_value()) {
+    return error;
+  }
 
   if (vsmile) {
+    StopMovie();
     UnloadVSmile();
   }
 
-  vsmile = std::make_unique<VSmile>(std::move(sysrom), std::move(cartrom), config.cart_type,
-                                    std::move(initial_art_nvram), config.region_code,
-                                    config.vtech_logo, config.video_timing);
+  vsmile = std::move(new_vsmile);
   vsmile->Reset();
   cur_system_config = config;
+  StartBootCache(config);
+
+  if (rewind_buffer)
+    rewind_buffer->Clear();
+  run_ahead_picture.clear();
 
   return {};
 }
@@ -402,26 +655,166 @@ static void DrawLeds(VSmile::JoyLedStatus leds, ImVec2 overlay_pos) {
   ImGui::PopStyleVar();
 }
 
+static void SaveMemoryAccessStats() {
+  nfdu8char_t* nfd_path;
+  nfdu8filteritem_t nfd_filters[] = {{"CSV file", "csv"}};
+
+  nfdwindowhandle_t nfd_window_handle = {NFD_WINDOW_HANDLE_TYPE_UNSET, NULL};
+  NFD_GetNativeWindowFromSDLWindow(graphics_state.GetWindow(), &nfd_window_handle);
+
+  nfdresult_t result = NFD::SaveDialog(nfd_path, nfd_filters, std::size(nfd_filters), nullptr,
+                                       "memory_access.csv", nfd_window_handle);
+  if (result != NFD_OKAY)
+    return;
+
+  std::FILE* file = std::fopen(nfd_path, "w");
+  if (file) {
+    memory_access_stats.WriteCsv(file);
+    std::fclose(file);
+  } else {
+    std::cerr << "Failed to write memory access statistics to " << nfd_path << std::endl;
+  }
+  NFD::FreePath(nfd_path);
+}
+
+static void DrawMemoryAccessWindow() {
+  enum Shown { SHOWN_ALL, SHOWN_READS, SHOWN_WRITES };
+  static int show_regions = 0;
+  static int shown = SHOWN_ALL;
+  static bool hide_unused = true;
+
+  ImGui::SetNextWindowSize(ImVec2(720, 400), ImGuiCond_FirstUseEver);
+  ImGui::Begin("Memory Access Statistics", &ui.show_memory_access_window);
+
+  if (ImGui::Button("Reset")) {
+    memory_access_stats.Reset();
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Save CSV...")) {
+    SaveMemoryAccessStats();
+  }
+  ImGui::SameLine();
+  ImGui::Checkbox("Hide unused", &hide_unused);
+
+  ImGui::RadioButton("Registers", &show_regions, 0);
+  ImGui::SameLine();
+  ImGui::RadioButton("1K regions", &show_regions, 1);
+  ImGui::SameLine(0, 30);
+  ImGui::RadioButton("Reads and writes", &shown, SHOWN_ALL);
+  ImGui::SameLine();
+  ImGui::RadioButton("Reads", &shown, SHOWN_READS);
+  ImGui::SameLine();
+  ImGui::RadioButton("Writes", &shown, SHOWN_WRITES);
+
+  // Columns after the address and area are the requesters followed by the total
+  constexpr int kCountColumns = MemoryAccessStats::REQUESTER_COUNT + 1;
+  struct Row {
+    Addr address;
+    std::array<uint64_t, kCountColumns> counts;
+  };
+  std::vector<Row> rows;
+  const Addr count = show_regions
+                         ? MemoryAccessStats::kRegionCount
+                         : MemoryAccessStats::kRegisterEnd - MemoryAccessStats::kRegisterStart;
+  for (Addr i = 0; i < count; i++) {
+    const Addr address = show_regions ? i * MemoryAccessStats::kRegionWords
+                                      : MemoryAccessStats::kRegisterStart + i;
+    const auto& counts = show_regions ? memory_access_stats.GetRegion(i)
+                                      : memory_access_stats.GetRegister(address);
+    Row row = {address, {}};
+    for (int requester = 0; requester < MemoryAccessStats::REQUESTER_COUNT; requester++) {
+      row.counts[requester] = (shown != SHOWN_WRITES ? counts.reads[requester] : 0) +
+                              (shown != SHOWN_READS ? counts.writes[requester] : 0);
+      row.counts.back() += row.counts[requester];
+    }
+    if (!hide_unused || row.counts.back() > 0)
+      rows.push_back(row);
+  }
+
+  const ImGuiTableFlags flags = ImGuiTableFlags_Sortable | ImGuiTableFlags_RowBg |
+                                ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV |
+                                ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY;
+  if (ImGui::BeginTable("memory_access", 2 + kCountColumns, flags)) {
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Address");
+    ImGui::TableSetupColumn("Area", ImGuiTableColumnFlags_NoSort);
+    for (int requester = 0; requester < MemoryAccessStats::REQUESTER_COUNT; requester++) {
+      ImGui::TableSetupColumn(MemoryAccessStats::GetRequesterName(requester),
+                              ImGuiTableColumnFlags_PreferSortDescending);
+    }
+    ImGui::TableSetupColumn("Total", ImGuiTableColumnFlags_DefaultSort |
+                                         ImGuiTableColumnFlags_PreferSortDescending);
+    ImGui::TableHeadersRow();
+
+    if (const ImGuiTableSortSpecs* specs = ImGui::TableGetSortSpecs(); specs && specs->SpecsCount) {
+      const int column = specs->Specs[0].ColumnIndex;
+      const bool ascending = specs->Specs[0].SortDirection == ImGuiSortDirection_Ascending;
+      std::ranges::stable_sort(rows, [column, ascending](const Row& a, const Row& b) {
+        const uint64_t value_a = column < 2 ? a.address : a.counts[column - 2];
+        const uint64_t value_b = column < 2 ? b.address : b.counts[column - 2];
+        return ascending ? value_a < value_b : value_a > value_b;
+      });
+    }
+
+    ImGuiListClipper clipper;
+    clipper.Begin(rows.size());
+    while (clipper.Step()) {
+      for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+        const Row& row = rows[i];
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::Text("%06x", row.address);
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(MemoryAccessStats::GetAreaName(row.address));
+        for (uint64_t value : row.counts) {
+          ImGui::TableNextColumn();
+          ImGui::Text("%" PRIu64, value);
+        }
+      }
+    }
+    ImGui::EndTable();
+  }
+  ImGui::End();
+}
+
 static void DrawGui() {
   ImGuiIO& io = ImGui::GetIO();
   ui.frame_advance = false;
   if ((!vsmile || (SDL_GetMouseFocus() && !ui.fullscreen)) && ImGui::BeginMainMenuBar()) {
     if (ImGui::BeginMenu("Emulation")) {
-      if (ImGui::MenuItem("Load V.Smile ROM", "")) {
+      // Both peers must run the same machine with the same input in netplay
+      const bool netplay = netplay_session != nullptr;
+      if (ImGui::MenuItem("Load V.Smile ROM", "", false, !netplay)) {
         ui.show_load_window = true;
       }
       ImGui::MenuItem("Run", "", &ui.run_emulation);
+      ImGui::BeginDisabled(netplay);
       ImGui::MenuItem("Unlock Framerate", "", &ui.unlock_framerate);
       ImGui::MenuItem("Frame Advance", "", &ui.frame_advance);
-      ImGui::BeginDisabled(!vsmile);
+      ImGui::EndDisabled();
+      ImGui::BeginDisabled(!vsmile || netplay);
       if (ImGui::MenuItem("Hard Reset")) {
+        StopMovie();
         vsmile->Reset();
+        StartBootCache(cur_system_config);
+        run_ahead_picture.clear();
       }
       ImGui::EndDisabled();
+      if (ImGui::BeginMenu("Run-Ahead", !netplay)) {
+        for (int frames = 0; frames <= 4; frames++) {
+          const std::string label = frames == 0 ? "Off" : std::to_string(frames);
+          if (ImGui::MenuItem(label.c_str(), "", ui.run_ahead_frames == frames)) {
+            ui.run_ahead_frames = frames;
+          }
+        }
+        ImGui::EndMenu();
+      }
       ImGui::Separator();
+      ImGui::BeginDisabled(netplay);
       ImGui::MenuItem("ON Button", "F1", &ui.on_button);
       ImGui::MenuItem("OFF Button", "F2", &ui.off_button);
       ImGui::MenuItem("RESTART Button", "F3", &ui.restart_button);
+      ImGui::EndDisabled();
       ImGui::EndMenu();
     }
     if (ImGui::BeginMenu("View")) {
@@ -452,6 +845,7 @@ static void DrawGui() {
       ImGui::MenuItem("Show SPU Output", "", &ui.show_spu_output_window);
       ImGui::Separator();
       ImGui::MenuItem("Show Memory Editor", "", &ui.show_memory_editor);
+      ImGui::MenuItem("Show Memory Access Statistics", "", &ui.show_memory_access_window);
       ImGui::EndMenu();
     }
     if (ImGui::BeginMenu("Settings")) {
@@ -538,6 +932,14 @@ static void DrawGui() {
     ui.show_memory_editor = memory_editor.Open;
   }
 
+  if (ui.show_memory_access_window) {
+    DrawMemoryAccessWindow();
+  }
+  // Accesses are only counted while the window is open, as counting slows down emulation
+  if (vsmile) {
+    vsmile->SetMemoryAccessStats(ui.show_memory_access_window ? &memory_access_stats : nullptr);
+  }
+
   if (ui.show_about_window) {
     ImGui::SetNextWindowSize(ImVec2(400, 0), 0);
     ImGui::Begin("About", &ui.show_about_window);
@@ -565,7 +967,7 @@ static void DrawGui() {
   }
 
   if (ui.show_leds) {
-    DrawLeds(vsmile ? vsmile->GetControllerLed() : VSmile::JoyLedStatus{},
+    DrawLeds(vsmile ? vsmile->GetControllerLed(ui.controller_port) : VSmile::JoyLedStatus{},
              ImVec2(io.DisplaySize.x - 4, io.DisplaySize.y - 4));
   }
   if (ui.show_fps) {
@@ -574,12 +976,52 @@ static void DrawGui() {
 }
 
 int RunEmulation(const SystemConfig& system_config, const UiConfig& ui_config) {
+  // Runs that must be reproducible from power-on always go through the intro
+  if (ui_config.use_boot_cache && !ui_config.play_movie_path.has_value() &&
+      !ui_config.record_movie_path.has_value() && !ui_config.state_hash_log_path.has_value() &&
+      !ui_config.netplay_peer.has_value()) {
+    if (ui_config.boot_cache_dir.has_value()) {
+      boot_cache.dir = *ui_config.boot_cache_dir;
+    } else if (char* pref_path = SDL_GetPrefPath("veesem", "veesem")) {
+      boot_cache.dir = std::filesystem::path(pref_path) / "boot_cache";
+      SDL_free(pref_path);
+    }
+    boot_cache.refresh = ui_config.refresh_boot_cache;
+  }
+
+  if (ui_config.play_movie_path.has_value() || ui_config.record_movie_path.has_value()) {
+    if (!system_config.cartrom_path.has_value()) {
+      std::cerr << "Load Error: Movies require a cartridge ROM" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
   if (system_config.cartrom_path.has_value()) {
-    auto load_error = LoadVSmile(system_config);
+    // Machine settings of a movie being played back override those given on the command line
+    SystemConfig config = system_config;
+    if (ui_config.play_movie_path.has_value()) {
+      auto movie_error = StartMoviePlayback(*ui_config.play_movie_path);
+      if (movie_error.has_value()) {
+        std::cerr << "Movie Error: " << *movie_error << std::endl;
+        return EXIT_FAILURE;
+      }
+      const auto& settings = movie_state.movie.GetSettings();
+      config.video_timing = settings.video_timing;
+      config.cart_type = settings.cart_type;
+      config.region_code = settings.region_code;
+      config.vtech_logo = settings.vtech_logo;
+    }
+
+    auto load_error = LoadVSmile(config);
     if (load_error.has_value()) {
       std::cerr << "Load Error: " << *load_error << std::endl;
       return EXIT_FAILURE;
     }
+
+    if (ui_config.record_movie_path.has_value())
+      StartMovieRecording(*ui_config.record_movie_path);
+    if (movie_state.mode != MovieState::Mode::NONE)
+      vsmile->SetDeterministicRandom(true);
   } else {
     // Save system config so that values from command-line arguments
     // are auto-filled in load window.
@@ -587,6 +1029,37 @@ int RunEmulation(const SystemConfig& system_config, const UiConfig& ui_config) {
     cur_system_config = system_config;
   }
 
+  if (ui_config.netplay_peer.has_value()) {
+    if (!vsmile) {
+      std::cerr << "Load Error: Netplay requires a cartridge ROM" << std::endl;
+      return EXIT_FAILURE;
+    }
+    netplay_transport = std::make_unique<UdpTransport>();
+    auto netplay_error = netplay_transport->Open(ui_config.netplay_port, *ui_config.netplay_peer);
+    if (netplay_error.has_value()) {
+      std::cerr << "Netplay Error: " << *netplay_error << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    vsmile->SetDeterministicRandom(true);
+    RollbackSession::Settings settings;
+    settings.local_player = ui_config.netplay_player - 1;
+    settings.input_delay = ui_config.netplay_input_delay;
+    netplay_session = std::make_unique<RollbackSession>(*vsmile, *netplay_transport, settings);
+    ui.controller_port = settings.local_player;
+    std::cout << "Netplay as player " << ui_config.netplay_player << " with "
+              << *ui_config.netplay_peer << std::endl;
+  }
+
+  if (ui_config.state_hash_log_path.has_value()) {
+    hash_log_file = std::fopen(ui_config.state_hash_log_path->c_str(), "w");
+    if (!hash_log_file) {
+      std::cerr << "Could not open state hash log file" << std::endl;
+      return EXIT_FAILURE;
+    }
+    hash_log = std::make_unique<VSmileHashLog>(hash_log_file, ui_config.state_hash_interval);
+  }
+
   if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER) < 0) {
     std::cerr << "Platform Error: Unable to initialize SDL";
     return EXIT_FAILURE;
@@ -604,18 +1077,11 @@ int RunEmulation(const SystemConfig& system_config, const UiConfig& ui_config) {
     std::cout << "Controller found: " << SDL_GameControllerName(pad) << std::endl;
   };
 
-  SDL_AudioStream* audio_stream = SDL_NewAudioStream(AUDIO_U16, 2, 281250, AUDIO_S16, 2, 48000);
+  audio_state.Init(ui_config.audio_sample_rate, ui_config.audio_quality);
 
-  SDL_AudioSpec audiospec;
-  audiospec.callback = SdlAudioCallback;
-  audiospec.userdata = audio_stream;
-  audiospec.freq = 48000;
-  audiospec.format = AUDIO_S16;
-  audiospec.channels = 2;
-  audiospec.samples = 1024;
-
-  SDL_OpenAudio(&audiospec, NULL);
-  SDL_PauseAudio(0);
+  // Rewinding and run-ahead would restore states behind the back of the netplay session
+  if (ui_config.rewind_buffer_size > 0 && !netplay_session)
+    rewind_buffer = std::make_unique<RewindBuffer>(ui_config.rewind_buffer_size);
 
   SDL_Event e;
   bool quit = false;
@@ -623,6 +1089,7 @@ int RunEmulation(const SystemConfig& system_config, const UiConfig& ui_config) {
   ui.show_leds = ui_config.show_leds;
   ui.show_fps = ui_config.show_fps;
   ui.allow_background_input = ui_config.allow_background_input;
+  ui.run_ahead_frames = netplay_session ? 0 : ui_config.run_ahead_frames;
   SDL_SetHint(SDL_HINT_JOYSTICK_ALLOW_BACKGROUND_EVENTS, ui.allow_background_input ? "1" : "0");
 
   while (!quit) {
@@ -653,66 +1120,128 @@ int RunEmulation(const SystemConfig& system_config, const UiConfig& ui_config) {
     ImGui::NewFrame();
 
     DrawGui();
+    frame_timings.Lap(VSmileFrameTimings::PHASE_GUI);
 
-    bool fast_forward = ImGui::IsKeyDown(ImGuiKey_Tab) || ui.unlock_framerate;
+    bool fast_forward =
+        !netplay_session && (ImGui::IsKeyDown(ImGuiKey_Tab) || ui.unlock_framerate);
 
-    if (vsmile && (ui.run_emulation || ui.frame_advance)) {
-      if (pad) {
-        vsmile->UpdateJoystick(ReadController(pad));
-      } else {
-        vsmile->UpdateJoystick(ReadControllerFromKeyboard());
+    const bool rewind = rewind_buffer && ImGui::IsKeyDown(ImGuiKey_Backspace) &&
+                        !ImGui::GetIO().WantTextInput;
+
+    if (vsmile && ui.run_emulation && rewind) {
+      if (rewind_buffer->Pop()) {
+        vsmile->LoadState(rewind_buffer->GetCurrent());
+
+        // Undo the input of the rewound frame, so that recording or playback continues from the
+        // restored state
+        if (movie_state.mode != MovieState::Mode::NONE)
+          movie_state.position--;
+        if (movie_state.mode == MovieState::Mode::RECORDING)
+          movie_state.movie.Truncate(movie_state.position);
+      }
+      run_ahead_picture.clear();
+
+      // Keep feeding the audio device so that frame pacing continues while rewinding
+      const size_t silence_frames =
+          Spu::SampleRate / GetEmulatedFrameRate(cur_system_config.video_timing);
+      audio_state.PushSamples(std::vector<uint16_t>(silence_frames * 2, 0x8000));
+      frame_timings.Lap(VSmileFrameTimings::PHASE_REWIND);
+    } else if (netplay_session) {
+      // No frame is run while waiting for the peer, which delays this side to match it
+      if (!ui.run_emulation) {
+        netplay_session->Idle();
+      } else if (netplay_session->AdvanceFrame(pad ? ReadController(pad)
+                                                   : ReadControllerFromKeyboard())) {
+        PushFrameAudio();
       }
 
-      vsmile->UpdateOnButton(ui.on_button || ImGui::IsKeyDown(ImGuiKey_F1));
-      vsmile->UpdateOffButton(ui.off_button || ImGui::IsKeyDown(ImGuiKey_F2));
-      vsmile->UpdateRestartButton(ui.restart_button || ImGui::IsKeyDown(ImGuiKey_F3));
-      ui.on_button = false;
-      ui.off_button = false;
-      ui.restart_button = false;
+      static bool desync_reported = false;
+      if (netplay_session->GetDesyncFrame().has_value() && !desync_reported) {
+        std::cerr << "Netplay desync detected at frame " << *netplay_session->GetDesyncFrame()
+                  << std::endl;
+        desync_reported = true;
+      }
+      frame_timings.Lap(VSmileFrameTimings::PHASE_NETPLAY);
+    } else if (vsmile && (ui.run_emulation || ui.frame_advance)) {
+      VSmileMovie::ApplyInput(*vsmile, GetFrameInput(pad));
+      frame_timings.StartEmulation(*vsmile);
+      if (hash_log) {
+        hash_log->RunFrame(*vsmile);
+      } else {
+        vsmile->RunFrame();
+      }
+      frame_timings.EndEmulation(*vsmile);
 
-      vsmile->RunFrame();
+      PushFrameAudio();
 
-      auto ab = vsmile->GetAudio();
-      SDL_AudioStreamPut(audio_stream, ab.data(), ab.size() * sizeof(uint16_t));
+      if (boot_cache.pending && vsmile->HasFinishedIntro())
+        SaveBootCache();
 
-      if (ui.show_spu_output_window) {
-        for (size_t i = 0; i < ab.size(); i += 2) {
-          ui.audio_samples_left[ui.audio_samples_offset] = (ab[i] - 32768);
-          ui.audio_samples_right[ui.audio_samples_offset] = (ab[i + 1] - 32768);
-          ui.audio_samples_offset++;
+      if (rewind_buffer || ui.run_ahead_frames > 0)
+        vsmile->SaveState(frame_state);
+      if (rewind_buffer)
+        rewind_buffer->Push(frame_state);
+      frame_timings.Lap(VSmileFrameTimings::PHASE_REWIND);
 
-          if (ui.audio_samples_offset == std::size(ui.audio_samples_left))
-            ui.audio_samples_offset = 0;
-        }
+      if (ui.run_ahead_frames > 0) {
+        RunAhead(ui.run_ahead_frames);
+      } else {
+        run_ahead_picture.clear();
       }
+      frame_timings.Lap(VSmileFrameTimings::PHASE_RUN_AHEAD);
     }
 
     if (vsmile) {
-      auto fb = vsmile->GetPicture();
+      auto fb = run_ahead_picture.empty() ? vsmile->GetPicture() : run_ahead_picture;
       graphics_state.DrawFrame(fb.data(), ui.bilinear);
     } else {
       graphics_state.ClearFrame();
     }
 
+    // Lock to display refresh when it is close enough to the emulated frame rate, otherwise pace
+    // on audio buffer fill
+    const bool running = vsmile && ui.run_emulation;
+    const bool vsync = running && !fast_forward &&
+                       IsRefreshRateClose(graphics_state.GetRefreshRate(),
+                                          cur_system_config.video_timing);
+    graphics_state.SetVsync(vsync);
+    frame_timings.Lap(VSmileFrameTimings::PHASE_VIDEO_UPLOAD);
+
     ImGui::Render();
     ImGui_ImplOpenGL2_RenderDrawData(ImGui::GetDrawData());
+    frame_timings.Lap(VSmileFrameTimings::PHASE_GUI);
     graphics_state.SwapWindow();
+    frame_timings.Lap(VSmileFrameTimings::PHASE_PRESENT);
 
-    while (SDL_AudioStreamAvailable(audio_stream) > 0.1 * 48000 * sizeof(int16_t)) {
-      // TODO: better way to sync?
-      if (fast_forward) {
-        SDL_AudioStreamClear(audio_stream);
-      } else {
-        SDL_Delay(10);  // better way to sync????
+    const size_t target_frames = audio_state.GetTargetFrames();
+    if (fast_forward) {
+      if (audio_state.GetQueuedFrames() > target_frames)
+        audio_state.Clear();
+    } else {
+      // With vsync the buffer only grows past the limit if the display runs too fast
+      const size_t max_frames = vsync ? target_frames * 3 : target_frames;
+      while (running && audio_state.GetQueuedFrames() > max_frames) {
+        SDL_Delay(1);
       }
     }
-    if (!vsmile || !ui.run_emulation) {
+    if (!running) {
       SDL_Delay(20);
     }
+    frame_timings.Lap(VSmileFrameTimings::PHASE_AUDIO_SYNC);
+    frame_timings.EndFrame();
   }
 
+  StopMovie();
+  netplay_session.reset();
+  netplay_transport.reset();
   UnloadVSmile();
+  rewind_buffer.reset();
+  if (hash_log_file) {
+    hash_log.reset();
+    std::fclose(hash_log_file);
+  }
 
+  audio_state.Quit();
   SDL_Quit();
   return EXIT_SUCCESS;
 }
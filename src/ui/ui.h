@@ -2,23 +2,29 @@
 
 #include <optional>
 
+#include "core/audio/resampler.h"
 #include "core/vsmile/vsmile.h"
-
-struct SystemConfig {
-  std::optional<std::string> sysrom_path;
-  std::optional<std::string> cartrom_path;
-  std::optional<std::string> csb2_nvram_save_path;
-  VSmile::CartType cart_type = VSmile::CartType::STANDARD;
-  VideoTiming video_timing = VideoTiming::PAL;
-  bool use_dummy_sysrom = true;
-  unsigned region_code = 0xe;
-  bool vtech_logo = true;
-};
+#include "core/vsmile/vsmile_loader.h"
 
 struct UiConfig {
   bool show_leds = false;
   bool show_fps = false;
   bool allow_background_input = false;
+  int audio_sample_rate = 48000;
+  Resampler::Quality audio_quality = Resampler::Quality::HIGH;
+  size_t rewind_buffer_size = 64 * 1024 * 1024;
+  int run_ahead_frames = 0;
+  std::optional<std::string> record_movie_path;
+  std::optional<std::string> play_movie_path;
+  std::optional<std::string> state_hash_log_path;
+  uint64_t state_hash_interval = 0;
+  std::optional<std::string> netplay_peer;
+  uint16_t netplay_port = 7845;
+  int netplay_player = 1;
+  int netplay_input_delay = 1;
+  std::optional<std::string> boot_cache_dir;
+  bool use_boot_cache = true;
+  bool refresh_boot_cache = false;
 };
 
 int RunEmulation(const SystemConfig& system_config, const UiConfig& ui_config);
\ No newline at end of file